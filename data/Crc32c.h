@@ -0,0 +1,116 @@
+#pragma once
+
+/*
+
+	CRC-32C (Castagnoli) checksums, as used by iSCSI, ext4 and most storage formats.
+	(1) Uses the SSE4.2 crc32 instruction when the CPU has it, 8 bytes at a time.
+	(2) Otherwise falls back to a table-driven software version with the same results.
+	(3) extend() continues a checksum over more data, i.e. compute( a + b ) == extend( compute( a ), b ).
+
+*/
+
+#include <array>
+#include <cstring>
+
+#include "../../cpp/data/Memory.h"
+
+#if defined( _M_X64 ) || defined( __x86_64__ )
+#define CPP_CRC32C_SSE42
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined( CPP_CRC32C_SSE42 ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#define CPP_CRC32C_TARGET __attribute__( ( target( "sse4.2" ) ) )
+#else
+#define CPP_CRC32C_TARGET
+#endif
+
+namespace cpp
+{
+	struct Crc32c
+	{
+		static uint32_t compute( Memory data );
+		static uint32_t extend( uint32_t crc, Memory data );
+
+		static bool hasHardware( );
+		static uint32_t software( uint32_t crc, Memory data );
+		static uint32_t hardware( uint32_t crc, Memory data );		// requires hasHardware( )
+	};
+
+
+	inline uint32_t Crc32c::compute( Memory data )
+	{
+		return extend( 0, data );
+	}
+
+
+	inline uint32_t Crc32c::extend( uint32_t crc, Memory data )
+	{
+		static const bool isHardware = hasHardware( );
+		return isHardware ? hardware( crc, data ) : software( crc, data );
+	}
+
+
+	inline bool Crc32c::hasHardware( )
+	{
+#if defined( CPP_CRC32C_SSE42 ) && defined( _MSC_VER )
+		int info[4];
+		__cpuid( info, 1 );
+		return ( info[2] & ( 1 << 20 ) ) != 0;
+#elif defined( CPP_CRC32C_SSE42 )
+		return __builtin_cpu_supports( "sse4.2" );
+#else
+		return false;
+#endif
+	}
+
+
+	inline uint32_t Crc32c::software( uint32_t crc, Memory data )
+	{
+		static const auto table = []( )
+		{
+			std::array<uint32_t, 256> result{ };
+			for ( uint32_t index = 0; index < 256; index++ )
+			{
+				uint32_t value = index;
+				for ( int bit = 0; bit < 8; bit++ )
+					{ value = ( value >> 1 ) ^ ( ( value & 1 ) ? 0x82F63B78u : 0 ); }
+				result[index] = value;
+			}
+			return result;
+		}( );
+
+		crc = ~crc;
+		for ( size_t pos = 0; pos < data.length( ); pos++ )
+			{ crc = table[( crc ^ (uint8_t)data[pos] ) & 0xff] ^ ( crc >> 8 ); }
+		return ~crc;
+	}
+
+
+	CPP_CRC32C_TARGET inline uint32_t Crc32c::hardware( uint32_t crc, Memory data )
+	{
+#ifdef CPP_CRC32C_SSE42
+		const char * ptr = data.begin( );
+		const char * end = data.end( );
+
+		uint64_t value = ~crc & 0xffffffffu;
+		for ( ; ptr + 8 <= end; ptr += 8 )
+		{
+			uint64_t chunk;
+			std::memcpy( &chunk, ptr, 8 );
+			value = _mm_crc32_u64( value, chunk );
+		}
+
+		uint32_t result = (uint32_t)value;
+		for ( ; ptr < end; ptr++ )
+			{ result = _mm_crc32_u8( result, (uint8_t)*ptr ); }
+		return ~result;
+#else
+		return software( crc, data );
+#endif
+	}
+
+}
@@ -341,7 +341,7 @@ namespace cpp
     template<class T>
     void DataArray<T>::remove( size_t index )
     {
-        Memory item = data[index]; data.erase( data.begin( ) + index ); return item;
+        data.erase( data.begin( ) + index );
     }
 
 
@@ -164,7 +164,7 @@ namespace cpp
         if ( getable( ).length( ) < len )
         {
             setPos( origin );
-            return Memory::Null;
+            return Memory{ };
         }
         return get( len );
     }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cmath>
+#include <cstring>
+
 #include "../../cpp/data/Primitive.h"
 #include "../../cpp/data/Memory.h"
 #include "../process/Exception.h"
@@ -188,7 +188,7 @@ namespace cpp
     size_t IndexedSet<T>::rindexOf( T key ) const
     {
         auto itr = m_posMap.find( key );
-        return (itr != m_posMap.end( )) ? rindex( index ) : npos;
+        return (itr != m_posMap.end( )) ? rindex( itr->second ) : npos;
     }
 
     template<typename T>
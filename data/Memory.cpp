@@ -1,6 +1,7 @@
 #ifndef TEST
 
 #include <cassert>
+#include <cctype>
 #include <cstdarg>
 #include <algorithm>
 #include <regex>
@@ -455,9 +456,13 @@ namespace cpp
 
 	EncodedText::operator bool( ) const
 	{  
-		if ( _stricmp( data.begin( ), "true" ) == 0 && data.length( ) == 4 )
+		auto isText = [this]( Memory text )
+			{ return data.length( ) == text.length( ) && std::equal( data.begin( ), data.end( ), text.begin( ),
+				[]( char ch, char lower ) { return std::tolower( (unsigned char)ch ) == lower; } ); };
+
+		if ( isText( "true" ) )
 			{ return true; }
-		if ( _stricmp( data.begin( ), "false" ) == 0 && data.length( ) == 5 )
+		if ( isText( "false" ) )
 			{ return false; }
 		throw DecodeException{ "EncodedText::bool() : unable to decode boolean text value" };
 	}
@@ -14,6 +14,7 @@
 
 */
 
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -421,6 +422,13 @@ namespace cpp
 		{ return value; }
 
 
+#ifndef _MSC_VER
+	inline uint16_t _byteswap_ushort( uint16_t value ) { return __builtin_bswap16( value ); }
+	inline uint32_t _byteswap_ulong( uint32_t value ) { return __builtin_bswap32( value ); }
+	inline uint64_t _byteswap_uint64( uint64_t value ) { return __builtin_bswap64( value ); }
+#endif
+
+
 	inline int16_t Memory::byteswap( int16_t value )
 		{ return (int16_t)_byteswap_ushort( value ); }
 
@@ -2,6 +2,7 @@
 
 #include <cstdarg>
 #include <algorithm>
+#include <stdexcept>
 
 #include "String.h"
 
@@ -101,7 +102,7 @@ namespace cpp
 		while ( ( len = vsnprintf( (char *)result.begin( ), result.length( ), fmt, args ) ) >= result.length( ) )
 		    { result.resize( len + 1 ); }
 		if ( len < 0 )
-			{ throw std::exception("Encoding error occured in String::format."); }
+			{ throw std::runtime_error("Encoding error occured in String::format."); }
 		result.resize( len );
 
 		va_end(args);
@@ -463,7 +463,7 @@ namespace cpp
 	{
 		size_t fpos = fmt.find( '%' );
 		return ( fpos == Memory::npos )
-			? fmt
+			? fmt.toString( )
 			: fmt.substr( 0, fpos ) + cpp::toString( param ) + format( fmt.substr( fpos + 1 ), parameters... );
 	}
 
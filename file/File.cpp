@@ -3,9 +3,16 @@
 #include <cassert>
 
 #include "File.h"
-#include "../../cpp/process/Platform.h"
 #include "../../cpp/process/Exception.h"
 
+#ifdef _WIN32
+#include "../../cpp/process/Platform.h"
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 
 
 namespace cpp
@@ -39,10 +46,17 @@ namespace cpp
         void							    close( ) override;
 
     private:
+#ifdef _WIN32
         HANDLE                              m_handle;
+#else
+        int                                 m_handle;                       // file descriptor
+#endif
         std::error_code                     m_error;
     };
 
+
+#ifdef _WIN32
+
     
     std::shared_ptr<File::Detail> File::Detail::create( const FilePath & filepath, Access access, Share share )
     {
@@ -207,7 +221,21 @@ namespace cpp
 
     Memory File::Detail::write( const Memory src, std::error_code & errorCode )
     {
-        return src;
+        DWORD bytes = 0;
+        if ( m_error )
+        {
+            errorCode = m_error;
+        }
+        else if ( !isOpen( ) )
+        {
+            errorCode = std::make_error_code( std::errc::connection_aborted );
+        }
+        else if ( !WriteFile( m_handle, src.data( ), (DWORD)src.length( ), &bytes, NULL ) )
+        {
+            m_error = std::error_code{ ::GetLastError( ), std::system_category( ) };
+            errorCode = m_error;
+        }
+        return src.substr( 0, bytes );
     }
 
     
@@ -252,6 +280,197 @@ namespace cpp
 
 
 
+#else
+
+    //  Share modes have no POSIX equivalent and are ignored.
+    std::shared_ptr<File::Detail> File::Detail::create( const FilePath & filepath, Access access, Share )
+    {
+        int flags = O_RDONLY;
+        if ( access == Access::Create )
+            { flags = O_RDWR | O_CREAT | O_TRUNC; }
+        else if ( access == Access::Write )
+            { flags = O_RDWR | O_CREAT; }
+
+        FilePath parent = filepath.parent( );
+        if ( ( access == Access::Create || access == Access::Write ) && !parent.isEmpty( ) )
+        {
+            Files::createDirectories( parent );
+        }
+
+        int fd = ::open( filepath.toString( ).c_str( ), flags | O_CLOEXEC, 0644 );
+        if ( fd < 0 )
+        {
+            throw IOException( cpp::format( "Unable to open file: error( % )", (uint32_t)errno ) );
+        }
+
+        std::shared_ptr<Detail> detail = std::make_shared<Detail>( );
+        detail->m_handle = fd;
+        return detail;
+    }
+
+
+    File::Detail::Detail( )
+        : m_handle( -1 )
+    {
+    }
+
+
+    File::Detail::~Detail( )
+    {
+        close( );
+    }
+
+
+    bool File::Detail::isOpen( ) const
+    {
+        return m_handle >= 0;
+    }
+
+
+    size_t File::Detail::length( ) const
+    {
+        assert( isOpen( ) );
+
+        struct stat info;
+        check<IOException>( ::fstat( m_handle, &info ) == 0, "SyncFile::length() failed" );
+        return (size_t)info.st_size;
+    }
+
+
+    size_t File::Detail::tell( ) const
+    {
+        assert( isOpen( ) );
+
+        off_t pos = ::lseek( m_handle, 0, SEEK_CUR );
+        check<IOException>( pos >= 0, "SyncFile::tell() failed" );
+        return (size_t)pos;
+    }
+
+
+    void File::Detail::seek( size_t pos )
+    {
+        assert( isOpen( ) );
+
+        check<IOException>( ::lseek( m_handle, (off_t)pos, SEEK_SET ) >= 0, "SyncFile::seek() failed" );
+    }
+
+
+    void File::Detail::seekToEnd( )
+    {
+        assert( isOpen( ) );
+
+        check<IOException>( ::lseek( m_handle, 0, SEEK_END ) >= 0, "SyncFile::seekToEnd() failed" );
+    }
+
+
+    Memory File::Detail::readsome( Memory buffer, std::error_code & errorCode )
+    {
+        ssize_t bytes = 0;
+        if ( m_error )
+        { 
+            errorCode = m_error; 
+        }
+        else if ( isOpen( ) )
+        {
+            bytes = ::read( m_handle, buffer.data( ), buffer.length( ) );
+            if ( bytes < 0 )
+            {
+                m_error = std::error_code{ errno, std::system_category( ) };
+                errorCode = m_error;
+                bytes = 0;
+            }
+            if ( bytes == 0 )
+            {
+                close( );
+            }
+        }
+        return buffer.substr( 0, bytes );
+    }
+
+
+    Memory File::Detail::read( Memory buffer )
+    {
+        check<Input::Exception>( !m_error, m_error );
+
+        ssize_t bytes = 0;
+        if ( isOpen( ) )
+        {
+            bytes = ::read( m_handle, buffer.data( ), buffer.length( ) );
+            if ( bytes < 0 )
+            {
+                m_error = std::make_error_code( std::errc::io_error );
+                throw Input::Exception{ m_error };
+            }
+        }
+        return buffer.substr( 0, bytes );
+    }
+
+
+    Memory File::Detail::write( const Memory src, std::error_code & errorCode )
+    {
+        ssize_t bytes = 0;
+        if ( m_error )
+        {
+            errorCode = m_error;
+        }
+        else if ( !isOpen( ) )
+        {
+            errorCode = std::make_error_code( std::errc::connection_aborted );
+        }
+        else if ( ( bytes = ::write( m_handle, src.data( ), src.length( ) ) ) < 0 )
+        {
+            m_error = std::error_code{ errno, std::system_category( ) };
+            errorCode = m_error;
+            bytes = 0;
+        }
+        return src.substr( 0, bytes );
+    }
+
+
+    void File::Detail::write( const Memory data )
+    {
+        assert( isOpen( ) );
+
+        for ( size_t pos = 0; pos < data.length( ); )
+        {
+            ssize_t bytes = ::write( m_handle, data.data( ) + pos, data.length( ) - pos );
+            check<IOException>( bytes > 0, "SyncFile::write() failed" );
+            pos += bytes;
+        }
+    }
+
+
+    void File::Detail::truncate( size_t length )
+    {
+        assert( isOpen( ) );
+
+        check<IOException>( ::ftruncate( m_handle, (off_t)length ) == 0,
+            "SyncFile::truncate() : ftruncate() failed" );
+        check<IOException>( ::lseek( m_handle, (off_t)length, SEEK_SET ) >= 0,
+            "SyncFile::truncate() : lseek() failed" );
+    }
+
+
+    void File::Detail::flush( )
+    {
+        ::fsync( m_handle );
+    }
+
+
+    void File::Detail::close( )
+    {
+        if ( isOpen( ) )
+        {
+            if ( !m_error )
+                { m_error = std::make_error_code( std::errc::connection_aborted ); };
+            ::close( m_handle );
+            m_handle = -1;
+        }
+    }
+
+#endif
+
+
     File File::readFrom( const FilePath & filepath, Share share )
     {
         return File{ filepath, Access::Read, share };
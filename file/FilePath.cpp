@@ -4,9 +4,10 @@
 #include "../../cpp/data/String.h"
 #include "../../cpp/file/Files.h"
 #include "../../cpp/file/FilePath.h"
-#include "../../cpp/process/Program.h"
 #include "../../cpp/process/Random.h"
+#ifdef _WIN32
 #include "../../cpp/text/Utf16.h"
+#endif
 
 
 
@@ -28,11 +29,12 @@ namespace cpp
 
 	FilePath FilePath::tempFile( Memory prefix, Memory ext )
 	{
+		thread_local Random random;
 		FilePath filepath = tempPath( );
 
 		do
 		{
-			uint32_t rnd = (uint32_t)Program::rng( ).rand( );
+			uint32_t rnd = (uint32_t)random.rand( );
             filepath = tempPath( ) / cpp::format( "%%.%", prefix, Integer::toHex( rnd ), ext );
 		} while ( Files::exists( filepath ) );
 
@@ -257,10 +259,12 @@ namespace cpp
 	}
 
 
+#ifdef _WIN32
 	std::wstring FilePath::toWindows( ) const
 	{
 		return toUtf16( toString( true ) );
 	}
+#endif
 
 }
 
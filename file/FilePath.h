@@ -76,7 +76,9 @@ namespace cpp
 
         std::filesystem::path               to_path( ) const;
         std::string                         toString( bool nativeSeperator = false ) const;
+#ifdef _WIN32
 		std::wstring						toWindows( ) const;
+#endif
 
         String                              path;
 	};
@@ -1,5 +1,13 @@
 #include "MemoryFile.h"
 
+#ifdef _WIN32
+#include "../platform/windows/WindowsException.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 
 namespace cpp
@@ -21,13 +29,21 @@ namespace cpp
 		void								flush( );
 		size_t								length( ) const;
 
+#ifdef _WIN32
 		HANDLE					            fileHandle = nullptr;
 		HANDLE					            mapHandle = nullptr;
+#else
+		int									fileHandle = -1;
+		size_t								mapLength = 0;
+#endif
 		char * mapView = nullptr;
 		size_t								iterator = 0;
 	};
 
 
+#ifdef _WIN32
+
+
 	MemoryFile::Detail::Detail(
 		const FilePath & filepath,
 		size_t maxSize,
@@ -131,6 +147,101 @@ namespace cpp
 
 
 
+#else
+
+	//	The file is mapped at its length when opened.  An empty file is open but has no view.
+	MemoryFile::Detail::Detail(
+		const FilePath & filepath,
+		size_t maxSize,
+		Access access,
+		Share share )
+	{
+		int flags = O_RDONLY;
+		if ( access == Access::Create )
+			{ flags = O_RDWR | O_CREAT | O_TRUNC; }
+		else if ( access == Access::Write )
+			{ flags = O_RDWR | O_CREAT; }
+
+		fileHandle = ::open( filepath.toString( ).c_str( ), flags | O_CLOEXEC, 0644 );
+		check<Input::Exception>( fileHandle >= 0, std::error_code( errno, std::system_category( ) ) );
+
+		struct stat info;
+		check<Input::Exception>( ::fstat( fileHandle, &info ) == 0, std::error_code( errno, std::system_category( ) ) );
+		mapLength = (size_t)info.st_size;
+		if ( mapLength > 0 )
+		{
+			int protection = ( access != Access::Read ) ? PROT_READ | PROT_WRITE : PROT_READ;
+			void * view = ::mmap( nullptr, mapLength, protection, MAP_SHARED, fileHandle, 0 );
+			check<Input::Exception>( view != MAP_FAILED, std::error_code( errno, std::system_category( ) ) );
+			mapView = (char *)view;
+		}
+	}
+
+
+	MemoryFile::Detail::~Detail( )
+	{
+		close( );
+	}
+
+
+	bool MemoryFile::Detail::isOpen( ) const
+	{
+		return fileHandle >= 0;
+	}
+
+
+	Memory MemoryFile::Detail::readsome( Memory dst, std::error_code & errorCode )
+	{
+		if ( !isOpen( ) )
+		{
+			errorCode = std::make_error_code( std::errc::connection_aborted );
+			return Memory::Empty;
+		}
+
+		if ( iterator == mapLength )
+		{
+			close( );
+			return Memory::Empty;
+		}
+
+		Memory result = Memory::copy( dst, Memory{ mapView + iterator, std::min<size_t>( mapLength - iterator, dst.length( ) ) } );
+		iterator += result.length( );
+		return result;
+	}
+
+
+	void MemoryFile::Detail::close( )
+	{
+		if ( mapView )
+		{
+			::munmap( mapView, mapLength );
+			mapView = nullptr;
+		}
+		if ( fileHandle >= 0 )
+		{
+			::close( fileHandle );
+			fileHandle = -1;
+		}
+	}
+
+
+	void MemoryFile::Detail::flush( )
+	{
+		if ( mapView )
+			{ ::msync( mapView, mapLength, MS_SYNC ); }
+	}
+
+
+	//	The mapped length, so data( ) never reaches past the view when the file has since grown.
+	size_t MemoryFile::Detail::length( ) const
+	{
+		return mapLength;
+	}
+
+#endif
+
+
+
 	MemoryFile::MemoryFile( const FilePath & filepath, size_t maxSize, Access access, Share share )
 		: m_detail( std::make_shared<Detail>( filepath, maxSize, access, share ) )
 	{
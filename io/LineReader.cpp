@@ -28,9 +28,18 @@ namespace cpp
 
     bool LineReader::iterator::tryFind( )
     {
-        Memory line = ( !m_input || !m_input->isOpen( ) )
-            ? m_buffer.getAll( )
-            : m_buffer.getLine( "\n", m_findPos );
+        //  once the input is closed, the unterminated tail is the last line and an empty buffer is the end( )
+        Memory line = m_buffer.getLine( "\n", m_findPos );
+        if ( line.isNull( ) && ( !m_input || !m_input->isOpen( ) ) )
+        {
+            if ( m_buffer.getable( ).isEmpty( ) )
+            {
+                m_input = nullptr;
+                m_nextPosition = 0;
+                return true;
+            }
+            line = m_buffer.getAll( );
+        }
 
         if ( line.isNull() )
         { 
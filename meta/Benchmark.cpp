@@ -0,0 +1,203 @@
+#ifdef BENCHMARK
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+
+#include "Benchmark.h"
+
+#include "../../cpp/data/String.h"
+#include "../../cpp/process/Exception.h"
+
+
+//  Every heap allocation in the process is counted, so each case can report its allocations per run.
+
+namespace
+{
+    std::atomic<size_t> allocationCount{ 0 };
+    std::atomic<size_t> allocationBytes{ 0 };
+
+    void * tryAllocate( size_t size )
+    {
+        allocationCount.fetch_add( 1, std::memory_order_relaxed );
+        allocationBytes.fetch_add( size, std::memory_order_relaxed );
+        return std::malloc( size ? size : 1 );
+    }
+
+
+    void * allocate( size_t size )
+    {
+        if ( void * ptr = tryAllocate( size ) )
+            { return ptr; }
+        throw std::bad_alloc{ };
+    }
+
+
+    //  over-aligned types (alignas > __STDCPP_DEFAULT_NEW_ALIGNMENT__) come through here
+    void * tryAllocate( size_t size, std::align_val_t alignment )
+    {
+        allocationCount.fetch_add( 1, std::memory_order_relaxed );
+        allocationBytes.fetch_add( size, std::memory_order_relaxed );
+        size_t align = (size_t)alignment;
+#ifdef _MSC_VER
+        return _aligned_malloc( size ? size : 1, align );
+#else
+        return std::aligned_alloc( align, ( ( size ? size : 1 ) + align - 1 ) / align * align );
+#endif
+    }
+
+
+    void * allocate( size_t size, std::align_val_t alignment )
+    {
+        if ( void * ptr = tryAllocate( size, alignment ) )
+            { return ptr; }
+        throw std::bad_alloc{ };
+    }
+
+
+    void release( void * ptr, std::align_val_t )
+    {
+#ifdef _MSC_VER
+        _aligned_free( ptr );
+#else
+        std::free( ptr );
+#endif
+    }
+}
+
+void * operator new( size_t size ) { return allocate( size ); }
+void * operator new[]( size_t size ) { return allocate( size ); }
+void * operator new( size_t size, const std::nothrow_t & ) noexcept { return tryAllocate( size ); }
+void * operator new[]( size_t size, const std::nothrow_t & ) noexcept { return tryAllocate( size ); }
+void operator delete( void * ptr ) noexcept { std::free( ptr ); }
+void operator delete[]( void * ptr ) noexcept { std::free( ptr ); }
+void operator delete( void * ptr, size_t ) noexcept { std::free( ptr ); }
+void operator delete[]( void * ptr, size_t ) noexcept { std::free( ptr ); }
+void operator delete( void * ptr, const std::nothrow_t & ) noexcept { std::free( ptr ); }
+void operator delete[]( void * ptr, const std::nothrow_t & ) noexcept { std::free( ptr ); }
+
+void * operator new( size_t size, std::align_val_t alignment ) { return allocate( size, alignment ); }
+void * operator new[]( size_t size, std::align_val_t alignment ) { return allocate( size, alignment ); }
+void * operator new( size_t size, std::align_val_t alignment, const std::nothrow_t & ) noexcept { return tryAllocate( size, alignment ); }
+void * operator new[]( size_t size, std::align_val_t alignment, const std::nothrow_t & ) noexcept { return tryAllocate( size, alignment ); }
+void operator delete( void * ptr, std::align_val_t alignment ) noexcept { release( ptr, alignment ); }
+void operator delete[]( void * ptr, std::align_val_t alignment ) noexcept { release( ptr, alignment ); }
+void operator delete( void * ptr, size_t, std::align_val_t alignment ) noexcept { release( ptr, alignment ); }
+void operator delete[]( void * ptr, size_t, std::align_val_t alignment ) noexcept { release( ptr, alignment ); }
+void operator delete( void * ptr, std::align_val_t alignment, const std::nothrow_t & ) noexcept { release( ptr, alignment ); }
+void operator delete[]( void * ptr, std::align_val_t alignment, const std::nothrow_t & ) noexcept { release( ptr, alignment ); }
+
+
+
+namespace cpp::benchmark
+{
+    std::vector<Case> & cases( )
+    {
+        static std::vector<Case> registered;
+        return registered;
+    }
+
+
+    size_t allocations( )
+    {
+        return allocationCount.load( std::memory_order_relaxed );
+    }
+
+
+    size_t allocatedBytes( )
+    {
+        return allocationBytes.load( std::memory_order_relaxed );
+    }
+
+
+    Result run( const Case & benchmarkCase, double minSeconds )
+    {
+        typedef std::chrono::steady_clock clock_t;
+
+        //  the first run warms up caches and any lazily built corpus
+        benchmarkCase.run( );
+
+        Result result;
+        result.name = benchmarkCase.name;
+
+        size_t firstAllocation = allocations( );
+        size_t firstAllocatedBytes = allocatedBytes( );
+        auto begin = clock_t::now( );
+        do
+        {
+            result.bytes += benchmarkCase.run( );
+            result.runs++;
+            result.seconds = std::chrono::duration<double>( clock_t::now( ) - begin ).count( );
+        } while ( result.seconds < minSeconds );
+
+        result.allocations = ( allocations( ) - firstAllocation ) / result.runs;
+        result.allocatedBytes = ( allocatedBytes( ) - firstAllocatedBytes ) / result.runs;
+        return result;
+    }
+
+
+    std::string toString( const Result & result )
+    {
+        char mbps[32], seconds[32];
+        std::snprintf( mbps, sizeof( mbps ), "%.1f", result.seconds > 0 ? result.bytes / result.seconds / ( 1024 * 1024 ) : 0.0 );
+        std::snprintf( seconds, sizeof( seconds ), "%.4f", result.seconds );
+
+        return format( "benchmark[%] : runs='%' bytes='%' seconds='%' mbps='%' allocations='%' allocatedBytes='%'\n",
+            result.name, result.runs, result.bytes, Memory{ seconds }, Memory{ mbps }, result.allocations, result.allocatedBytes );
+    }
+}
+
+
+
+int main( int argc, char const * argv[] )
+{
+    using namespace cpp;
+
+    Memory filter;
+    double minSeconds = 1.0;
+    const char * outFilename = nullptr;
+    for ( int index = 1; index < argc; index++ )
+    {
+        Memory arg = argv[index];
+        if ( arg.substr( 0, 11 ) == "--min-time=" )
+            { minSeconds = std::atof( argv[index] + 11 ); }
+        else if ( arg.substr( 0, 6 ) == "--out=" )
+            { outFilename = argv[index] + 6; }
+        else
+            { filter = arg; }
+    }
+
+    try
+    {
+        String results;
+        for ( auto & benchmarkCase : benchmark::cases( ) )
+        {
+            if ( filter.notEmpty( ) && Memory{ benchmarkCase.name }.find( filter ) == Memory::npos )
+                { continue; }
+
+            std::string line = benchmark::toString( benchmark::run( benchmarkCase, minSeconds ) );
+            std::fputs( line.c_str( ), stdout );
+            std::fflush( stdout );
+            results += line;
+        }
+
+        if ( outFilename )
+        {
+            std::ofstream out{ outFilename, std::ios::binary };
+            out.write( results.begin( ), results.length( ) );
+            check<std::runtime_error>( out.flush( ).good( ), format( "cpp-bench : unable to write %", Memory{ outFilename } ) );
+        }
+        return 0;
+    }
+    catch ( std::exception & e )
+    {
+        std::fprintf( stderr, "error: %s\n", e.what( ) );
+        return -1;
+    }
+}
+
+
+#endif
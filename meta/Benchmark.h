@@ -0,0 +1,85 @@
+#pragma once
+
+/*
+
+Benchmarks are compiled into the cpp-bench target (BENCHMARK defined), built by cpp-bench.vcxproj or, on
+Linux, by CMakeLists.txt.  Each case returns the number of bytes it processed, and is repeated until the
+minimum run time has passed.  Throughput and heap allocations per run are written as bit records, so
+results from two releases can be diffed:
+
+    benchmark[bit.decode.flat] : runs='212' bytes='4718592' seconds='1.0031' mbps='997.4' allocations='40963' allocatedBytes='3276940'
+
+EXAMPLE:
+
+#include <cpp/meta/Benchmark.h>
+
+BENCHMARK_CASE( "memory.find" )
+{
+    auto & text = corpus( );
+    cpp::benchmark::keep( Memory{ text }.find( "needle" ) );
+    return text.length( );
+}
+
+Usage: cpp-bench [name-filter] [--min-time=<seconds>] [--out=<filename>]
+
+*/
+
+#ifdef BENCHMARK
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+namespace cpp::benchmark
+{
+    typedef std::function<size_t( )>        Function;              // returns bytes processed
+
+    struct Case
+    {
+        std::string                         name;
+        Function                            run;
+    };
+
+    struct Result
+    {
+        std::string                         name;
+        size_t                              runs = 0;
+        size_t                              bytes = 0;
+        double                              seconds = 0;
+        size_t                              allocations = 0;        // per run
+        size_t                              allocatedBytes = 0;     // per run
+    };
+
+    std::vector<Case> &                     cases( );
+    size_t                                  allocations( );         // heap allocations since the program started
+    size_t                                  allocatedBytes( );
+
+    Result                                  run( const Case & benchmarkCase, double minSeconds );
+
+
+    struct Register
+    {
+        Register( const char * name, Function run )
+            { cases( ).push_back( Case{ name, std::move( run ) } ); }
+    };
+
+
+    //  Stops the optimizer from discarding a result.
+    inline void keep( size_t value )
+    {
+        static volatile size_t sink;
+        sink = sink + value;
+    }
+}
+
+
+#define BENCHMARK_CONCAT_( a, b ) a##b
+#define BENCHMARK_CONCAT( a, b ) BENCHMARK_CONCAT_( a, b )
+#define BENCHMARK_CASE( name ) \
+    static size_t BENCHMARK_CONCAT( benchmarkCase, __LINE__ )( ); \
+    static cpp::benchmark::Register BENCHMARK_CONCAT( benchmarkRegister, __LINE__ ){ name, &BENCHMARK_CONCAT( benchmarkCase, __LINE__ ) }; \
+    static size_t BENCHMARK_CONCAT( benchmarkCase, __LINE__ )( )
+
+#endif
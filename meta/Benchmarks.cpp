@@ -0,0 +1,352 @@
+#ifdef BENCHMARK
+
+#include <map>
+
+#include "Benchmark.h"
+
+#include "../../cpp/data/Integer.h"
+#include "../../cpp/data/String.h"
+#include "../../cpp/io/Input.h"
+#include "../../cpp/util/Bit.h"
+#include "../../cpp/util/BitBinary.h"
+#include "../../cpp/util/BitSharded.h"
+
+
+using namespace cpp;
+
+//  Synthetic corpora are generated from a fixed seed, so every release is measured on the same bytes.
+
+namespace
+{
+    struct Random
+    {
+        uint64_t state = 0x9E3779B97F4A7C15ull;
+
+        uint64_t next( )                                        // xorshift64*
+        {
+            state ^= state >> 12; state ^= state << 25; state ^= state >> 27;
+            return state * 0x2545F4914F6CDD1Dull;
+        }
+
+        size_t below( size_t count )
+            { return (size_t)( next( ) % count ); }
+    };
+
+
+    //  item[n] : name='item n' host='10.x.y.z' port='n' status='...'
+    const String & flatDocument( )
+    {
+        static String text = []
+        {
+            const char * statuses[] = { "active", "standby", "draining", "offline" };
+
+            Random random;
+            String result;
+            for ( size_t index = 0; index < 50000; index++ )
+            {
+                result += format( "item[%] : name='item %' host='10.%.%.%' port='%' status='%'\n",
+                    index, index, random.below( 256 ), random.below( 256 ), random.below( 256 ), 1024 + random.below( 60000 ), statuses[random.below( 4 )] );
+            }
+            return result;
+        }( );
+        return text;
+    }
+
+
+    //  region[r].zone[z].rack[k].server[s] nested with indented key contexts and long dotted keys
+    const String & deepDocument( )
+    {
+        static String text = []
+        {
+            Random random;
+            String result;
+            for ( size_t region = 0; region < 8; region++ )
+            {
+                result += format( "region[r%]:\n", region );
+                for ( size_t zone = 0; zone < 8; zone++ )
+                {
+                    result += format( "\tzone[z%]:\n", zone );
+                    for ( size_t rack = 0; rack < 16; rack++ )
+                    {
+                        for ( size_t server = 0; server < 8; server++ )
+                        {
+                            result += format( "\t\track[%].server[%] : ip='10.%.%.%' port='%'\n",
+                                rack, server, region, zone * 16 + rack, server, 1024 + random.below( 60000 ) );
+                        }
+                    }
+                }
+                for ( size_t zone = 0; zone < 8; zone++ )
+                {
+                    result += format( "region[r%].zone[z%].config.limits.connections.max='%'\n", region, zone, random.below( 100000 ) );
+                }
+            }
+            return result;
+        }( );
+        return text;
+    }
+
+
+    //  values of 16 - 256 bytes, some with quotes, newlines, tabs, and binary bytes which need escaping
+    const bit::Object & valueObject( )
+    {
+        static bit::Object object = []
+        {
+            const char special[] = { '\'', '\n', '\t', '^', '\0', '\r' };
+
+            Random random;
+            bit::Object result;
+            for ( size_t index = 0; index < 20000; index++ )
+            {
+                std::string value( 16 + random.below( 240 ), ' ' );
+                for ( auto & ch : value )
+                    { ch = (char)( 'a' + random.below( 26 ) ); }
+                for ( size_t count = random.below( 4 ); count; count-- )
+                    { value[random.below( value.length( ) )] = special[random.below( sizeof( special ) )]; }
+
+                result[format( "value[%].data", index )] = value;
+            }
+            return result;
+        }( );
+        return object;
+    }
+
+
+    const String & rawDocument( )
+    {
+        static String text = valueObject( ).encodeRaw( );          // key=(n)'value'
+        return text;
+    }
+
+
+    const String & escapedDocument( )
+    {
+        static String text = valueObject( ).encode( );             // key='^' escaped value'
+        return text;
+    }
+
+
+    //  application log lines with timestamps, levels, and key=value fields
+    const String & logText( )
+    {
+        static String text = []
+        {
+            const char * levels[] = { "DEBUG", "INFO ", "INFO ", "INFO ", "WARN ", "ERROR" };
+            const char * paths[] = { "/api/v1/items", "/api/v1/users", "/static/app.js", "/health", "/api/v2/search" };
+            const int statuses[] = { 200, 200, 200, 200, 201, 304, 404, 500 };
+
+            Random random;
+            String result;
+            for ( size_t index = 0; index < 100000; index++ )
+            {
+                result += format( "2026-03-14 09:%:%.% % [worker-%] request id=% path=%/% status=% bytes=% elapsed=%ms\n",
+                    Integer::toDecimal( (int32)( index / 6000 % 60 ), 2, true ), Integer::toDecimal( (int32)( index / 100 % 60 ), 2, true ),
+                    Integer::toDecimal( (int32)( index % 1000 ), 3, true ), levels[random.below( 6 )], random.below( 16 ),
+                    random.next( ), paths[random.below( 5 )], random.below( 100000 ), statuses[random.below( 8 )],
+                    random.below( 1 << 20 ), random.below( 2000 ) );
+            }
+            return result;
+        }( );
+        return text;
+    }
+
+
+    const bit::Object & decoded( const String & text )
+    {
+        static std::map<const void *, bit::Object> objects;
+        auto itr = objects.find( &text );
+        if ( itr == objects.end( ) )
+            { itr = objects.emplace( &text, bit::decode( text ) ).first; }
+        return itr->second;
+    }
+
+
+    const String & binary( const String & text )
+    {
+        static std::map<const void *, String> messages;
+        auto itr = messages.find( &text );
+        if ( itr == messages.end( ) )
+            { itr = messages.emplace( &text, bit::textToBinary( text ) ).first; }
+        return itr->second;
+    }
+
+
+    //  an input which copies from memory in 64k reads, like a file
+    struct MemorySource
+        : public Input::Source
+    {
+        MemorySource( Memory text ) : text( text ) { }
+
+        bool isOpen( ) const override
+            { return pos < text.length( ); }
+
+        Memory readsome( Memory dst, std::error_code & ) override
+        {
+            Memory src = text.substr( pos, std::min<size_t>( dst.length( ), 64 * 1024 ) );
+            pos += src.length( );
+            return Memory::copy( dst, src );
+        }
+
+        Memory text;
+        size_t pos = 0;
+    };
+
+
+    size_t decode( const String & text )
+    {
+        benchmark::keep( bit::decode( text ).isEmpty( ) );
+        return text.length( );
+    }
+
+
+    size_t decodeEvents( const String & text )
+    {
+        size_t count = 0;
+        bit::Decoder::Handler handler;
+        handler.onValue = [&count]( Memory, Memory ) { count++; };
+
+        DataBuffer buffer{ text };
+        bit::Decoder decoder{ handler };
+        while ( buffer.getable( ) && decoder.decode( buffer ) )
+            { }
+        benchmark::keep( count );
+        return text.length( );
+    }
+
+
+    //  the same document as BitB, measured in bytes of the text so the rates compare with bit.decode
+    size_t decodeBinary( const String & text )
+    {
+        benchmark::keep( bit::decodeBinary( binary( text ) ).isEmpty( ) );
+        return text.length( );
+    }
+
+
+    size_t decodeBinaryEvents( const String & text )
+    {
+        size_t count = 0;
+        bit::Decoder::Handler handler;
+        handler.onValue = [&count]( Memory, Memory ) { count++; };
+
+        bit::BinaryDecoder{ handler }.decode( binary( text ) );
+        benchmark::keep( count );
+        return text.length( );
+    }
+}
+
+
+
+BENCHMARK_CASE( "bit.decode.flat" ) { return decode( flatDocument( ) ); }
+BENCHMARK_CASE( "bit.decode.deep" ) { return decode( deepDocument( ) ); }
+BENCHMARK_CASE( "bit.decode.raw" ) { return decode( rawDocument( ) ); }
+BENCHMARK_CASE( "bit.decode.escaped" ) { return decode( escapedDocument( ) ); }
+BENCHMARK_CASE( "bit.decode.events.flat" ) { return decodeEvents( flatDocument( ) ); }
+BENCHMARK_CASE( "bit.decode.events.escaped" ) { return decodeEvents( escapedDocument( ) ); }
+BENCHMARK_CASE( "bitb.decode.flat" ) { return decodeBinary( flatDocument( ) ); }
+BENCHMARK_CASE( "bitb.decode.events.flat" ) { return decodeBinaryEvents( flatDocument( ) ); }
+
+
+BENCHMARK_CASE( "bit.encode.flat" ) { return decoded( flatDocument( ) ).encode( ).length( ); }
+BENCHMARK_CASE( "bit.encode.deep" ) { return decoded( deepDocument( ) ).encode( ).length( ); }
+BENCHMARK_CASE( "bit.encode.raw" ) { return valueObject( ).encodeRaw( ).length( ); }
+BENCHMARK_CASE( "bit.encode.escaped" ) { return valueObject( ).encode( ).length( ); }
+BENCHMARK_CASE( "bit.encode.compact" ) { return decoded( deepDocument( ) ).encode( bit::Object::EncodeFormat::Compact ).length( ); }
+
+
+BENCHMARK_CASE( "bit.append.empty" )
+{
+    bit::Object object;
+    object.append( decoded( flatDocument( ) ) );
+    return flatDocument( ).length( );
+}
+
+
+BENCHMARK_CASE( "bit.append.overwrite" )
+{
+    static bit::Object object = decoded( deepDocument( ) ).copy( );
+    object.append( decoded( deepDocument( ) ) );
+    return deepDocument( ).length( );
+}
+
+
+BENCHMARK_CASE( "bit.encode.cached" )
+{
+    static bit::Object object = [] { auto object = decoded( deepDocument( ) ).copy( ); object.enableEncodeCache( ); return object; }( );
+    static uint64_t count = 0;
+    object["bench.count"] = String::format( "%", count++ );
+    return object.encodeCached( ).length( );
+}
+
+
+BENCHMARK_CASE( "bit.sharded.append" )
+{
+    static bit::ShardedObject object;
+    object.append( decoded( flatDocument( ) ) );
+    return flatDocument( ).length( );
+}
+
+
+BENCHMARK_CASE( "bit.sharded.snapshot" )
+{
+    static bit::ShardedObject object = [] { bit::ShardedObject object; object.append( decoded( deepDocument( ) ) ); return object; }( );
+    return object.encode( ).length( );
+}
+
+
+BENCHMARK_CASE( "memory.find.sequence" )
+{
+    Memory text = logText( );
+    size_t count = 0;
+    for ( size_t pos = text.find( "status=500" ); pos != Memory::npos; pos = text.find( "status=500", pos + 1 ) )
+        { count++; }
+    benchmark::keep( count );
+    return text.length( );
+}
+
+
+BENCHMARK_CASE( "memory.find.char" )
+{
+    Memory text = logText( );
+    size_t count = 0;
+    for ( size_t pos = text.find( '\n' ); pos != Memory::npos; pos = text.find( '\n', pos + 1 ) )
+        { count++; }
+    benchmark::keep( count );
+    return text.length( );
+}
+
+
+BENCHMARK_CASE( "memory.split" )
+{
+    Memory text = logText( );
+    benchmark::keep( text.split( "\n" ).size( ) );
+    return text.length( );
+}
+
+
+BENCHMARK_CASE( "string.format" )
+{
+    size_t bytes = 0;
+    for ( int index = 0; index < 10000; index++ )
+        { bytes += String::format( "item[%] : name='item %' port='%' ratio='%'\n", index, index, 1024 + index, index * 0.5 ).length( ); }
+    return bytes;
+}
+
+
+BENCHMARK_CASE( "linereader" )
+{
+    Input input{ std::make_shared<MemorySource>( logText( ) ) };
+    size_t count = 0;
+    for ( auto & cursor : input.lines( ) )
+        { count += cursor.line.length( ); }
+    benchmark::keep( count );
+    return logText( ).length( );
+}
+
+
+BENCHMARK_CASE( "input.readAll" )
+{
+    Input input{ std::make_shared<MemorySource>( logText( ) ) };
+    return input.readAll( ).length( );
+}
+
+
+#endif
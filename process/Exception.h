@@ -11,12 +11,12 @@ namespace cpp
     {
     public:
 		Exception( const char * message )
-			: std::exception( message ) { }
+			: m_what( message ) { }
 		Exception( std::string message )
 			: m_what( std::move( message ) ) { }
 
-		const char * what( ) const override
-			{ return m_what.empty( ) ? std::exception::what( ) : m_what.c_str( ); }
+		const char * what( ) const noexcept override
+			{ return m_what.c_str( ); }
 
     protected:
         std::string m_what;
@@ -1,12 +1,17 @@
 #ifndef TEST
 
+#ifdef _WIN32
 #include "Platform.h"
+#else
+#include <pthread.h>
+#endif
 #include "Thread.h"
 
 namespace cpp
 {
     thread_local Thread::Info::ptr_t Thread::s_info = std::make_shared<Info>( );
 
+#ifdef _WIN32
     void setThreadName( const char * threadName )
     {
         struct THREADNAME_INFO
@@ -31,6 +36,13 @@ namespace cpp
         {
         }
     }
+#else
+    void setThreadName( const char * threadName )
+    {
+        std::string name{ threadName };
+        pthread_setname_np( pthread_self( ), name.substr( 0, 15 ).c_str( ) );     // at most 15 characters on linux
+    }
+#endif
 
     std::string Thread::name( )
     {
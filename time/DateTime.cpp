@@ -5,6 +5,11 @@
 namespace cpp
 {
 
+#ifndef _MSC_VER
+	inline void localtime_s( std::tm * result, const time_t * t ) { localtime_r( t, result ); }
+	inline void gmtime_s( std::tm * result, const time_t * t ) { gmtime_r( t, result ); }
+#endif
+
 	int localTimeDiffSeconds( time_t t )
 	{
 		std::tm local, gmt;
@@ -1,9 +1,19 @@
 #ifndef TEST
 
+#include <algorithm>
+#include <bit>
 #include <cassert>
+#include <limits>
+
+#if defined( _M_X64 ) || defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
 
 #include <cpp/data/Integer.h>
 #include <cpp/data/DataBuffer.h>
+#include <cpp/io/Input.h>
+#include <cpp/io/Output.h>
+#include <cpp/process/Thread.h>
 
 #include "Bit.h"
 
@@ -205,6 +215,123 @@ namespace cpp::bit
 
 
 
+	//	Segment boundaries of a key, found in one pass.  Segments are delimited by unbracketed periods
+	//	and each records where its trailing "[id]" begins, so prefixes and array names are O(1) slices.
+	//		e.g. "a.b[x].c" -> prefix( 2 ) == "a.b[x]", arrayName( 2 ) == "a.b", arrayItem( 2 ) == "x"
+	class KeySegments
+	{
+	public:
+											KeySegments( Memory path );
+
+		size_t								size( ) const;
+		KeyPath								prefix( size_t count ) const;				// first count segments, prefix( size( ) - 1 ) is the parent
+		KeyPath								name( size_t count ) const;				// last segment of prefix( count )
+
+		KeyPath								arrayName( size_t count ) const;			// empty unless prefix( count ) is an array item
+		KeyPath								arrayItem( size_t count ) const;
+
+	private:
+		struct Segment
+		{
+			size_t							begin;
+			size_t							end;
+			size_t							bracket;									// npos unless the segment ends with "[id]"
+		};
+
+		const Segment &						at( size_t count ) const;
+
+		static const size_t					InlineSize = 16;
+
+		Memory								m_path;
+		size_t								m_size = 0;
+		Segment								m_inline[InlineSize];
+		std::vector<Segment>				m_overflow;
+	};
+
+
+	KeySegments::KeySegments( Memory path )
+		: m_path( path )
+	{
+		size_t len = path.length( );
+		if ( !len )
+			{ return; }
+
+		size_t begin = 0;
+		size_t bracket = Memory::npos;
+		int depth = 0;
+		for ( size_t pos = 0; pos <= len; pos++ )
+		{
+			char c = ( pos < len ) ? path[pos] : '.';
+			if ( c == '[' )
+			{
+				if ( depth++ == 0 )
+					{ bracket = pos; }
+			}
+			else if ( c == ']' && depth > 0 )
+			{
+				depth--;
+			}
+			else if ( c == '.' && depth == 0 )
+			{
+				Segment segment{ begin, pos, ( pos > 0 && path[pos - 1] == ']' ) ? bracket : Memory::npos };
+				if ( m_size < InlineSize )
+					{ m_inline[m_size] = segment; }
+				else
+					{ m_overflow.push_back( segment ); }
+				m_size++;
+
+				begin = pos + 1;
+				bracket = Memory::npos;
+			}
+		}
+	}
+
+
+	inline const KeySegments::Segment & KeySegments::at( size_t count ) const
+	{
+		assert( count > 0 && count <= m_size );
+		return ( count <= InlineSize ) ? m_inline[count - 1] : m_overflow[count - 1 - InlineSize];
+	}
+
+
+	inline size_t KeySegments::size( ) const
+		{ return m_size; }
+
+
+	inline KeyPath KeySegments::prefix( size_t count ) const
+	{
+		return count
+			? m_path.substr( 0, at( count ).end )
+			: Memory::Empty;
+	}
+
+
+	inline KeyPath KeySegments::name( size_t count ) const
+	{
+		const Segment & segment = at( count );
+		return m_path.substr( segment.begin, segment.end - segment.begin );
+	}
+
+
+	inline KeyPath KeySegments::arrayName( size_t count ) const
+	{
+		const Segment & segment = at( count );
+		return ( segment.bracket != Memory::npos )
+			? m_path.substr( 0, segment.bracket )
+			: Memory::Empty;
+	}
+
+
+	inline KeyPath KeySegments::arrayItem( size_t count ) const
+	{
+		const Segment & segment = at( count );
+		return ( segment.bracket != Memory::npos )
+			? m_path.substr( segment.bracket + 1, segment.end - segment.bracket - 2 )
+			: Memory::Empty;
+	}
+
+
+
     Key::Key( Memory path, size_t originPos )
         : path( path.data( ), path.length( ) ), origin( originPos )
     {
@@ -308,7 +435,8 @@ namespace cpp::bit
 
     Object decode( Memory text )
     {
-        return decode( DataBuffer{ text } );
+        DataBuffer buffer{ text };
+        return decode( buffer );
     }
 
 
@@ -322,9 +450,121 @@ namespace cpp::bit
             Decoder::Result result = decoder.decode( buffer );
             if ( result.status != Decoder::Status::Ok )
                 { throw Decoder::Exception{ std::move( result ) }; }
-			data += result.getObject();
+			result.applyTo( data );
+        }
+
+        return data;
+    }
+
+
+
+    //  Returns record boundaries which split text into pieces of at least chunkSize bytes.  Chunks only
+    //  begin at unindented lines so no tab-continued key prefix is split from the line it extends.
+    std::vector<size_t> findChunks( Memory text, size_t chunkSize )
+    {
+        std::vector<size_t> bounds{ 0 };
+        size_t len = text.length( );
+        size_t pos = 0;
+        while ( pos < len )
+        {
+            pos = Decoder::findRecordEnd( text, pos );
+            if ( pos == Memory::npos || pos == len )
+                { break; }
+
+            char next = text[pos];
+            if ( pos - bounds.back( ) >= chunkSize && next != '\t' && next != '\n' && next != '/' )
+                { bounds.push_back( pos ); }
         }
+        bounds.push_back( len );
+        return bounds;
+    }
+
+
+    struct DecodeChunk
+    {
+        Memory                              text;
+        Object                              object;
+        std::set<std::string>               removed;        // keys assigned null, which may exist in earlier chunks
+        Decoder::Result                     result;
+    };
+
+
+    void decodeChunk( DecodeChunk & chunk )
+    {
+        Decoder::Handler handler;
+        handler.onValue = [&chunk]( Memory key, Memory value ) 
+        { 
+            chunk.object.at( key ) = value; 
+            if ( !chunk.removed.empty( ) )
+                { chunk.removed.erase( key ); }
+        };
+        handler.onNull = [&chunk]( Memory key ) 
+        { 
+            chunk.object.at( key ) = nullptr; 
+            chunk.removed.insert( key ); 
+        };
+        handler.onErase = [&chunk]( Memory key )
+        {
+            chunk.object.at( key ).erase( );
+        };
+
+        //  the decoder requires each record to end with a newline
+        String terminated;
+        if ( chunk.text.notEmpty( ) && chunk.text[chunk.text.length( ) - 1] != '\n' )
+            { terminated = chunk.text; terminated += '\n'; chunk.text = terminated; }
+
+        Decoder decoder{ std::move( handler ) };
+        DataBuffer buffer{ chunk.text };
+        chunk.result.status = Decoder::Status::Ok;
+        while ( buffer.getable( ) && chunk.result )
+        {
+            chunk.result = decoder.decode( buffer );
+        }
+        chunk.text = nullptr;
+    }
+
+
+    //  Decodes text in chunks on a pool of threads, and then merges the chunks in file order.  Merging
+    //  applies each chunk's null assignments and then appends its object, which gives the same result 
+    //  as a sequential replay.
+    Object decodeParallel( Memory text, size_t threadCount )
+    {
+        static const size_t MinChunkSize = 1024 * 1024;
+
+        if ( threadCount == 0 )
+            { threadCount = std::max<size_t>( std::thread::hardware_concurrency( ), 1 ); }
+
+        size_t chunkSize = std::max<size_t>( text.length( ) / ( threadCount * 4 ), MinChunkSize );
+        std::vector<size_t> bounds = findChunks( text, chunkSize );
 
+        std::vector<DecodeChunk> chunks( bounds.size( ) - 1 );
+        for ( size_t index = 0; index < chunks.size( ); index++ )
+            { chunks[index].text = text.substr( bounds[index], bounds[index + 1] - bounds[index] ); }
+
+        std::atomic<size_t> nextChunk = 0;
+        auto worker = [&chunks, &nextChunk]( )
+        {
+            for ( size_t index = nextChunk++; index < chunks.size( ); index = nextChunk++ )
+                { decodeChunk( chunks[index] ); }
+        };
+
+        std::vector<Thread> threads;
+        threads.reserve( threadCount );
+        for ( size_t index = 1; index < std::min( threadCount, chunks.size( ) ); index++ )
+            { threads.emplace_back( worker ); }
+        worker( );
+        for ( auto & thread : threads )
+            { thread.join( ); thread.check( ); }
+
+        Object data;
+        for ( auto & chunk : chunks )
+        {
+            if ( !chunk.result )
+                { throw Decoder::Exception{ std::move( chunk.result ) }; }
+            for ( auto & key : chunk.removed )
+                { data.at( key ) = nullptr; }
+            data += chunk.object;
+        }
         return data;
     }
 
@@ -394,60 +634,299 @@ namespace cpp::bit
 
     bool Object::hasChild( ) const
     {
-        return firstSubkeyAt( m_key.path ) != m_data->keys.end( );
+        return firstSubkeyAt( m_key.path ) != data( ).keys.end( );
     }
 
 
     bool Object::isNulled( bool recursive ) const
     {
-		KeyPath key = m_key.path;
-		while ( true )
+		KeySegments key{ m_key.path };
+		for ( size_t count = key.size( ); ; count-- )
 		{
-			bool nulled = m_data->nulled.count( key.path ) != 0;
+			bool nulled = data( ).nulled.count( key.prefix( count ).path ) != 0;
 			if ( nulled )
 				{ return true; }
-			if ( !recursive || key.isEmpty( ) )
+			if ( !recursive || count == 0 )
 				{ break; }
-			key = key.parent( );
 		}
 		return false;
     }
 
 
-    // when any key is added, all arrays in the key potentially need to be recorded:
-    //      e.g. root.first[index1].second[index2].something.third[index3].subkey
-    void Object::verifyArraysOnAdd( Memory fullKey )
+    //  The encoded record of each key, and the keys changed since.  Keys are only marked in content which is
+    //  not shared, while shared content may be encoded by many snapshot readers at once, hence the mutex.
+    struct Object::EncodeCache
+    {
+        std::shared_ptr<EncodeCache>        clone( );
+        void                                update( const Content & content, const std::string & key, Encoder & encoder, String & text );
+
+        Mutex                               mutex;
+        bool                                isBuilt = false;
+        bool                                isRaw = false;
+        std::map<std::string, std::string>  records;
+        std::set<std::string>               dirty;                  // keys set or removed
+        std::set<std::string>               cleared;                // keys whose subkeys were all removed
+    };
+
+
+    std::shared_ptr<Object::EncodeCache> Object::EncodeCache::clone( )
+    {
+        auto lock = mutex.lock( );
+        auto result = std::make_shared<EncodeCache>( );
+        result->isBuilt = isBuilt;
+        result->isRaw = isRaw;
+        result->records = records;
+        result->dirty = dirty;
+        result->cleared = cleared;
+        return result;
+    }
+
+
+    //  Encodes the record of key into text with encoder, which writes to text, and caches it.
+    void Object::EncodeCache::update( const Content & content, const std::string & key, Encoder & encoder, String & text )
     {
-        while ( fullKey )
+        auto itr = content.keys.find( key );
+        if ( itr == content.keys.end( ) )
         {
-			Memory arrayName = KeyPath{ fullKey }.arrayName( );
-            if ( arrayName )
-            {
-                Memory recID = KeyPath{ fullKey }.arrayItem( );
-                if ( !m_data->records[arrayName].contains( recID ) )
-					{ m_data->records[arrayName].add( recID ); }
-            }
-			fullKey = KeyPath{ fullKey }.parent( );
+            records.erase( key );
+            return;
+        }
+
+        bool isErased = content.nulled.count( key ) != 0;
+        if ( isErased )
+            { encoder.encodeErase( key ); }
+        if ( itr->second != NullValue || !isErased )
+        {
+            encoder.beginRecord( );
+            encoder.encodeValue( key, ( itr->second != NullValue ) ? Memory{ itr->second } : Memory{ } );
+            encoder.endRecord( );
+        }
+
+        records[key].assign( text.begin( ), text.end( ) );
+        text.clear( );
+    }
+
+
+    void Object::Content::set( Memory key, Memory value )
+    {
+        auto [itr, isNew] = keys.try_emplace( key, value );
+        bool wasValue = !isNew && itr->second != NullValue;
+        if ( !isNew )
+            { itr->second.assign( value.begin( ), value.end( ) ); }
+
+        bool isValue = !( value == NullValue );
+        if ( wasValue != isValue )
+            { countValues( key, 1, isValue ); }
+        if ( !indexes.empty( ) )
+            { indexValue( key, value ); }
+        if ( encodeCache )
+            { encodeCache->dirty.insert( key.toString( ) ); }
+    }
+
+
+    //  Sets key starting from hint, a position at or before key, so keys set in ascending order
+    //  take amortized constant time.  Returns the position of key.
+    Object::map_t::iterator Object::Content::set( map_t::iterator hint, const std::string & key, Memory value )
+    {
+        for ( int steps = 0; hint != keys.end( ) && hint->first < key; hint++ )
+        {
+            if ( ++steps == 8 )
+                { hint = keys.lower_bound( key ); break; }
+        }
+
+        bool isNew = ( hint == keys.end( ) || hint->first != key );
+        bool wasValue = !isNew && hint->second != NullValue;
+        if ( isNew )
+            { hint = keys.emplace_hint( hint, key, value ); }
+        else
+            { hint->second.assign( value.begin( ), value.end( ) ); }
+
+        bool isValue = !( value == NullValue );
+        if ( wasValue != isValue )
+            { countValues( key, 1, isValue ); }
+        if ( !indexes.empty( ) )
+            { indexValue( key, value ); }
+        if ( encodeCache )
+            { encodeCache->dirty.insert( key ); }
+        return hint;
+    }
+
+
+    void Object::Content::remove( Memory key )
+    {
+        auto itr = keys.find( key );
+        if ( itr == keys.end( ) )
+            { return; }
+
+        bool wasValue = itr->second != NullValue;
+        keys.erase( itr );
+        if ( wasValue )
+            { countValues( key, 1, false ); }
+        if ( !indexes.empty( ) )
+            { indexValue( key, NullValue ); }
+        if ( encodeCache )
+            { encodeCache->dirty.insert( key.toString( ) ); }
+    }
+
+
+    //  Subkeys are contiguous in each sorted map, so they are removed as ranges.  Arrays below key lose
+    //  all of their items, and the array items above key are updated once with the number of values removed.
+    void Object::Content::removeSubkeys( Memory key )
+    {
+        if ( encodeCache )
+            { encodeCache->cleared.insert( key.toString( ) ); }
+
+        if ( key.isEmpty( ) )
+        {
+            keys.clear( );
+            records.clear( );
+            liveCounts.clear( );
+            for ( auto & [path, index] : indexes )
+                { index = FieldIndex{ index.type }; }
+            return;
+        }
+
+        std::string lower = key + ".";
+        std::string upper = key + "/";      // '/' follows '.'
+
+        auto first = keys.lower_bound( lower );
+        auto last = keys.lower_bound( upper );
+        size_t count = 0;
+        for ( auto itr = first; itr != last; itr++ )
+        {
+            if ( itr->second != NullValue )
+                { count++; }
+            if ( !indexes.empty( ) )
+                { indexValue( itr->first, NullValue ); }
         }
+        keys.erase( first, last );
+
+        records.erase( records.lower_bound( lower ), records.lower_bound( upper ) );
+        liveCounts.erase( liveCounts.lower_bound( lower ), liveCounts.lower_bound( upper ) );
+
+        if ( count )
+            { countValues( key, count, false ); }
     }
 
 
-    // when any key is removed, all arrays in partial keys need to be removed
-    void Object::verifyArraysOnRemove( Memory fullKey )
+    //  Updates the value count of each array item in key, e.g. root.first[index1].second[index2].subkey.
+    //  An item is added to its array when it gains its first value and removed when it loses its last.
+    void Object::Content::countValues( Memory key, size_t count, bool isAdded )
     {
-        while ( fullKey )
+        KeySegments segments{ key };
+        for ( size_t depth = segments.size( ); depth > 0; depth-- )
         {
-			Memory arrayName = KeyPath{ fullKey }.arrayName( );
-            if ( arrayName )
+            Memory arrayName = segments.arrayName( depth );
+            if ( !arrayName )
+                { continue; }
+
+            Memory itemID = segments.arrayItem( depth );
+            if ( isAdded )
+            {
+                size_t & values = liveCounts[segments.prefix( depth ).path];
+                if ( values == 0 )
+                {
+                    auto & items = records[arrayName];
+                    if ( !items.contains( itemID ) )
+                        { items.add( itemID ); }
+                }
+                values += count;
+                continue;
+            }
+
+            auto itr = liveCounts.find( segments.prefix( depth ).path );
+            if ( itr == liveCounts.end( ) )
+                { continue; }
+
+            assert( itr->second >= count );
+            itr->second -= count;
+            if ( itr->second > 0 )
+                { continue; }
+
+            liveCounts.erase( itr );
+            auto array = records.find( arrayName );
+            if ( array != records.end( ) )
             {
-                if ( !hasKeyWithValueAt( fullKey ) )
-					{ m_data->records.erase( arrayName ); }
+                array->second.remove( itemID );
+                if ( array->second.size( ) == 0 )
+                    { records.erase( array ); }
             }
-            fullKey = KeyPath{ fullKey }.parent( );
         }
     }
 
 
+    //  Returns true if key is the field of an item in array, i.e. <array>[<itemID>].<field>
+    bool isIndexedField( Memory key, const std::string & array, const std::string & field, Memory & itemID )
+    {
+        size_t begin = array.length( ) + 1;
+        if ( key.length( ) < begin + field.length( ) + 3 || key[array.length( )] != '['
+            || key.substr( 0, array.length( ) ) != array || key.substr( key.length( ) - field.length( ) ) != field )
+            { return false; }
+
+        size_t end = key.length( ) - field.length( ) - 2;
+        if ( key[end] != ']' || key[end + 1] != '.' )
+            { return false; }
+
+        itemID = key.substr( begin, end - begin );
+        return itemID.findFirstOf( "[]" ) == Memory::npos;
+    }
+
+
+    void Object::Content::indexValue( Memory key, Memory value )
+    {
+        for ( auto & [path, index] : indexes )
+        {
+            Memory itemID;
+            if ( !isIndexedField( key, path.first, path.second, itemID ) )
+                { continue; }
+
+            if ( value == NullValue )
+                { index.erase( itemID ); }
+            else
+                { index.insert( itemID, value ); }
+        }
+    }
+
+
+    void Object::FieldIndex::insert( Memory itemID, Memory value )
+    {
+        auto [itr, isNew] = values.try_emplace( itemID, value );
+        if ( !isNew )
+        {
+            if ( itr->second == value )
+                { return; }
+            erase( itemID );
+            itr = values.emplace( itemID, value ).first;
+        }
+
+        if ( type == IndexType::Hash )
+            { hashed[itr->second].insert( itr->first ); }
+        else
+            { ordered.emplace( itr->second, itr->first ); }
+    }
+
+
+    void Object::FieldIndex::erase( Memory itemID )
+    {
+        auto itr = values.find( itemID );
+        if ( itr == values.end( ) )
+            { return; }
+
+        if ( type == IndexType::Hash )
+        {
+            auto ids = hashed.find( itr->second );
+            ids->second.erase( itr->first );
+            if ( ids->second.empty( ) )
+                { hashed.erase( ids ); }
+        }
+        else
+        {
+            ordered.erase( { itr->second, itr->first } );
+        }
+        values.erase( itr );
+    }
+
+
     const Key & Object::key( ) const
     {
         return m_key;
@@ -456,8 +935,8 @@ namespace cpp::bit
 
     Memory Object::value( ) const
     {
-        auto & itr = m_data->keys.find( m_key.path );
-        if ( itr != m_data->keys.end( ) && itr->second != NullValue )
+        auto itr = data( ).keys.find( m_key.path );
+        if ( itr != data( ).keys.end( ) && itr->second != NullValue )
             { return itr->second; }
         return nullptr;
     }
@@ -486,14 +965,9 @@ namespace cpp::bit
     Object & Object::assign( Memory value )
     {
 		if ( !value && !isNulled( false ) )
-			{ m_data->keys.erase( m_key.path ); }
+			{ writable( ).remove( m_key.path ); }
 		else
-			{ m_data->keys.insert_or_assign( m_key.path, value.isNull( ) ? NullValue : value ); }
-
-        if ( !value )
-            { verifyArraysOnRemove( m_key.path ); }
-        else 
-            { verifyArraysOnAdd( m_key.path ); }
+			{ writable( ).set( m_key.path, value.isNull( ) ? NullValue : value ); }
 
         return *this;
     }
@@ -505,18 +979,64 @@ namespace cpp::bit
     }
 
 
+    //  Merges the keys at and below object into this key in one pass over both sorted key maps.  A
+    //  nulled key in object erases the matching subtree here before its own value and subkeys are set,
+    //  so a record like "data : null b='b'" replaces data.
     Object & Object::append( const Object & object )
     {
-        if ( object.isNulled( ) )
-            { erase( ); }
-        
-        assign( object.value( ) );
+        //  a view of this object's own content is merged from a snapshot, so writes cannot move it
+        Object source = ( object.m_data->content == m_data->content ) ? object.snapshot( ) : object;
+        auto & from = source.data( );
+        auto & to = writable( );
+
+        const std::string & sourcePath = source.m_key.path;
+        size_t sourceLen = sourcePath.empty( ) ? 0 : sourcePath.length( ) + 1;
+        std::string key = m_key.path;
+        size_t keyLen = key.length( );
+
+        auto nulled = from.nulled.lower_bound( sourcePath );
+        auto hint = to.keys.lower_bound( key );
+        auto merge = [&]( const std::string & sourceKey, const std::string & value )
+        {
+            key.resize( keyLen );
+            if ( sourceKey.length( ) > sourceLen )
+            {
+                if ( keyLen )
+                    { key += '.'; }
+                key.append( sourceKey, sourceLen );
+            }
+
+            while ( nulled != from.nulled.end( ) && *nulled < sourceKey )
+                { nulled++; }
+            if ( nulled != from.nulled.end( ) && *nulled == sourceKey )
+            {
+                to.removeSubkeys( key );
+                to.nulled.insert( key );
+                hint = to.set( to.keys.lower_bound( key ), key, NullValue );
+            }
+
+            if ( value != NullValue )
+                { hint = to.set( hint, key, value ); }
+        };
 
-        for ( auto & item : object.listValues( ) )
-            { at( item.key( ).name( ) ) = item.value( ); }
+        auto itr = from.keys.find( sourcePath );
+        if ( itr != from.keys.end( ) )
+            { merge( itr->first, itr->second ); }
 
-        for ( auto & item : object.listChildren( ) )
-            { at( item.key( ) ).append( item.clip( ) ); }
+        auto last = from.keys.end( );
+        itr = from.keys.begin( );
+        if ( !sourcePath.empty( ) )
+        {
+            itr = from.keys.lower_bound( sourcePath + "." );
+            last = from.keys.lower_bound( sourcePath + "/" );       // '/' follows '.'
+            nulled = from.nulled.lower_bound( sourcePath + "." );
+        }
+
+        for ( ; itr != last; itr++ )
+        {
+            if ( !sourcePath.empty( ) || !itr->first.empty( ) )
+                { merge( itr->first, itr->second ); }
+        }
 
         return *this;
     }
@@ -531,15 +1051,9 @@ namespace cpp::bit
 	//  clear() means remove entries for (without nullifying)
     void Object::clear( )
     {
-        std::vector<String> subkeys;
-        for ( auto & cursor : listSubkeys( ) )
-            { subkeys.push_back( cursor.key( ).path ); }
-
-        for ( auto & subkey : subkeys )
-            { m_data->keys.erase( subkey.data ); verifyArraysOnRemove( subkey ); }
-
-        m_data->keys.erase( m_key.path );
-        verifyArraysOnRemove( m_key.path );
+        auto & content = writable( );
+        content.removeSubkeys( m_key.path );
+        content.remove( m_key.path );
     }
 
 
@@ -548,9 +1062,9 @@ namespace cpp::bit
     {
 		clear( );
 
-        m_data->nulled.insert( m_key.path );
-        m_data->keys.insert_or_assign( m_key.path, NullValue );
-		verifyArraysOnRemove( m_key.path );
+        auto & content = writable( );
+        content.nulled.insert( m_key.path );
+        content.set( m_key.path, NullValue );
     }
 
 
@@ -622,11 +1136,44 @@ namespace cpp::bit
     }
 
 
+    const Object::Content & Object::data( ) const
+    {
+        return *m_data->content;
+    }
+
+
+    Object::Content & Object::writable( )
+    {
+        auto & content = m_data->content;
+        if ( content->isShared.value.load( std::memory_order_acquire ) )
+        {
+            content = std::make_shared<Content>( *content );      // the copy starts unshared
+            if ( content->encodeCache )
+                { content->encodeCache = content->encodeCache->clone( ); }
+        }
+        return *content;
+    }
+
+
+    //  The snapshot shares this object's content, which is frozen from then on.  The next write
+    //  through this object (or any view of it) copies the content first, so the snapshot never changes.
+    Object Object::snapshot( ) const
+    {
+        auto & content = m_data->content;
+        content->isShared.value.store( true, std::memory_order_release );
+
+        Object result;
+        result.m_data->content = content;
+        result.m_key = m_key;
+        return result;
+    }
+
+
     Object Object::copy( ) const
     {
         Object result;
 
-        for ( auto & item : listSubkeys( ) )
+        for ( auto && item : listSubkeys( ) )
         {
             result.at( item.key() ) = item.value( );
         }
@@ -641,207 +1188,902 @@ namespace cpp::bit
     }
 
 
-    Memory escapeValue( Memory value, String & buffer )
+    //  The index is kept in the content, so it is maintained by every write through any view of this
+    //  object and is copied along with the content by snapshots.
+    void Object::createIndex( Memory field, IndexType type )
     {
-        assert( buffer.isEmpty( ) );
+        auto & content = writable( );
+        auto & index = content.indexes[{ m_key.path, field }];
+        index = FieldIndex{ type };
 
-        size_t rpos = 0;
-        while ( rpos < value.length( ) )
+        std::string first = m_key.path + "[";
+        std::string last = m_key.path + "\\";      // '\\' follows '['
+        for ( auto itr = content.keys.lower_bound( first ); itr != content.keys.end( ) && itr->first < last; itr++ )
         {
-            size_t pos = value.findFirstOf( "\\\'\n\r\t", rpos );
-            if ( pos != Memory::npos || !buffer.isEmpty( ) )
-            {
-                buffer += value.substr( rpos, pos - rpos );
-            }
-            if ( pos == Memory::npos )
-            {
-                break;
-            }
-
-            buffer += '\\' + value[pos];
-            rpos = pos + 1;
+            Memory itemID;
+            if ( itr->second != NullValue && isIndexedField( itr->first, m_key.path, field, itemID ) )
+                { index.insert( itemID, itr->second ); }
         }
-
-        return ( buffer.isEmpty( ) )
-            ? value
-            : Memory{ buffer };
     }
 
 
-    String encodeValue( Memory key, Memory value, bool isRaw )
+    void Object::dropIndex( Memory field )
     {
-        if ( value.isNull( ) )
-        {
-            return String::format( "%=null", key );
-        }
+        if ( data( ).indexes.count( { m_key.path, field } ) )
+            { writable( ).indexes.erase( { m_key.path, field } ); }
+    }
+
 
-        String buffer;
-        if ( !isRaw )
+    std::vector<std::string> Object::findItems( Memory field, Memory value ) const
+    {
+        std::vector<std::string> result;
+        auto & content = data( );
+        auto index = content.indexes.find( { m_key.path, field } );
+        if ( index == content.indexes.end( ) )
         {
-            escapeValue( value, buffer );
-            if ( !buffer.isEmpty( ) )
+            //  without an index, every item is read
+            std::string first = m_key.path + "[";
+            std::string last = m_key.path + "\\";
+            for ( auto itr = content.keys.lower_bound( first ); itr != content.keys.end( ) && itr->first < last; itr++ )
             {
-                value = buffer;
+                Memory itemID;
+                if ( itr->second == value && isIndexedField( itr->first, m_key.path, field, itemID ) )
+                    { result.push_back( itemID ); }
             }
+            return result;
         }
 
-        if ( !isRaw && ( !buffer.isEmpty( ) || value.length( ) <= 16 ) )
+        if ( index->second.type == IndexType::Hash )
         {
-            return String::format( "%='%'", key, value );
+            auto ids = index->second.hashed.find( value );
+            if ( ids != index->second.hashed.end( ) )
+                { result.assign( ids->second.begin( ), ids->second.end( ) ); }
+            return result;
         }
 
-        return String::format( "%=(%)'%'", key, value.length( ), value );
+        auto & ordered = index->second.ordered;
+        for ( auto itr = ordered.lower_bound( { value, "" } ); itr != ordered.end( ) && itr->first == value; itr++ )
+            { result.push_back( itr->second ); }
+        return result;
     }
 
 
-    String encodeObject( const Object & object, bool isRaw, bool includeChildren = true, bool useRecordSelector = true )
+    std::vector<std::string> Object::findItems( Memory field, Memory first, Memory last ) const
     {
-        String result;
-
-        //  special case: if object.isNulled( ) and no subkeys
-        if ( object.isNulled( ) && object.isEmpty( ) )
+        std::vector<std::string> result;
+        auto & content = data( );
+        auto index = content.indexes.find( { m_key.path, field } );
+        if ( index == content.indexes.end( ) || index->second.type != IndexType::Ordered )
         {
-            return object.key( ) + " : null";
+            std::set<std::pair<std::string, std::string>> found;
+            std::string begin = m_key.path + "[";
+            std::string end = m_key.path + "\\";
+            for ( auto itr = content.keys.lower_bound( begin ); itr != content.keys.end( ) && itr->first < end; itr++ )
+            {
+                Memory itemID;
+                Memory value = itr->second;
+                if ( value != NullValue && !( value < first ) && value < last && isIndexedField( itr->first, m_key.path, field, itemID ) )
+                    { found.emplace( itr->second, itemID ); }
+            }
+            for ( auto & item : found )
+                { result.push_back( item.second ); }
+            return result;
         }
 
-        if ( object.key( ).get( ).isEmpty( ) == false || object.isNulled( ) )
-		{
-            result += object.key( );
+        auto & ordered = index->second.ordered;
+        auto end = ordered.lower_bound( { last, "" } );
+        for ( auto itr = ordered.lower_bound( { first, "" } ); itr != end; itr++ )
+            { result.push_back( itr->second ); }
+        return result;
+    }
 
-            result += ( object.isNulled( ) )
-                ? " ::"
-                : " :";
-        }
 
-        if ( object.value( ) )
+    //  Returns the position of the first byte which must be caret-encoded, or npos.  With SSE2 
+    //  the value is scanned 16 bytes at a time so that clean runs can be copied in bulk.
+    size_t findEscape( Memory value, size_t pos )
+    {
+        const char * data = value.data( );
+        size_t len = value.length( );
+
+#if defined( _M_X64 ) || defined( __SSE2__ )
+        const __m128i caret = _mm_set1_epi8( '^' );
+        const __m128i quote = _mm_set1_epi8( '\'' );
+        const __m128i newline = _mm_set1_epi8( '\n' );
+        const __m128i cr = _mm_set1_epi8( '\r' );
+        const __m128i tab = _mm_set1_epi8( '\t' );
+        const __m128i zero = _mm_setzero_si128( );
+
+        for ( ; pos + 16 <= len; pos += 16 )
         {
-            if ( !result.isEmpty( ) )
-                { result += " "; }
-            result += encodeValue( "", object.value( ), isRaw );
+            __m128i bytes = _mm_loadu_si128( (const __m128i *)( data + pos ) );
+            __m128i match = _mm_or_si128(
+                _mm_or_si128( _mm_cmpeq_epi8( bytes, caret ), _mm_cmpeq_epi8( bytes, quote ) ),
+                _mm_or_si128( 
+                    _mm_or_si128( _mm_cmpeq_epi8( bytes, newline ), _mm_cmpeq_epi8( bytes, cr ) ),
+                    _mm_or_si128( _mm_cmpeq_epi8( bytes, tab ), _mm_cmpeq_epi8( bytes, zero ) ) ) );
+            unsigned mask = (unsigned)_mm_movemask_epi8( match );
+            if ( mask )
+                { return pos + std::countr_zero( mask ); }
         }
+#endif
 
-        if ( useRecordSelector )
+        for ( ; pos < len; pos++ )
         {
-            for ( auto & item : object.listValues( ) )
-            {
-                result += " " + encodeValue( item.key( ).name( ), item.value( ), isRaw );
-            }
-
-            if ( includeChildren )
+            switch ( data[pos] )
             {
-                for ( auto & item : object.listChildren( ) )
-                {
-                    result += " " + encodeObject( item, isRaw );
-                }
+            case '^': case '\'': case '\n': case '\r': case '\t': case '\0':
+                return pos;
+            default:
+                break;
             }
         }
-        else
-        {
-            for ( auto & item : object.listSubkeys( ) )
-            {
-                if ( !result.isEmpty( ) )
-                    { result += " "; }
-				result += encodeValue( object.key( ).getRelativeKey( item.key( ) ), item.value( ), isRaw );
-			}
-        }
-        return result;
+        return Memory::npos;
     }
 
 
-    String encodeRowObject( const Object & object, bool isRaw )
+    //  Key tree for EncodeFormat::Compact.  Each node knows the size of its value as it will be written,
+    //  and the size of its subtree for each indent and length of the key text which leads to it.
+    struct CompactNode
     {
-        return encodeObject( object, isRaw ) + '\n';
+        std::map<std::string, CompactNode>  children;               // by key segment, e.g. "region[west]"
+        Memory                              value;
+        bool                                hasValue = false;       // value may be null, i.e. key=null
+        bool                                isErased = false;
+        bool                                isLengthEncoded = false;
+        size_t                              valueLength = 0;        // of "='value'", "=(n)'value'" or "=null"
+        std::map<std::pair<size_t, size_t>, size_t> costs;
+
+        void                                setValue( Memory value );
+        bool                                isInline( ) const;      // written as name='value' on the line above it
+        size_t                              headerCost( size_t tabs, size_t keyLength );
+        size_t                              flatCost( size_t tabs, size_t keyLength );
+        size_t                              cost( size_t tabs, size_t keyLength );
+    };
+
+
+    size_t decimalLength( size_t value )
+    {
+        size_t length = 1;
+        for ( ; value >= 10; value /= 10 )
+            { length++; }
+        return length;
     }
 
 
-    String encodeRowValue( const Object & object, bool isRaw )
+    size_t childKeyLength( size_t keyLength, const std::string & name )
     {
-        String result;
+        return keyLength ? keyLength + 1 + name.length( ) : name.length( );
+    }
 
-        //  special case: if object.isNulled( ) and no subkeys
+
+    //  Ties go to length-encoding, which decodes without unescaping.
+    void CompactNode::setValue( Memory newValue )
+    {
+        hasValue = true;
+        value = newValue;
+        if ( value.isNull( ) )
+        {
+            valueLength = 5;
+            return;
+        }
+
+        size_t escapedLength = 3 + value.length( );
+        for ( size_t pos = findEscape( value, 0 ); pos != Memory::npos; pos = findEscape( value, pos + 1 ) )
+            { escapedLength++; }
+        size_t encodedLength = 5 + decimalLength( value.length( ) ) + value.length( );
+
+        isLengthEncoded = encodedLength <= escapedLength;
+        valueLength = isLengthEncoded ? encodedLength : escapedLength;
+    }
+
+
+    bool CompactNode::isInline( ) const
+    {
+        return hasValue && !isErased && children.empty( );
+    }
+
+
+    //  e.g. "key : ='value' a='1' b='2'\n" followed by the other children indented by one more tab.  An
+    //  erased key can't have its own value on the same line, as "key : null ='value'" is key.null='value'.
+    size_t CompactNode::headerCost( size_t tabs, size_t keyLength )
+    {
+        if ( isErased && hasValue )
+            { return std::numeric_limits<size_t>::max( ); }
+
+        size_t result = tabs + keyLength + 3;
+        if ( isErased )
+            { result += 5; }
+        if ( hasValue )
+            { result += 1 + valueLength; }
+
+        for ( auto & [name, child] : children )
+        {
+            result += child.isInline( )
+                ? 1 + name.length( ) + child.valueLength
+                : child.cost( tabs + 1, name.length( ) );
+        }
+        return result;
+    }
+
+
+    //  e.g. "key : null\nkey='value' key.a='1' key.b='2'\n" followed by the other children at the same indent
+    size_t CompactNode::flatCost( size_t tabs, size_t keyLength )
+    {
+        size_t result = isErased ? tabs + keyLength + 8 : 0;
+        size_t lineLength = hasValue ? keyLength + valueLength : 0;
+        size_t count = hasValue ? 1 : 0;
+
+        for ( auto & [name, child] : children )
+        {
+            if ( child.isInline( ) )
+            {
+                lineLength += childKeyLength( keyLength, name ) + child.valueLength;
+                count++;
+            }
+            else
+                { result += child.cost( tabs, childKeyLength( keyLength, name ) ); }
+        }
+
+        if ( count )
+            { result += tabs + lineLength + count; }
+        return result;
+    }
+
+
+    size_t CompactNode::cost( size_t tabs, size_t keyLength )
+    {
+        auto [itr, isAdded] = costs.try_emplace( std::make_pair( tabs, keyLength ), 0 );
+        if ( isAdded )
+        {
+            itr->second = keyLength
+                ? std::min( headerCost( tabs, keyLength ), flatCost( tabs, keyLength ) )
+                : flatCost( tabs, keyLength );
+        }
+        return itr->second;
+    }
+
+
+    struct Encoder::Detail
+    {
+        void                                put( Memory data );
+        void                                put( char byte );
+        void                                putDecimal( size_t value );
+        void                                write( Memory data );
+        void                                flush( );
+
+        void                                putEscaped( Memory value, size_t pos );
+        void                                putValue( Memory key, Memory value );
+        void                                putObject( const Object & object, bool includeChildren = true, bool useRecordSelector = true );
+        void                                putRowObject( const Object & object );
+        void                                putRowValue( const Object & object );
+        void                                putRowShallow( const Object & object );
+        void                                putRowDeep( const Object & object );
+        void                                putRowCompact( const Object & object );
+        void                                putCompact( CompactNode & node, size_t tabs, const std::string & key );
+        void                                putCompactValue( Memory key, const CompactNode & node );
+        void                                putDiff( const Object & from, const Object & to );
+
+        bool                                isRaw = false;
+        bool                                needsSpace = false;                 // a value follows the record key or another value
+        Output                              output;
+        DataBuffer *                        dataBuffer = nullptr;
+        String *                            text = nullptr;
+        StringBuffer                        buffer;
+    };
+
+
+    void Encoder::Detail::put( Memory data )
+    {
+        if ( text )
+            { text->append( data ); }
+        else if ( dataBuffer )
+            { dataBuffer->put( data ); }
+        else 
+        {
+            if ( data.length( ) > buffer.putable( ).length( ) )
+                { flush( ); }
+            if ( data.length( ) > buffer.putable( ).length( ) )
+                { write( data ); }
+            else
+                { buffer.put( data ); }
+        }
+    }
+
+
+    void Encoder::Detail::put( char byte )
+    {
+        put( Memory{ &byte, 1 } );
+    }
+
+
+    void Encoder::Detail::putDecimal( size_t value )
+    {
+        char digits[24];
+        char * pos = digits + sizeof( digits );
+        do
+        {
+            *--pos = (char)( '0' + value % 10 );
+            value /= 10;
+        } while ( value );
+        put( Memory{ pos, digits + sizeof( digits ) } );
+    }
+
+
+    //  Writes all of data, however little each write takes.  A closed output throws rather than losing it.
+    void Encoder::Detail::write( Memory data )
+    {
+        while ( data.notEmpty( ) )
+        {
+            check<Output::Exception>( output.isOpen( ), std::make_error_code( std::errc::connection_aborted ) );
+            Memory written = output.write( data );
+            check<Output::Exception>( written.notEmpty( ), std::make_error_code( std::errc::io_error ) );
+            data = data.substr( written.length( ) );
+        }
+    }
+
+
+    void Encoder::Detail::flush( )
+    {
+        if ( buffer.getable( ) )
+            { write( buffer.getAll( ) ); }
+        buffer.clear( );
+    }
+
+
+    //  writes value with caret-encoding, starting from the first byte that needs it
+    void Encoder::Detail::putEscaped( Memory value, size_t pos )
+    {
+        size_t rpos = 0;
+        while ( pos != Memory::npos )
+        {
+            put( value.substr( rpos, pos - rpos ) );
+            switch ( value[pos] )
+            {
+            case '\n': put( "^n" ); break;
+            case '\r': put( "^r" ); break;
+            case '\t': put( "^t" ); break;
+            case '\0': put( "^0" ); break;
+            default: put( '^' ); put( value[pos] ); break;
+            }
+            rpos = pos + 1;
+            pos = findEscape( value, rpos );
+        }
+        put( value.substr( rpos ) );
+    }
+
+
+    void Encoder::Detail::putValue( Memory key, Memory value )
+    {
+        put( key );
+        if ( value.isNull( ) )
+        {
+            put( "=null" );
+            return;
+        }
+
+        size_t escapePos = isRaw ? Memory::npos : findEscape( value, 0 );
+        if ( !isRaw && ( escapePos != Memory::npos || value.length( ) <= 16 ) )
+        {
+            put( "='" );
+            putEscaped( value, escapePos );
+            put( '\'' );
+            return;
+        }
+
+        put( "=(" );
+        putDecimal( value.length( ) );
+        put( ")'" );
+        put( value );
+        put( '\'' );
+    }
+
+
+    void Encoder::Detail::putObject( const Object & object, bool includeChildren, bool useRecordSelector )
+    {
+        //  special case: if object.isNulled( ) and no subkeys
+        if ( object.isNulled( ) && object.isEmpty( ) )
+        {
+            put( object.key( ).get( ) );
+            put( " : null" );
+            return;
+        }
+
+        bool isEmpty = true;
+        if ( object.key( ).get( ).isEmpty( ) == false || object.isNulled( ) )
+        {
+            put( object.key( ).get( ) );
+            put( object.isNulled( ) ? " ::" : " :" );
+            isEmpty = false;
+        }
+
+        if ( object.value( ) )
+        {
+            if ( !isEmpty )
+                { put( ' ' ); }
+            putValue( "", object.value( ) );
+            isEmpty = false;
+        }
+
+        if ( useRecordSelector )
+        {
+            for ( auto && item : object.listValues( ) )
+            {
+                put( ' ' );
+                putValue( item.key( ).name( ), item.value( ) );
+            }
+
+            if ( includeChildren )
+            {
+                for ( auto && item : object.listChildren( ) )
+                {
+                    put( ' ' );
+                    putObject( item );
+                }
+            }
+        }
+        else
+        {
+            for ( auto && item : object.listSubkeys( ) )
+            {
+                if ( !isEmpty )
+                    { put( ' ' ); }
+                putValue( object.key( ).getRelativeKey( item.key( ) ), item.value( ) );
+                isEmpty = false;
+            }
+        }
+    }
+
+
+    void Encoder::Detail::putRowObject( const Object & object )
+    {
+        putObject( object );
+        put( '\n' );
+    }
+
+
+    void Encoder::Detail::putRowValue( const Object & object )
+    {
+        //  special case: if object.isNulled( ) and no subkeys
         if ( object.isNulled( ) )
         {
-            result += object.key( ) + " : null\n";
+            put( object.key( ).get( ) );
+            put( " : null\n" );
         }
 
         if ( object.value( ) )
         {
-            result += encodeValue( object.key( ), object.value( ), isRaw ) + "\n";
+            putValue( object.key( ), object.value( ) );
+            put( '\n' );
         }
 
-        for ( auto & item : object.listValues( ) )
+        for ( auto && item : object.listValues( ) )
         {
-            result += encodeValue( item.key( ), item.value( ), isRaw ) + "\n";
+            putValue( item.key( ), item.value( ) );
+            put( '\n' );
         }
 
-        for ( auto & item : object.listChildren( ) )
+        for ( auto && item : object.listChildren( ) )
         {
-            result += encodeRowValue( item, isRaw );
+            putRowValue( item );
         }
+    }
 
-        return result;
+
+    void Encoder::Detail::putRowShallow( const Object & object )
+    {
+        putObject( object, false );
+        put( '\n' );
+
+        for ( auto && item : object.listChildren( ) )
+        {
+            putObject( item, true, false );
+            put( '\n' );
+        }
     }
 
 
-    String encodeRowShallow( const Object & object, bool isRaw )
+    void Encoder::Detail::putRowDeep( const Object & object )
     {
-        String result = encodeObject( object, isRaw, false ) + "\n";
+        auto values = object.listValues( );
+        if ( object.value( ).notNull( ) || values.begin( ) != values.end( ) )
+        {
+            putObject( object, false );
+            put( '\n' );
+        }
+        for ( auto && item : object.listChildren( ) )
+        {
+            putRowDeep( item );
+        }
+    }
+
 
-        for ( auto & item : object.listChildren( ) )
+    //  Builds the key tree below object, then writes each node either as a record line with its children
+    //  indented below it, or with its full key on every line, whichever is shorter.  A root:: prefix is
+    //  never shorter than a tab per line, so it is not used.
+    void Encoder::Detail::putRowCompact( const Object & object )
+    {
+        const auto & content = object.data( );
+        const std::string & path = object.key( ).path;
+        KeyPath base{ path };
+
+        CompactNode root;
+        auto nodeAt = [&root, &base]( Memory key ) -> CompactNode &
+        {
+            CompactNode * node = &root;
+            KeySegments segments{ base.getRelativeKey( key ) };
+            for ( size_t count = 1; count <= segments.size( ); count++ )
+                { node = &node->children[segments.name( count ).path.toString( )]; }
+            return *node;
+        };
+
+        for ( auto itr = content.keys.lower_bound( path ); itr != content.keys.end( ); itr++ )
+        {
+            if ( itr->first.compare( 0, path.length( ), path ) != 0 )
+                { break; }
+            if ( !base.isRelated( itr->first ) )
+                { continue; }
+
+            bool isErased = itr->second == NullValue && content.nulled.count( itr->first );
+            if ( !isErased )
+                { nodeAt( itr->first ).setValue( itr->second == NullValue ? Memory{ } : Memory{ itr->second } ); }
+        }
+        for ( auto itr = content.nulled.lower_bound( path ); itr != content.nulled.end( ); itr++ )
         {
-            result += encodeObject( item, isRaw, true, false ) + "\n";
+            if ( itr->compare( 0, path.length( ), path ) != 0 )
+                { break; }
+            if ( base.isRelated( *itr ) )
+                { nodeAt( *itr ).isErased = true; }
         }
 
-        return result;
+        putCompact( root, 0, object.key( ).get( ).toString( ) );
     }
 
 
-    String encodeRowDeep( const Object & object, bool isRaw )
+    void Encoder::Detail::putCompact( CompactNode & node, size_t tabs, const std::string & key )
     {
-        String result;
-        if ( object.value( ).notNull( ) || object.listValues( ).begin( ) != object.listValues( ).end( ) )
+        auto putTabs = [this]( size_t count )
         {
-            result += encodeObject( object, isRaw, false ) + "\n";
+            for ( ; count; count-- )
+                { put( '\t' ); }
+        };
+
+        if ( key.length( ) && node.headerCost( tabs, key.length( ) ) <= node.flatCost( tabs, key.length( ) ) )
+        {
+            putTabs( tabs );
+            put( key );
+            put( node.isErased ? " : null" : " :" );
+            if ( node.hasValue )
+                { put( ' ' ); putCompactValue( Memory::Empty, node ); }
+            for ( auto & [name, child] : node.children )
+            {
+                if ( child.isInline( ) )
+                    { put( ' ' ); putCompactValue( name, child ); }
+            }
+            put( '\n' );
+
+            for ( auto & [name, child] : node.children )
+            {
+                if ( !child.isInline( ) )
+                    { putCompact( child, tabs + 1, name ); }
+            }
+            return;
         }
-        for ( auto & item : object.listChildren( ) )
+
+        if ( node.isErased )
         {
-            result += encodeRowDeep( item, isRaw );
+            putTabs( tabs );
+            put( key );
+            put( " : null\n" );
+        }
+
+        bool isLineEmpty = true;
+        auto beginValue = [&]( )
+        {
+            isLineEmpty ? putTabs( tabs ) : put( ' ' );
+            isLineEmpty = false;
+        };
+
+        if ( node.hasValue )
+            { beginValue( ); putCompactValue( key, node ); }
+
+        std::string childKey;
+        for ( auto & [name, child] : node.children )
+        {
+            if ( child.isInline( ) )
+            {
+                beginValue( );
+                if ( key.length( ) )
+                    { put( key ); put( '.' ); }
+                putCompactValue( name, child );
+            }
+        }
+        if ( !isLineEmpty )
+            { put( '\n' ); }
+
+        for ( auto & [name, child] : node.children )
+        {
+            if ( child.isInline( ) )
+                { continue; }
+            childKey = key.length( ) ? key + "." + name : name;
+            putCompact( child, tabs, childKey );
         }
-        return result;
     }
 
 
-    String Object::encode( EncodeFormat rowEncoding ) const
+    void Encoder::Detail::putCompactValue( Memory key, const CompactNode & node )
+    {
+        put( key );
+        if ( node.value.isNull( ) )
+            { put( "=null" ); }
+        else if ( node.isLengthEncoded )
+        {
+            put( "=(" );
+            putDecimal( node.value.length( ) );
+            put( ")'" );
+            put( node.value );
+            put( '\'' );
+        }
+        else
+        {
+            put( "='" );
+            putEscaped( node.value, findEscape( node.value, 0 ) );
+            put( '\'' );
+        }
+    }
+
+
+    Encoder::Encoder( Output output, bool isRaw, size_t bufferSize )
+        : m_detail( std::make_shared<Detail>( ) )
+    {
+        m_detail->isRaw = isRaw;
+        m_detail->output = std::move( output );
+        m_detail->buffer.resize( bufferSize );
+    }
+
+
+    Encoder::Encoder( DataBuffer & buffer, bool isRaw )
+        : m_detail( std::make_shared<Detail>( ) )
+    {
+        m_detail->isRaw = isRaw;
+        m_detail->dataBuffer = &buffer;
+    }
+
+
+    Encoder::Encoder( String & text, bool isRaw )
+        : m_detail( std::make_shared<Detail>( ) )
+    {
+        m_detail->isRaw = isRaw;
+        m_detail->text = &text;
+    }
+
+
+    //  Staged output is dropped unless flush( ) was called, since a write error could not be thrown from here.
+    Encoder::~Encoder( )
+    {
+    }
+
+
+    //  Writes the records which turn from into to when replayed, in one merge pass over both sorted key
+    //  maps.  Keys which are nulled in to but not in from are erased ("key : null") as the pass reaches
+    //  them, and the receiver then holds nothing below them.  Other differences are single assignments
+    //  or "key=null" removals.  Nulling cannot be undone, so keys nulled in from stay nulled.
+    //  Both must be root objects: the pass covers whole content maps, and a view's records are written
+    //  with full keys, so a diff of two views would also carry everything outside them.
+    void Encoder::Detail::putDiff( const Object & from, const Object & to )
+    {
+        cpp::check<std::invalid_argument>( from.key( ).path.empty( ) && to.key( ).path.empty( ),
+            "bit::diff( ) : from and to must be root objects" );
+
+        auto & fromData = from.data( );
+        auto & toData = to.data( );
+
+        std::vector<Memory> erased;
+        std::set_difference( toData.nulled.begin( ), toData.nulled.end( ), fromData.nulled.begin( ), fromData.nulled.end( ),
+            std::back_inserter( erased ) );
+
+        std::vector<Memory> cleared;      // enclosing erased keys
+        auto nextErase = erased.begin( );
+        auto fromItr = fromData.keys.begin( );
+        auto toItr = toData.keys.begin( );
+        while ( fromItr != fromData.keys.end( ) || toItr != toData.keys.end( ) )
+        {
+            Memory key = ( toItr == toData.keys.end( ) || ( fromItr != fromData.keys.end( ) && fromItr->first < toItr->first ) )
+                ? fromItr->first
+                : toItr->first;
+
+            for ( ; nextErase != erased.end( ) && !( key < *nextErase ); nextErase++ )
+            {
+                put( *nextErase );
+                put( " : null\n" );
+                while ( !cleared.empty( ) && !KeyPath{ cleared.back( ) }.isRelated( *nextErase ) )
+                    { cleared.pop_back( ); }
+                cleared.push_back( *nextErase );
+            }
+            while ( !cleared.empty( ) && !KeyPath{ cleared.back( ) }.isRelated( key ) )
+                { cleared.pop_back( ); }
+
+            Memory fromValue;
+            bool hasFrom = false;
+            if ( fromItr != fromData.keys.end( ) && fromItr->first == key )
+                { fromValue = fromItr->second; hasFrom = true; fromItr++; }
+            if ( !cleared.empty( ) )
+            {
+                hasFrom = ( key == cleared.back( ) );
+                fromValue = NullValue;
+            }
+
+            Memory toValue;
+            bool hasTo = false;
+            if ( toItr != toData.keys.end( ) && toItr->first == key )
+                { toValue = toItr->second; hasTo = true; toItr++; }
+
+            if ( hasTo == hasFrom && ( !hasTo || toValue == fromValue ) )
+                { continue; }
+
+            putValue( key, ( hasTo && toValue != NullValue ) ? toValue : nullptr );
+            put( '\n' );
+        }
+
+        for ( ; nextErase != erased.end( ); nextErase++ )
+        {
+            put( *nextErase );
+            put( " : null\n" );
+        }
+    }
+
+
+
+    void Encoder::encode( const Object & object, Object::EncodeFormat rowEncoding )
     {
         switch ( rowEncoding )
         {
-        case EncodeFormat::Value:
-            return encodeRowValue( *this, false );
-        case EncodeFormat::Child:
-            return encodeRowShallow( *this, false );
-        case EncodeFormat::Leaf:
-            return encodeRowDeep( *this, false );
-        case EncodeFormat::Object:
+        case Object::EncodeFormat::Value:
+            m_detail->putRowValue( object );
+            break;
+        case Object::EncodeFormat::Child:
+            m_detail->putRowShallow( object );
+            break;
+        case Object::EncodeFormat::Leaf:
+            m_detail->putRowDeep( object );
+            break;
+        case Object::EncodeFormat::Compact:
+            m_detail->putRowCompact( object );
+            break;
+        case Object::EncodeFormat::Object:
         default:
-            return encodeRowObject( *this, false );
+            m_detail->putRowObject( object );
+            break;
+        }
+    }
+
+
+    void Encoder::encodeDiff( const Object & from, const Object & to )
+    {
+        m_detail->putDiff( from, to );
+    }
+
+
+    void Encoder::beginRecord( Memory key )
+    {
+        auto & detail = *m_detail;
+        detail.needsSpace = key.notEmpty( );
+        if ( key )
+        {
+            detail.put( key );
+            detail.put( " :" );
         }
     }
 
 
+    void Encoder::encodeValue( Memory name, Memory value )
+    {
+        auto & detail = *m_detail;
+        if ( detail.needsSpace )
+            { detail.put( ' ' ); }
+        detail.putValue( name, value );
+        detail.needsSpace = true;
+    }
+
+
+    void Encoder::endRecord( )
+    {
+        m_detail->put( '\n' );
+        m_detail->needsSpace = false;
+    }
+
+
+    void Encoder::encodeErase( Memory key )
+    {
+        m_detail->put( key );
+        m_detail->put( " : null\n" );
+        m_detail->needsSpace = false;
+    }
+
+
+    void Encoder::flush( )
+    {
+        m_detail->flush( );
+        m_detail->output.flush( );
+    }
+
+
+    String diff( const Object & from, const Object & to, bool isRaw )
+    {
+        String result;
+        Encoder{ result, isRaw }.encodeDiff( from, to );
+        return result;
+    }
+
+
+    String Object::encode( EncodeFormat rowEncoding ) const
+    {
+        String result;
+        Encoder{ result, false }.encode( *this, rowEncoding );
+        return result;
+    }
+
+
     String Object::encodeRaw( EncodeFormat rowEncoding ) const
     {
-        switch ( rowEncoding )
+        String result;
+        Encoder{ result, true }.encode( *this, rowEncoding );
+        return result;
+    }
+
+
+    void Object::enableEncodeCache( )
+    {
+        auto & content = writable( );
+        if ( !content.encodeCache )
+            { content.encodeCache = std::make_shared<EncodeCache>( ); }
+    }
+
+
+    //  Brings the cached records up to date, re-encoding only the keys changed since the last call, and
+    //  joins the records at and below this key.  Without a cache, every record is encoded.
+    String Object::encodeCached( bool isRaw ) const
+    {
+        const Content & content = data( );
+        auto cache = content.encodeCache ? content.encodeCache : std::make_shared<EncodeCache>( );
+        auto lock = cache->mutex.lock( );
+
+        String text;
+        Encoder encoder{ text, isRaw };
+        if ( !cache->isBuilt || cache->isRaw != isRaw )
         {
-        case EncodeFormat::Value:
-            return encodeRowValue( *this, true );
-        case EncodeFormat::Child:
-            return encodeRowShallow( *this, true );
-        case EncodeFormat::Leaf:
-            return encodeRowDeep( *this, true );
-        case EncodeFormat::Object:
-        default:
-            return encodeRowObject( *this, true );
+            cache->records.clear( );
+            for ( const auto & [key, value] : content.keys )
+                { cache->update( content, key, encoder, text ); }
+            cache->isBuilt = true;
+            cache->isRaw = isRaw;
+        }
+        else
+        {
+            auto & records = cache->records;
+            for ( const auto & key : cache->cleared )
+            {
+                if ( key.empty( ) )
+                    { records.clear( ); }
+                else
+                    { records.erase( records.lower_bound( key + "." ), records.lower_bound( key + "/" ) ); }
+            }
+            for ( const auto & key : cache->dirty )
+                { cache->update( content, key, encoder, text ); }
         }
+        cache->cleared.clear( );
+        cache->dirty.clear( );
+
+        String result;
+        const std::string & path = m_key.path;
+        KeyPath base{ path };
+        for ( auto itr = cache->records.lower_bound( path ); itr != cache->records.end( ); itr++ )
+        {
+            if ( itr->first.compare( 0, path.length( ), path ) != 0 )
+                { break; }
+            if ( base.isRelated( itr->first ) )
+                { result += itr->second; }
+        }
+        return result;
     }
 
 
@@ -853,25 +2095,25 @@ namespace cpp::bit
 
     Object::iterator_t Object::firstSubkeyAt( Memory fullkey ) const
     {
-		auto itr = m_data->keys.lower_bound( fullkey + "." );
+		auto itr = data( ).keys.lower_bound( fullkey + "." );
         return findSubkeyAt( fullkey, itr );
     }
 
 
     Object::iterator_t Object::nextSubkeyAt( Memory fullkey, iterator_t itr ) const
     {
-		assert( itr != m_data->keys.end( ) );
+		assert( itr != data( ).keys.end( ) );
         return findSubkeyAt( fullkey, ++itr );
     }
 
 
     Object::iterator_t Object::findSubkeyAt( Memory fullkey, iterator_t itr ) const
     {
-		if ( itr != m_data->keys.end( ) )
+		if ( itr != data( ).keys.end( ) )
 		{
 			Memory subkey = itr->first;
 			if ( !KeyPath{ fullkey }.isRelated( subkey ) )
-				{ itr = m_data->keys.end( ); }
+				{ itr = data( ).keys.end( ); }
 		}
 		return itr;
     }
@@ -880,29 +2122,29 @@ namespace cpp::bit
 	Object::iterator_t Object::firstChildAt( Memory fullkey ) const
 	{
 		auto itr = fullkey.isEmpty( )
-			? m_data->keys.begin( )
-			: m_data->keys.lower_bound( fullkey + "." );
+			? data( ).keys.begin( )
+			: data( ).keys.lower_bound( fullkey + "." );
 		return findChildAt( fullkey, itr );
 	}
 
 
 	Object::iterator_t Object::nextChildAt( Memory fullkey, iterator_t itr ) const
 	{
-		assert( itr != m_data->keys.end( ) );
+		assert( itr != data( ).keys.end( ) );
 
 		String lastChild = KeyPath{ fullkey }.getChildKey( itr->first ).path + '/';
-		itr = m_data->keys.upper_bound( lastChild.data );
+		itr = data( ).keys.upper_bound( lastChild.data );
 		return findChildAt( fullkey, itr );
 	}
 
 
 	Object::iterator_t Object::findChildAt( Memory fullkey, iterator_t itr ) const
 	{
-		if ( itr != m_data->keys.end( ) )
+		if ( itr != data( ).keys.end( ) )
 		{
 			Memory subkey = itr->first;
 			if ( !KeyPath{ fullkey }.isRelated( subkey ) )
-				{ itr = m_data->keys.end( ); }
+				{ itr = data( ).keys.end( ); }
 		}
 		return itr;
 	}
@@ -922,7 +2164,7 @@ namespace cpp::bit
 
     Object::iterator_t Object::findValueAt( Memory fullkey, iterator_t itr ) const
     {
-		while ( itr != m_data->keys.end( ) )
+		while ( itr != data( ).keys.end( ) )
         {
             Memory subkey = itr->first;
 			Memory childkey = KeyPath{ fullkey }.getChildKey( subkey );
@@ -939,23 +2181,6 @@ namespace cpp::bit
     }
 
 
-    bool Object::hasKeyWithValueAt( Memory fullkey ) const
-    {
-		if ( value( ) )
-			{ return true; }
-		
-        auto & itr = firstSubkeyAt( fullkey );
-        while ( itr != m_data->keys.end( ) )
-        {
-			if ( at( itr->second ).value( ) )
-				{ return true; }
-            itr = nextSubkeyAt( fullkey, itr );
-        }
-        return false;
-    }
-
-
-
 	Object::Array::Array( Object object )
 		: m_object( std::move( object ) )
 	{
@@ -975,8 +2200,8 @@ namespace cpp::bit
 
     size_t Object::Array::size( ) const
     {
-        auto itr = m_object.m_data->records.find( m_object.m_key.path );
-        return itr != m_object.m_data->records.end( )
+        auto itr = m_object.data( ).records.find( m_object.m_key.path );
+        return itr != m_object.data( ).records.end( )
             ? itr->second.size( )
             : 0;
     }
@@ -984,8 +2209,8 @@ namespace cpp::bit
 
     Object::View Object::Array::atIndex( size_t index ) const
     {
-        auto itr = m_object.m_data->records.find( m_object.m_key.path );
-        cpp::check<std::out_of_range>( itr != m_object.m_data->records.end( ) && itr->second.size( ) > index,
+        auto itr = m_object.data( ).records.find( m_object.m_key.path );
+        cpp::check<std::out_of_range>( itr != m_object.data( ).records.end( ) && itr->second.size( ) > index,
             "bit::Object::Array::atIndex() : index out-of-range" );
         return Object{ m_object, Key{ String::format( "%[%]", m_object.m_key.path, itr->second.getAt( index ) ), m_object.m_key.origin } };
     }
@@ -1014,10 +2239,10 @@ namespace cpp::bit
     {
         Object result;
 
-        auto itr = m_object.m_data->records.find( m_object.m_key.path );
+        auto itr = m_object.data( ).records.find( m_object.m_key.path );
 
-        bool isNewArray = ( itr == m_object.m_data->records.end( ) && index == 0 );
-        bool isValidIndex = ( itr != m_object.m_data->records.end( ) && itr->second.size( ) >= index );
+        bool isNewArray = ( itr == m_object.data( ).records.end( ) && index == 0 );
+        bool isValidIndex = ( itr != m_object.data( ).records.end( ) && itr->second.size( ) >= index );
         
         cpp::check<std::out_of_range>( isNewArray || isValidIndex,
             "bit::Object::Array::atIndex() : index out-of-range" );
@@ -1042,6 +2267,38 @@ namespace cpp::bit
 
 
 
+    Published::Published( )
+        : m_latest{ std::make_shared<const Object>( ) }, m_version{ 0 }
+    {
+    }
+
+
+    Published::Published( const Object & object )
+        : m_latest{ std::make_shared<const Object>( object.snapshot( ) ) }, m_version{ 1 }
+    {
+    }
+
+
+    void Published::publish( const Object & object )
+    {
+        m_latest.store( std::make_shared<const Object>( object.snapshot( ) ) );
+        m_version++;
+    }
+
+
+    Object Published::latest( ) const
+    {
+        return *m_latest.load( );
+    }
+
+
+    uint64_t Published::version( ) const
+    {
+        return m_version;
+    }
+
+
+
     Object::List::iterator Object::List::begin( ) const
     {
         switch ( m_type )
@@ -1053,7 +2310,7 @@ namespace cpp::bit
         case Type::Child:
             return iterator{ (List *)this, m_object.firstChildAt( m_object.m_key.path ) };
         default:
-            return iterator{ (List *)this, m_object.m_data->keys.end( ) };
+            return iterator{ (List *)this, m_object.data( ).keys.end( ) };
         }
     }
 
@@ -1098,7 +2355,7 @@ namespace cpp::bit
 	*/
 
 
-    bool Object::List::iterator::operator!=( iterator & iter ) const
+    bool Object::List::iterator::operator!=( const iterator & iter ) const
     {
         return m_itr != iter.m_itr;
     }
@@ -1118,7 +2375,7 @@ namespace cpp::bit
             m_itr = object( ).nextChildAt( object( ).m_key.path, m_itr );
             break;
         default:
-            m_itr = object( ).m_data->keys.end( );
+            m_itr = object( ).data( ).keys.end( );
             break;
         }
 
@@ -1181,12 +2438,20 @@ namespace cpp::bit
 
 		ValueRecord getKeyValue( );
 		ValueRecord getKeyNulled( );
+		void emitKeyValue( );
+		void emitKeyNulled( );
+		void clearValue( );
 		Result && getParseResults( );
+		Result getStatus( ) const;
 
 		void setState( ParseState state );
 		void setErrorState( Status status );
 
 		bool m_allowInlineDecoding = false;
+		bool m_captureParseSpans = true;
+		bool m_hasHandler = false;
+		Handler m_handler;
+
 		ParseState m_state = ParseState::BOL;
 		Status m_error = Status::Ok;
 		bool m_escaped = false;
@@ -1202,6 +2467,9 @@ namespace cpp::bit
 		size_t m_errorPos = Memory::npos;
 
 		int m_tabs = 0;
+		bool m_isBlank = true;							// line has no key or value (blank or comment)
+		String m_contextKey;							// key prefix inherited from a less indented line
+		std::vector<std::string> m_context;				// key prefix of the last line at each indent
 		Span m_token;
 		Span m_valueKey;
 		Span m_recordKey;
@@ -1234,6 +2502,9 @@ namespace cpp::bit
         m_errorPos = Memory::npos;
 
 		m_tabs = 0;
+		m_isBlank = true;
+		m_contextKey.clear( );
+		m_context.clear( );
 		m_token.clear();
 		m_valueKey.clear( );
 		m_recordKey.clear( );
@@ -1309,29 +2580,37 @@ namespace cpp::bit
 			{ return m_keyBuffer; }
 
 		//	use direct key value
-		if ( !m_rootKey && !m_recordKey && !m_valueKey )
-			{ return Memory::Empty; }
-		if ( m_rootKey && !m_recordKey && !m_valueKey )
-			{ return get( m_rootKey ); }
-		if ( !m_rootKey && m_recordKey && !m_valueKey )
-			{ return get( m_recordKey ); }
-		if ( !m_rootKey && !m_recordKey && m_valueKey )
-			{ return get( m_valueKey ); }
+		if ( m_contextKey.isEmpty( ) )
+		{
+			if ( !m_rootKey && !m_recordKey && !m_valueKey )
+				{ return Memory::Empty; }
+			if ( m_rootKey && !m_recordKey && !m_valueKey )
+				{ return get( m_rootKey ); }
+			if ( !m_rootKey && m_recordKey && !m_valueKey )
+				{ return get( m_recordKey ); }
+			if ( !m_rootKey && !m_recordKey && m_valueKey )
+				{ return get( m_valueKey ); }
+		}
 
 		//	constructed key using key buffer
+		m_keyBuffer += m_contextKey;
 		if ( m_rootKey )
-			{ m_keyBuffer += m_rootKey; }
+		{
+			if ( m_keyBuffer.notEmpty( ) )
+				{ m_keyBuffer.append( '.' ); }
+			m_keyBuffer += get( m_rootKey );
+		}
 		if ( m_recordKey )
 		{
 			if ( m_keyBuffer.notEmpty( ) )
 				{ m_keyBuffer.append( '.' ); }
-			m_keyBuffer += m_recordKey;
+			m_keyBuffer += get( m_recordKey );
 		}
 		if ( m_valueKey )
 		{
 			if ( m_keyBuffer.notEmpty( ) )
 				{ m_keyBuffer.append( '.' ); }
-			m_keyBuffer += m_valueKey;
+			m_keyBuffer += get( m_valueKey );
 		}
 		return m_keyBuffer;
 	}
@@ -1351,9 +2630,11 @@ namespace cpp::bit
 
 	Decoder::ValueRecord Decoder::Detail::getKeyValue( )
 	{
+		//	a moved string may keep short contents inline, so buffered keys and values point at the new buffers
 		ValueRecord record;
 		record.key = key( );
-		record.keyBuffer = std::move( m_keyBuffer.data );
+		if ( m_keyBuffer )
+			{ record.keyBuffer = std::move( m_keyBuffer.data ); record.key = record.keyBuffer; }
 
 		record.value = value( );
 		if ( !m_valueIsDelimited && value() == "null" )
@@ -1361,15 +2642,13 @@ namespace cpp::bit
 			record.value = nullptr;
 			m_valueBuffer.clear( );
 		}
-		else
+		else if ( m_valueBuffer )
 		{
 			record.valueBuffer = std::move( m_valueBuffer.data );
+			record.value = record.valueBuffer;
 		}
 
-		m_valueKey.clear( );
-		m_value.clear( );
-		m_valueSpec.clear( );
-		m_valueIsDelimited = false;
+		clearValue( );
 
 		return record;
 	}
@@ -1379,7 +2658,8 @@ namespace cpp::bit
 	{
 		ValueRecord record;
 		record.key = key( );
-		record.keyBuffer = std::move( m_keyBuffer.data );
+		if ( m_keyBuffer )
+			{ record.keyBuffer = std::move( m_keyBuffer.data ); record.key = record.keyBuffer; }
 		record.value = NullValue;
 
 		m_valueKey.clear( );
@@ -1389,6 +2669,73 @@ namespace cpp::bit
 	}
 
 
+	//	Reports the current key/value to the handler, or adds it to the parse results.  The handler 
+	//	receives the line-backed key and value directly and the key and value buffers keep their capacity.
+	void Decoder::Detail::emitKeyValue( )
+	{
+		m_isBlank = false;
+		if ( !m_hasHandler )
+		{
+			m_result.values.emplace_back( getKeyValue( ) );
+			return;
+		}
+
+		Memory value = this->value( );
+		if ( !m_valueIsDelimited && value == "null" )
+		{
+			if ( m_handler.onNull )
+				{ m_handler.onNull( key( ) ); }
+		}
+		else if ( m_handler.onValue )
+		{
+			m_handler.onValue( key( ), value );
+		}
+
+		m_keyBuffer.clear( );
+		m_valueBuffer.clear( );
+		clearValue( );
+	}
+
+
+	void Decoder::Detail::emitKeyNulled( )
+	{
+		m_isBlank = false;
+		if ( !m_hasHandler )
+		{
+			m_result.values.emplace_back( getKeyNulled( ) );
+			return;
+		}
+
+		if ( m_handler.onErase )
+			{ m_handler.onErase( key( ) ); }
+		else if ( m_handler.onNull )
+			{ m_handler.onNull( key( ) ); }
+
+		m_keyBuffer.clear( );
+		m_valueKey.clear( );
+		m_value.clear( );
+	}
+
+
+	void Decoder::Detail::clearValue( )
+	{
+		m_valueKey.clear( );
+		m_value.clear( );
+		m_valueSpec.clear( );
+		m_valueIsDelimited = false;
+	}
+
+
+	Decoder::Result Decoder::Detail::getStatus( ) const
+	{
+		Result result;
+		result.row = m_row;
+		result.status = Status::Ok;
+		result.statusPos = 0;
+		return result;
+	}
+
+
 	Decoder::Result && Decoder::Detail::getParseResults( )
 	{
 		bool isEndState = m_state == ParseState::BOL;
@@ -1418,7 +2765,8 @@ namespace cpp::bit
 	{ 
 		m_state = state; 
 		m_statePos = m_pos; 
-		m_result.parseSpans.emplace_back( ParseSpan{ m_statePos, m_state } );
+		if ( m_captureParseSpans )
+			{ m_result.parseSpans.emplace_back( ParseSpan{ m_statePos, m_state } ); }
 	}
 
 
@@ -1503,6 +2851,10 @@ namespace cpp::bit
 				advance( );
 				break;
 			default:
+				//	an indented line continues the key prefix of the last line with one less tab
+				m_contextKey.clear( );
+				if ( m_tabs > 0 && (size_t)m_tabs <= m_context.size( ) )
+					{ m_contextKey = m_context[m_tabs - 1]; }
 				setState(ParseState::PreToken);
 				return;
 			}
@@ -1527,6 +2879,16 @@ namespace cpp::bit
 			case ':':
 				setState( ParseState::RecordDelimiter );
 				break;
+			case '/':
+				if ( getch( 1 ) == '/' )
+				{
+					m_commentPos = m_pos;
+					setState( ParseState::Comment );
+					break;
+				}
+				m_token.begin = m_pos;
+				setState( ParseState::Token );
+				break;
 			case '=':
 				// this case occurs when an empty key for a key/value pair is specified:
 				// e.g. record: ='hello'
@@ -1569,7 +2931,7 @@ namespace cpp::bit
 					return;
 				}
 				break;
-			case '/n':
+			case '\n':
 				m_token.end = m_pos;
 				setState( ParseState::PostToken );
 				return;
@@ -1598,7 +2960,7 @@ namespace cpp::bit
 		if ( token( ) == "null" )
 		{
 			setState( nextState );
-			m_result.values.emplace_back( getKeyNulled( ) );
+			emitKeyNulled( );
 		}
 		else
 		{
@@ -1641,6 +3003,14 @@ namespace cpp::bit
 				advance( );
 				return;
 			default:
+				//	e.g. "data : null b='b'"
+				if ( token( ) == "null" )
+				{
+					emitKeyNulled( );
+					m_token.clear( );
+					setState( ParseState::PreToken );
+					return;
+				}
 				break;
 			}
 
@@ -1770,7 +3140,7 @@ namespace cpp::bit
         }
         else
         {
-			m_result.values.emplace_back( getKeyValue( ) );
+			emitKeyValue( );
 
 			if ( isDelimited )
 				{ advance( ); }
@@ -1808,7 +3178,7 @@ namespace cpp::bit
 				else
 				{
 					m_value.end = m_pos;
-					m_result.values.emplace_back( getKeyValue( ) );
+					emitKeyValue( );
 
 					m_valueBuffer.clear( );
 					m_value.clear( );
@@ -1821,7 +3191,7 @@ namespace cpp::bit
 				if ( m_valueIsDelimited && !m_escaped )
 				{
 					m_value.end = m_pos;
-					m_result.values.emplace_back( getKeyValue( ) );
+					emitKeyValue( );
 
 					m_valueBuffer.clear( );
 					m_value.clear( );
@@ -1940,10 +3310,32 @@ namespace cpp::bit
 		advance( );
 		setState( ParseState::BOL );
 
+		//	record the key prefix of this line for any indented lines that follow
+		if ( !m_isBlank || m_rootKey || m_recordKey )
+		{
+			m_context.resize( m_tabs );
+			m_context.emplace_back( m_contextKey.data );
+			std::string & prefix = m_context.back( );
+			for ( Span span : { m_rootKey, m_recordKey } )
+			{
+				if ( !span )
+					{ continue; }
+				if ( !prefix.empty( ) )
+					{ prefix += '.'; }
+				prefix += get( span );
+			}
+		}
+
+		if ( m_hasHandler && m_handler.onRecordEnd && !m_isBlank )
+			{ m_handler.onRecordEnd( ); }
+
 		m_row++;
 		m_rowPos = m_pos;
 		m_rowCol = 0;
 		m_tabs = 0;		
+		m_isBlank = true;
+		m_rootKey.clear( );
+		m_recordKey.clear( );
 	}
 
 
@@ -1954,12 +3346,208 @@ namespace cpp::bit
 	}
 
 
+	Decoder::Decoder( Handler handler, bool captureParseSpans )
+		: m_detail( std::make_shared<Detail>( ) )
+	{
+		m_detail->m_captureParseSpans = captureParseSpans;
+		m_detail->m_hasHandler = true;
+		m_detail->m_handler = std::move( handler );
+	}
+
+
 	Decoder::Result Decoder::decode( DataBuffer & buffer )
 	{
 		return m_detail->decode( buffer );
 	}
 
 
+	//	Reads records from the input into a reusable buffer and decodes each complete record
+	//	as it arrives.  Memory use is bounded by the largest record rather than the input size.
+	Decoder::Result Decoder::decode( Input input )
+	{
+		check<cpp::Exception>( m_detail->m_hasHandler, "bit::Decoder::decode() : streaming decode requires a handler" );
+
+		StringBuffer buffer{ LineReader::MaxLineLength };
+		size_t scanned = 0;			// of the incomplete record, so each read only scans what it added
+		while ( true )
+		{
+			Memory data = buffer.getable( );
+			size_t end = findRecordEnd( data, scanned, scanned );
+			if ( end == Memory::npos )
+			{
+				if ( input.isOpen( ) )
+				{
+					if ( buffer.putable( ).isEmpty( ) )
+						{ buffer.resize( buffer.size( ) * 2 ); }
+					buffer.put( input.readsome( buffer.putable( ) ).length( ) );
+					continue;
+				}
+				if ( data.isEmpty( ) )
+					{ break; }
+				if ( data[data.length( ) - 1] != '\n' )
+				{
+					//	terminate the final record
+					if ( buffer.putable( ).isEmpty( ) )
+						{ buffer.resize( buffer.size( ) + 1 ); }
+					buffer.put( "\n" );
+					continue;
+				}
+				end = data.length( );
+			}
+
+			DataBuffer record{ data.substr( 0, end ) };
+			Result result = m_detail->decode( record );
+			buffer.get( end );
+			scanned = 0;
+			if ( !result )
+				{ return result; }
+		}
+
+		return m_detail->getStatus( );
+	}
+
+
+	//	LineReader splits on every newline, so lines are joined while a length-encoded value is incomplete.
+	Decoder::Result Decoder::decode( LineReader & lines )
+	{
+		check<cpp::Exception>( m_detail->m_hasHandler, "bit::Decoder::decode() : streaming decode requires a handler" );
+
+		String pending;
+		size_t scanned = 0;			// of pending
+		for ( auto cursor : lines )
+		{
+			Memory record = cursor.line;
+			if ( pending.notEmpty( ) )
+				{ pending += cursor.line; record = pending; }
+
+			if ( findRecordEnd( record, scanned, scanned ) == Memory::npos )
+			{
+				if ( pending.isEmpty( ) )
+					{ pending = record; }
+				continue;
+			}
+
+			DataBuffer buffer{ record };
+			Result result = m_detail->decode( buffer );
+			pending.clear( );
+			scanned = 0;
+			if ( !result )
+				{ return result; }
+		}
+
+		if ( pending.notEmpty( ) )
+		{
+			if ( !pending.data.ends_with( '\n' ) )
+				{ pending += '\n'; }
+			DataBuffer buffer{ pending };
+			Result result = m_detail->decode( buffer );
+			if ( !result )
+				{ return result; }
+		}
+
+		return m_detail->getStatus( );
+	}
+
+
+	//	Skips a value beginning after '=', returning the position following it.  Undelimited values
+	//	and values interrupted by a newline return the position of the newline.
+	size_t skipValue( Memory text, size_t pos )
+	{
+		size_t len = text.length( );
+		pos = text.findFirstNotOf( " \t", pos );
+		if ( pos == Memory::npos )
+			{ return Memory::npos; }
+
+		if ( text[pos] == '(' )
+		{
+			size_t end = text.findFirstNotOf( "0123456789", pos + 1 );
+			if ( end == Memory::npos )
+				{ return Memory::npos; }
+			if ( text[end] != ')' || end == pos + 1 )
+				{ return text.find( '\n', pos ); }		// invalid value spec, the decoder reports it
+			uint64_t valueLen = cpp::Integer::parseUnsigned( text.substr( pos + 1, end - pos - 1 ) );
+
+			pos = text.findFirstNotOf( " \t", end + 1 );
+			if ( pos == Memory::npos )
+				{ return Memory::npos; }
+			bool isDelimited = text[pos] == '\'';
+			size_t valueEnd = pos + ( isDelimited ? 1 : 0 ) + valueLen + ( isDelimited ? 1 : 0 );
+			return valueEnd <= len ? valueEnd : Memory::npos;
+		}
+
+		if ( text[pos] != '\'' )
+			{ return text.find( '\n', pos ); }
+
+		pos++;
+		while ( ( pos = text.findFirstOf( "^'\n", pos ) ) != Memory::npos )
+		{
+			switch ( text[pos] )
+			{
+			case '^':
+				pos += 2;
+				break;
+			case '\'':
+				return pos + 1;
+			default:
+				return pos;
+			}
+		}
+		return Memory::npos;
+	}
+
+
+	size_t Decoder::findRecordEnd( Memory text, size_t pos )
+	{
+		size_t resume;
+		return findRecordEnd( text, pos, resume );
+	}
+
+
+	//	An incomplete record leaves resume at the start of its incomplete token, e.g. the '=' of a value, so
+	//	a length-encoded value is not scanned again and its length prefix is only parsed again.
+	size_t Decoder::findRecordEnd( Memory text, size_t pos, size_t & resume )
+	{
+		size_t len = text.length( );
+		resume = pos;
+		while ( pos < len )
+		{
+			pos = text.findFirstOf( "\n[/=", pos );
+			if ( pos == Memory::npos )
+			{
+				resume = len;
+				return Memory::npos;
+			}
+
+			resume = pos;
+			switch ( text[pos] )
+			{
+			case '\n':
+				return pos + 1;
+			case '[':
+				//	bracketed key segments end at ']' or newline
+				pos = text.findFirstOf( "]\n", pos + 1 );
+				if ( pos != Memory::npos && text[pos] == ']' )
+					{ pos++; }
+				break;
+			case '/':
+				if ( pos + 1 == len )
+					{ return Memory::npos; }
+				if ( text[pos + 1] == '/' )
+					{ pos = text.find( '\n', pos ); }
+				else
+					{ pos++; }
+				break;
+			case '=':
+				pos = skipValue( text, pos + 1 );
+				break;
+			}
+		}
+		if ( pos != Memory::npos )
+			{ resume = pos; }
+		return Memory::npos;
+	}
+
+
 	size_t Decoder::lineNumber( ) const
 	{
 		return m_detail->m_row + 1;
@@ -1971,6 +3559,18 @@ namespace cpp::bit
 		return m_detail->m_docPos;
 	}
 
+
+	const std::vector<std::string> & Decoder::context( ) const
+	{
+		return m_detail->m_context;
+	}
+
+
+	void Decoder::setContext( std::vector<std::string> context )
+	{
+		m_detail->m_context = std::move( context );
+	}
+
 }
 
 namespace cpp
@@ -2011,7 +3611,7 @@ namespace cpp
 		String str;
 		if ( result.status != bit::Decoder::Status::Ok )
 		{
-			str = cpp::format( "Error during decoding: % at line %, col %\n", result.status, result.row + 1, result.statusPos );
+			str = cpp::format( "Error during decoding: % at line %, col %\n", (int)result.status, result.row + 1, result.statusPos );
 		}
 		return str;
 	}
@@ -2020,9 +3620,16 @@ namespace cpp
 
 #else
 
+#include <algorithm>
+
 #include "../../cpp/meta/Test.h"
 #include "../../cpp/data/DataArray.h"
+#include "../../cpp/data/Integer.h"
+#include "../../cpp/io/Input.h"
+#include "../../cpp/io/Output.h"
+#include "../../cpp/process/Thread.h"
 #include "../../cpp/util/Bit.h"
+#include "../../cpp/util/BitBinding.h"
 
 using namespace cpp;
 
@@ -2073,6 +3680,262 @@ TEST_CASE( "Decoder" )
 }
 
 
+TEST_CASE( "DecoderHandler" )
+{
+	std::vector<std::string> events;
+
+	bit::Decoder::Handler handler;
+	handler.onValue = [&events]( Memory key, Memory value ) { events.push_back( key + "=" + value ); };
+	handler.onNull = [&events]( Memory key ) { events.push_back( key + "=null" ); };
+	handler.onErase = [&events]( Memory key ) { events.push_back( key + ":null" ); };
+	handler.onRecordEnd = [&events]( ) { events.push_back( "|" ); };
+
+	Memory text =
+		"server : ip='10.5.5.102' port=(5)'10667'\n"
+		"// comment\n"
+		"record:\n"
+		"\tsub:\n"
+		"\t\tkey1='a'\n"
+		"\tkey2=null\n"
+		"data : null b=(3)'x\ny'\n"
+		"last='z'";
+
+	std::vector<std::string> expected = { 
+		"server.ip=10.5.5.102", "server.port=10667", "|",
+		"record.sub.key1=a", "|",
+		"record.key2=null", "|",
+		"data:null", "data.b=x\ny", "|",
+		"last=z", "|" };
+
+	CHECK( bit::Decoder::findRecordEnd( text ) == 41 );
+	CHECK( bit::Decoder::findRecordEnd( "a=(3)'x\ny' b='c'\nnext" ) == 17 );
+	CHECK( bit::Decoder::findRecordEnd( "a=(3)'x\ny" ) == Memory::npos );
+	CHECK( bit::Decoder::findRecordEnd( "a /" ) == Memory::npos );
+
+	//	an incomplete record can be scanned again from where the scan stopped
+	size_t resume;
+	CHECK( bit::Decoder::findRecordEnd( "a b=(3)'x\ny", 0, resume ) == Memory::npos );
+	CHECK( resume == 3 );
+	CHECK( bit::Decoder::findRecordEnd( "a b=(3)'x\ny' c='d'\nnext", resume, resume ) == 19 );
+	CHECK( bit::Decoder::findRecordEnd( "a[x", 0, resume ) == Memory::npos );
+	CHECK( resume == 1 );
+	CHECK( bit::Decoder::findRecordEnd( "a ", 0, resume ) == Memory::npos );
+	CHECK( resume == 2 );
+
+	//	a source which returns a few bytes at a time, so records span reads
+	struct Source : public Input::Source
+	{
+		Source( Memory text ) : text( text ) { }
+		bool isOpen( ) const override { return pos < text.length( ); }
+		Memory readsome( Memory dst, std::error_code & ) override
+		{
+			Memory src = text.substr( pos, std::min<size_t>( dst.length( ), 5 ) );
+			pos += src.length( );
+			return Memory::copy( dst, src );
+		}
+		Memory text;
+		size_t pos = 0;
+	};
+
+	bit::Decoder decoder{ handler };
+	CHECK( decoder.decode( Input{ std::make_shared<Source>( text ) } ) );
+	CHECK( events == expected );
+}
+
+
+TEST_CASE( "DecodeParallel" )
+{
+	//	large enough to be split into several chunks
+	String text;
+	for ( int index = 0; index < 40000; index++ )
+	{
+		text += String::format( "item[%] : name='item %' size=(4)'%'\n", index % 5000, index, Integer::toDecimal( index % 10000, 4, true ) );
+		if ( index % 700 == 0 )
+			{ text += String::format( "item[%] : null\n", ( index / 7 ) % 5000 ); }
+		if ( index % 900 == 0 )
+			{ text += String::format( "item[%].name = null\n", ( index / 3 ) % 5000 ); }
+		if ( index % 1000 == 0 )
+			{ text += "group:\n\tsub:\n\t\tkey='a'\n\tkey='b'\n"; }
+	}
+
+	auto sequential = bit::decode( text );
+	auto parallel = bit::decodeParallel( text, 4 );
+	CHECK( parallel.encode( ) == sequential.encode( ) );
+	CHECK( parallel["group.sub.key"].value( ) == "a" );
+}
+
+
+TEST_CASE( "Encoder" )
+{
+	bit::Object object;
+	object["server.ip"] = "10.5.5.102";
+	object["server.port"] = "10667";
+	object["server.motd"] = "it's ^ a\tlong message\nwith several lines";
+	object["server.key"] = "0123456789abcdefghij";
+	object["region[west].name"] = "west";
+	object["region[east]"].erase( );
+	object["region[east].name"] = "east";
+
+	//	listChildren( ) includes the value keys, so each value below a record is also written as its own record
+	Memory leaf =
+		" region[east]=null\n"
+		"region[east] :: name='east'\n"
+		"region[east].name : ='east'\n"
+		"region[west] : name='west'\n"
+		"region[west].name : ='west'\n"
+		"server : ip='10.5.5.102' key=(20)'0123456789abcdefghij' motd='it^'s ^^ a^tlong message^nwith several lines' port='10667'\n"
+		"server.ip : ='10.5.5.102'\n"
+		"server.key : =(20)'0123456789abcdefghij'\n"
+		"server.motd : ='it^'s ^^ a^tlong message^nwith several lines'\n"
+		"server.port : ='10667'\n";
+
+	StringBuffer buffer{ 4096 };
+	bit::Encoder{ buffer, false }.encode( object );
+	CHECK( buffer.getable( ) == leaf );
+
+	String raw;
+	bit::Encoder{ raw, true }.encode( object["server"], bit::Object::EncodeFormat::Value );
+	CHECK( raw ==
+		"server.ip=(10)'10.5.5.102'\n"
+		"server.key=(20)'0123456789abcdefghij'\n"
+		"server.motd=(40)'it's ^ a\tlong message\nwith several lines'\n"
+		"server.port=(5)'10667'\n"
+		"server.ip=(10)'10.5.5.102'\n"
+		"server.key=(20)'0123456789abcdefghij'\n"
+		"server.motd=(40)'it's ^ a\tlong message\nwith several lines'\n"
+		"server.port=(5)'10667'\n" );
+
+	//	an Output with a small buffer: short pieces are staged and flushed, longer ones are written directly
+	struct Sink : Output::Sink
+	{
+		bool isOpen( ) const override { return true; }
+		Memory write( Memory src, std::error_code & ) override { text += src; writes.push_back( src.length( ) ); return src; }
+		void flush( ) override { }
+
+		String text;
+		std::vector<size_t> writes;
+	};
+
+	auto sink = std::make_shared<Sink>( );
+	{
+		bit::Encoder encoder{ Output{ sink }, false, 16 };
+		encoder.encode( object );
+		encoder.flush( );
+	}
+	CHECK( sink->text == leaf );
+	CHECK( sink->writes.size( ) > 1 );
+	CHECK( *std::max_element( sink->writes.begin( ), sink->writes.end( ) ) > 16 );
+
+	//	short writes are continued, a closed output throws, and only flush( ) writes what is staged
+	struct ShortSink : Sink
+	{
+		Memory write( Memory src, std::error_code & error ) override { return isClosed ? Memory::Empty : Sink::write( src.substr( 0, 3 ), error ); }
+		bool isOpen( ) const override { return !isClosed; }
+		bool isClosed = false;
+	};
+
+	auto shortSink = std::make_shared<ShortSink>( );
+	{
+		bit::Encoder encoder{ Output{ shortSink }, false, 16 };
+		encoder.encode( object );
+		encoder.flush( );
+	}
+	CHECK( shortSink->text == leaf );
+	CHECK( *std::max_element( shortSink->writes.begin( ), shortSink->writes.end( ) ) == 3 );
+
+	shortSink = std::make_shared<ShortSink>( );
+	{
+		bit::Encoder encoder{ Output{ shortSink }, false, 1024 };
+		encoder.encode( object );
+		shortSink->isClosed = true;
+		CHECK_THROWS_AS( encoder.flush( ), Output::Exception );
+	}
+	{
+		bit::Encoder encoder{ Output{ shortSink }, false, 1024 };
+		encoder.encode( object );
+	}
+	CHECK( shortSink->text.isEmpty( ) );
+
+	auto decoded = bit::decode( object.encode( ) );
+	CHECK( decoded["server.motd"].value( ) == object["server.motd"].value( ) );
+	CHECK( decoded["server.key"].value( ) == object["server.key"].value( ) );
+	CHECK( object["server.ip"].encode( bit::Object::EncodeFormat::Value ) == "server.ip='10.5.5.102'\n" );
+	CHECK( object["server.key"].encode( bit::Object::EncodeFormat::Value ) == "server.key=(20)'0123456789abcdefghij'\n" );
+}
+
+
+TEST_CASE( "EncodeCompact" )
+{
+	bit::Object object;
+	object["server.ip"] = "10.5.5.102";
+	object["server.port"] = "10667";
+	object["server.motd"] = "it's ^ a\tlong message\nwith several lines";
+	object["region[west].name"] = "west";
+	object["region[east]"].erase( );
+	object["region[east].name"] = "east";
+	object["region[east]"] = "e";
+	object["a.b.c.x"] = "1";
+	object["a.b.c.y"] = "2";
+	object["a.b.d.x"] = "3";
+	object["a.b.d.y"] = "4";
+	object["a.b.d.z.w"] = "5";
+
+	//	record keys where they are shared, a tab for a prefix below one, and the shorter of quoted or length-encoded
+	String compact = object.encode( bit::Object::EncodeFormat::Compact );
+	CHECK( compact ==
+		"a.b.c : x='1' y='2'\n"
+		"a.b.d : x='3' y='4'\n"
+		"\tz.w='5'\n"
+		"region[east] : null\n"
+		"region[east]='e' region[east].name='east'\n"
+		"region[west].name='west'\n"
+		"server : ip='10.5.5.102' motd=(40)'it's ^ a\tlong message\nwith several lines' port='10667'\n" );
+	CHECK( bit::decode( compact ).encode( ) == object.encode( ) );
+
+	//	Object and Child write an erased key as "key ::", which does not decode to the erase, so only the
+	//	formats which keep it are compared
+	for ( auto format : { bit::Object::EncodeFormat::Leaf, bit::Object::EncodeFormat::Value } )
+		{ CHECK( compact.length( ) <= object.encode( format ).length( ) ); }
+
+	CHECK( object["a.b.d"].encode( bit::Object::EncodeFormat::Compact ) == "a.b.d : x='3' y='4'\n\tz.w='5'\n" );
+}
+
+
+TEST_CASE( "EncodeCached" )
+{
+	bit::Object object;
+	object["server.ip"] = "10.5.5.102";
+	object["server.port"] = "10667";
+	object["region[west].name"] = "west";
+	object.enableEncodeCache( );
+	CHECK( object.encodeCached( ) ==
+		"region[west].name='west'\n"
+		"server.ip='10.5.5.102'\n"
+		"server.port='10667'\n" );
+
+	//	only the changed keys are encoded again
+	object["server.port"] = "10668";
+	object["region[west]"].erase( );
+	object["client.port"] = "1";
+	object["client.port"] = nullptr;
+	CHECK( object.encodeCached( ) ==
+		"region[west] : null\n"
+		"server.ip='10.5.5.102'\n"
+		"server.port='10668'\n" );
+	CHECK( bit::decode( object.encodeCached( ) ).encode( ) == object.encode( ) );
+	CHECK( object["server"].encodeCached( ) == "server.ip='10.5.5.102'\nserver.port='10668'\n" );
+
+	//	a snapshot keeps its own records
+	bit::Object snapshot = object.snapshot( );
+	object["server"].erase( );
+	CHECK( object.encodeCached( ) == "region[west] : null\nserver : null\n" );
+	CHECK( snapshot.encodeCached( ) ==
+		"region[west] : null\n"
+		"server.ip='10.5.5.102'\n"
+		"server.port='10668'\n" );
+}
+
+
 TEST_CASE( "BitKey" )
 {
 	bit::Key key;
@@ -2223,4 +4086,296 @@ TEST_CASE( "Bit" )
 }
 
 
+TEST_CASE( "BitArrays" )
+{
+	bit::Object object;
+	object["zone[a].host[1].ip"] = "10.0.0.1";
+	object["zone[a].host[2].ip"] = "10.0.0.2";
+	object["zone[a].host[2].port"] = "80";
+	object["zone[b].name"] = "b";
+
+	CHECK( object["zone"].asArray( ).size( ) == 2 );
+	CHECK( object["zone[a].host"].asArray( ).size( ) == 2 );
+
+	//	an item stays while any value remains below it
+	object["zone[a].host[2].ip"] = nullptr;
+	CHECK( object["zone[a].host"].asArray( ).size( ) == 2 );
+	object["zone[a].host[2].port"] = nullptr;
+	CHECK( object["zone[a].host"].asArray( ).size( ) == 1 );
+	CHECK( object["zone[a].host"].asArray( ).atIndex( 0 ).key( ).get( ) == "zone[a].host[1]" );
+
+	//	clearing a subtree removes its arrays and updates the items above it
+	object["zone[a]"].clear( );
+	CHECK( object["zone[a].host"].asArray( ).size( ) == 0 );
+	CHECK( object["zone"].asArray( ).size( ) == 1 );
+	CHECK( object["zone"].asArray( ).atIndex( 0 ).key( ).get( ) == "zone[b]" );
+
+	//	nulled keys are not values
+	object["zone[c]"].erase( );
+	CHECK( object["zone"].asArray( ).size( ) == 1 );
+	object["zone[c].name"] = "c";
+	CHECK( object["zone"].asArray( ).size( ) == 2 );
+}
+
+
+TEST_CASE( "BitIndexes" )
+{
+	typedef std::vector<std::string> ids_t;
+
+	bit::Object object;
+	object["session[a].userId"] = "7";
+	object["session[b].userId"] = "42";
+	object["session[b].start"] = "0900";
+	object["session[c].userId"] = "42";
+	object["session[c].start"] = "1030";
+
+	//	built from the existing items, then maintained by each write
+	object["session"].createIndex( "userId" );
+	object["session"].createIndex( "start", bit::Object::IndexType::Ordered );
+	CHECK( object["session"].findItems( "userId", "42" ) == ids_t{ "b", "c" } );
+	CHECK( object["session"].findItems( "userId", "8" ).empty( ) );
+
+	object["session[d].userId"] = "42";
+	object["session[a].userId"] = "42";
+	object["session[b].userId"] = "9";
+	CHECK( object["session"].findItems( "userId", "42" ) == ids_t{ "a", "c", "d" } );
+
+	object["session[c]"].erase( );
+	object["session[d].userId"] = nullptr;
+	CHECK( object["session"].findItems( "userId", "42" ) == ids_t{ "a" } );
+
+	object["session[e].start"] = "0800";
+	object += bit::decode( "session[f] : userId='42' start='1200'\n" );
+	CHECK( object["session"].findItems( "start", "0800", "1100" ) == ids_t{ "e", "b" } );
+	CHECK( object["session"].findItems( "start", "1200" ) == ids_t{ "f" } );
+
+	//	snapshots keep their own index, and lookups without an index read every item
+	auto snapshot = object.snapshot( );
+	object["session[f].userId"] = "1";
+	CHECK( snapshot["session"].findItems( "userId", "42" ) == ids_t{ "a", "f" } );
+	CHECK( object["session"].findItems( "userId", "42" ) == ids_t{ "a" } );
+
+	object["session"].dropIndex( "userId" );
+	CHECK( object["session"].findItems( "userId", "42" ) == ids_t{ "a" } );
+	CHECK( object["session"].findItems( "userId", "0", "5" ) == ids_t{ "f", "a" } );
+
+	object.clear( );
+	CHECK( object["session"].findItems( "start", "0", "9" ).empty( ) );
+}
+
+
+TEST_CASE( "BitAppend" )
+{
+	auto object = bit::decode(
+		"data : a='a' b='b'\n"
+		"data.sub : c='c'\n"
+		"data[x].d='d'\n"
+		"other='o'\n" );
+
+	object += bit::decode( "data : null b='b2' e='e'\nnew.f='f'\n" );
+	CHECK( object.encode( ) == bit::decode(
+		"data : null b='b2' e='e'\n"
+		"data[x].d='d'\n"
+		"new.f='f'\n"
+		"other='o'\n" ).encode( ) );
+	CHECK( object["data"].isNulled( ) );
+	CHECK( object["data.sub.c"].isEmpty( ) );
+
+	//	views merge relative to their keys, including views of the same object
+	object["copy"] += object["data"];
+	CHECK( object["copy.b"] == "b2" );
+	CHECK( object["copy"].isNulled( ) );
+	CHECK( object["copy[x].d"].isEmpty( ) );
+
+	bit::Object nested;
+	nested["a.b.c"] = "1";
+	object["deep.x"].append( nested["a"].clip( ) );
+	CHECK( object["deep.x.b.c"] == "1" );
+	CHECK( object["deep.x.a"].isEmpty( ) );
+}
+
+
+TEST_CASE( "BitDiff" )
+{
+	Memory text =
+		"server : ip='10.5.5.102' port='10667' name='main'\n"
+		"region[west].count='1'\n"
+		"region[east].count='2'\n"
+		"old : null\n"
+		"cache.a='1'\n"
+		"cache.b='2'\n";
+
+	auto from = bit::decode( text );
+	auto to = bit::decode( text );
+	CHECK( bit::diff( from, to ).isEmpty( ) );
+
+	to["server.port"] = "10668";
+	to["server.name"] = nullptr;
+	to["server.zone"] = "a";
+	to["region[east]"].clear( );
+	to["cache"].erase( );
+	to["cache.c"] = "3";
+	to["old.value"] = "x";
+
+	String delta = bit::diff( from, to );
+	CHECK( delta == 
+		"cache : null\n"
+		"cache.c='3'\n"
+		"old.value='x'\n"
+		"region[east].count=null\n"
+		"server.name=null\n"
+		"server.port='10668'\n"
+		"server.zone='a'\n" );
+
+	//	replaying the records onto the old state gives the new state
+	auto replica = bit::decode( text );
+	DataBuffer buffer{ delta };
+	bit::Decoder decoder;
+	while ( buffer.getable( ) )
+	{
+		auto result = decoder.decode( buffer );
+		REQUIRE( result );
+		result.applyTo( replica );
+	}
+	CHECK( replica.encode( ) == to.encode( ) );
+	CHECK( bit::diff( replica, to ).isEmpty( ) );
+
+	CHECK_THROWS( bit::diff( from["server"], to["server"] ) );
+}
+
+
+namespace
+{
+	struct Region { std::string name; int count = 0; };
+	struct Endpoint { std::string ip; uint16_t port = 0; bool secure = false; double weight = 0; };
+	struct Service { Endpoint endpoint; std::map<std::string, Region> regions; std::vector<std::string> tags; std::vector<Endpoint> backups; };
+}
+
+template<> struct cpp::bit::Binding<Region>
+	{ static constexpr auto fields = std::make_tuple( BIT_FIELD( Region, name ), BIT_FIELD( Region, count ) ); };
+template<> struct cpp::bit::Binding<Endpoint>
+	{ static constexpr auto fields = std::make_tuple( BIT_FIELD( Endpoint, ip ), BIT_FIELD( Endpoint, port ), BIT_FIELD( Endpoint, secure ), BIT_FIELD( Endpoint, weight ) ); };
+template<> struct cpp::bit::Binding<Service>
+	{ static constexpr auto fields = std::make_tuple( BIT_FIELD( Service, endpoint ), bit::field( "region", &Service::regions ), BIT_FIELD( Service, tags ), BIT_FIELD( Service, backups ) ); };
+
+
+TEST_CASE( "BitBinding" )
+{
+	Memory text =
+		"endpoint : ip='10.5.5.102' port='10667' secure='true' weight='0.5'\n"
+		"region[west] : name='West' count='3'\n"
+		"region[east]:\n"
+		"\tname='East'\n"
+		"tags[0]='a'\n"
+		"tags[1]='b'\n"
+		"backups[0].port='22'\n"
+		"backups[1].ip='10.0.0.2'\n"
+		"unbound.key='ignored'\n";
+
+	Service service;
+	REQUIRE( bit::decode( text, service ) );
+	CHECK( service.endpoint.ip == "10.5.5.102" );
+	CHECK( service.endpoint.port == 10667 );
+	CHECK( service.endpoint.secure == true );
+	CHECK( service.endpoint.weight == 0.5 );
+	CHECK( service.regions.size( ) == 2 );
+	CHECK( service.regions["west"].count == 3 );
+	CHECK( service.regions["east"].name == "East" );
+	CHECK( service.tags == std::vector<std::string>{ "a", "b" } );
+	CHECK( service.backups.size( ) == 2 );
+	CHECK( service.backups[1].ip == "10.0.0.2" );
+
+	//	the encoding decodes to the same Object as the struct's source, less unbound keys
+	String encoded = bit::encode( service );
+	CHECK( encoded.data.find( "endpoint : ip='10.5.5.102' port='10667' secure='true' weight='0.5'\n" ) == 0 );
+
+	auto object = bit::decode( encoded );
+	CHECK( object["region[east].name"] == "East" );
+	CHECK( object["tags[1]"] == "b" );
+	CHECK( object["backups[0].port"] == "22" );
+
+	Service copy;
+	REQUIRE( bit::decode( encoded, copy ) );
+	CHECK( bit::encode( copy ) == encoded );
+
+	//	nulls reset fields and remove named items
+	REQUIRE( bit::decode( "endpoint.port=null\nregion[west] : null\nendpoint : null\n", copy ) );
+	CHECK( copy.endpoint.ip.empty( ) );
+	CHECK( copy.endpoint.port == 0 );
+	CHECK( copy.regions.size( ) == 1 );
+
+	//	every record is decoded, and decoding stops at the first malformed one
+	Service tagged;
+	REQUIRE( bit::decode( "tags[0]='x'\ntags[1]='y'\nendpoint.port='80'\n", tagged ) );
+	CHECK( tagged.tags == std::vector<std::string>{ "x", "y" } );
+	CHECK( tagged.endpoint.port == 80 );
+	CHECK_FALSE( bit::decode( "tags[0]='z'\nendpoint.ip='10.0.0.9\nendpoint.port='81'\n", tagged ) );
+	CHECK( tagged.tags[0] == "z" );
+	CHECK( tagged.endpoint.port == 80 );
+
+	//	vector items overwrite or append, and an index past the end is rejected
+	REQUIRE( bit::decode( "tags[2]='w'\n", tagged ) );
+	CHECK( tagged.tags == std::vector<std::string>{ "z", "y", "w" } );
+	CHECK_THROWS_AS( bit::decode( "tags[4000000000]='x'\n", tagged ), DecodeException );
+	CHECK( tagged.tags.size( ) == 3 );
+}
+
+
+TEST_CASE( "BitSnapshot" )
+{
+	bit::Object object;
+	object["server.ip"] = "10.5.5.102";
+	object["server.region[west].count"] = "1";
+	auto server = object["server"];
+
+	auto snapshot = object.snapshot( );
+	server["ip"] = "10.5.5.103";
+	server["region[east].count"] = "2";
+	object["server.region[west]"].erase( );
+
+	//	views of the writer see its changes, the snapshot does not
+	CHECK( object["server.ip"] == "10.5.5.103" );
+	CHECK( object["server.region"].asArray( ).size( ) == 1 );
+	CHECK( snapshot["server.ip"] == "10.5.5.102" );
+	CHECK( snapshot["server.region"].asArray( ).size( ) == 1 );
+	CHECK( snapshot["server.region[west].count"] == "1" );
+	CHECK( snapshot["server.region[west]"].isNulled( ) == false );
+
+	//	readers always see a complete version while the writer keeps publishing
+	bit::Published published{ object };
+	std::atomic<bool> isDone = false;
+	std::atomic<size_t> mismatches = 0;
+
+	std::vector<Thread> readers;
+	for ( int i = 0; i < 4; i++ )
+	{
+		readers.emplace_back( [&]( )
+		{
+			while ( !isDone )
+			{
+				auto latest = published.latest( );
+				if ( latest["a"].value( ) != latest["b"].value( ) )
+					{ mismatches++; }
+			}
+		} );
+	}
+
+	for ( int i = 0; i < 1000; i++ )
+	{
+		std::string value = Integer::toDecimal( i );
+		object["a"] = value;
+		object["b"] = value;
+		published.publish( object );
+	}
+	isDone = true;
+
+	for ( auto & reader : readers )
+		{ reader.join( ); }
+
+	CHECK( mismatches == 0 );
+	CHECK( published.version( ) == 1001 );
+	CHECK( published.latest( )["a"] == "999" );
+}
+
+
 #endif
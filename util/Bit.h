@@ -1,8 +1,12 @@
 ﻿#pragma once
 
+#include <atomic>
 #include <vector>
 #include <set>
 #include <map>
+#include <memory>
+#include <unordered_map>
+#include <functional>
 #include "../../cpp/data/String.h"
 #include "../../cpp/data/IndexedSet.h"
 
@@ -43,6 +47,16 @@
         std::string bitData = object.encode(); 
         // bitData = "server : ip='10.5.5.102' port='10667'\n";
 
+    Streaming (no Object is built, and parse spans are not captured):
+        bit::Decoder::Handler handler;
+        handler.onValue = []( Memory key, Memory value ) { ... };
+        bit::Decoder{ handler }.decode( file.input( ) );
+
+    Snapshots (one writer, lock-free readers):
+        bit::Published config{ bitFile.data( ) };
+        // writer, after applying updates:      config.publish( bitFile.data( ) );
+        // any reader thread:                   auto snapshot = config.latest( ); Memory ip = snapshot["server.ip"];
+
 	Parts of a Key:
 						arrayName      arrayItemId
 				┌──────────┴────────────┐ ┌┴┐
@@ -55,14 +69,21 @@ namespace cpp
 {
 
     class DataBuffer;
+    class Input;
+    class Output;
+    class LineReader;
 
 	namespace bit
 	{
 
 		class Object;
+		class BitSelector;
 
 		Object                              decode( Memory text );
 		Object                              decode( DataBuffer & buffer );
+		Object                              decodeParallel( Memory text, size_t threadCount = 0 );	// 0 uses hardware concurrency
+
+		String                              diff( const Object & from, const Object & to, bool isRaw = false );	// records which turn root object from into to
 
 
 		struct Key
@@ -149,10 +170,25 @@ namespace cpp
 			const ClipView                  clip( ) const;
 
 			Object                          copy( ) const;							// deep copy at key
+			Object                          snapshot( ) const;						// O(1) immutable view, the next write here copies the data
 
 			class Array;
 			Array                           asArray( ) const;
 
+			//	Secondary indexes over the items of the array at this key, by the value of a field below each
+			//	item, e.g. object["session"].createIndex( "userId" ) then findItems( "userId", "42" ).  Values
+			//	compare as bytes, so numeric fields need a fixed width for range lookups.
+			enum class IndexType
+			{
+				Hash, Ordered
+			};
+
+			void                            createIndex( Memory field, IndexType type = IndexType::Hash );
+			void                            dropIndex( Memory field );
+			std::vector<std::string>        findItems( Memory field, Memory value ) const;			// IDs of the items with field == value
+			std::vector<std::string>        findItems(												// first <= field < last, in value order
+												Memory field, Memory first, Memory last ) const;
+
 			bool                            isNulled(								// returns true if this object (or its parent) was erased
 												bool recursive = false ) const;
 
@@ -163,18 +199,21 @@ namespace cpp
 
 			enum class EncodeFormat
 			{
-				Object, Child, Leaf, Value
+				Object, Child, Leaf, Value,
+				Compact													// record keys and tab indents chosen for the fewest bytes
 			};
 
 			String                          encode( EncodeFormat rowEncoding = EncodeFormat::Leaf ) const;
 			String                          encodeRaw( EncodeFormat rowEncoding = EncodeFormat::Leaf ) const;
 
+			//	Keeps the encoded record of each key, so encodeCached( ) only re-encodes the keys changed since it
+			//	was last called.  Records are one per key in key order, e.g. "server.ip='10.5.5.102'\n".
+			void                            enableEncodeCache( );
+			String                          encodeCached( bool isRaw = false ) const;	// the keys at and below this key
+
 		private:
 			                                Object( const Object & copy, Key key );
 
-			void                            verifyArraysOnAdd( Memory fullKey );
-			void                            verifyArraysOnRemove( Memory fullKey );
-
 			Object                          getChild( Memory rootKey, Memory childKey ) const;
 
 			typedef std::string value_t;
@@ -183,8 +222,24 @@ namespace cpp
 			typedef std::set<std::string> set_t;
 			typedef std::map<std::string, cpp::IndexedSet<std::string>> arraymap_t;
 
+			struct FieldIndex
+			{
+				IndexType                   type = IndexType::Hash;
+				std::unordered_map<std::string, std::string> values;					// item ID -> field value
+				std::unordered_map<std::string, std::set<std::string>> hashed;		// field value -> item IDs
+				std::set<std::pair<std::string, std::string>> ordered;				// ( field value, item ID )
+
+				void                        insert( Memory itemID, Memory value );
+				void                        erase( Memory itemID );
+			};
+			typedef std::map<std::pair<std::string, std::string>, FieldIndex> indexmap_t;	// ( array key, field ) -> index
+
 			friend class Array;
 			friend class List;
+			friend class Encoder;
+			friend class BitImage;
+			friend class BitSelector;
+			friend class ShardedObject;
 
 			iterator_t                      firstSubkeyAt( Memory key ) const;
 			iterator_t                      nextSubkeyAt( Memory key, iterator_t itr ) const;
@@ -198,21 +253,66 @@ namespace cpp
 			iterator_t                      nextValueAt( Memory key, iterator_t itr ) const;
 			iterator_t                      findValueAt( Memory key, iterator_t itr ) const;
 
-			bool                            hasKeyWithValueAt( Memory rootKey ) const;
-
 		private:
-			struct Detail
+			struct EncodeCache;
+			struct SharedFlag												// set by concurrent snapshot( ) calls, cleared by copies
+			{
+				std::atomic<bool>           value{ false };
+
+				                            SharedFlag( ) = default;
+				                            SharedFlag( const SharedFlag & ) { }
+				SharedFlag &                operator=( const SharedFlag & ) { return *this; }
+			};
+			struct Content
 			{
 				map_t                       keys;         // keys and values
 				set_t                       nulled;       // nulled keys
 				arraymap_t                  records;      // ordered records
+				std::map<std::string, size_t> liveCounts; // values at or below each array item, e.g. "a[x]"
+				indexmap_t                  indexes;      // secondary indexes, see createIndex( )
+				SharedFlag                  isShared;	// referenced by a snapshot, never modified again
+				std::shared_ptr<EncodeCache> encodeCache;	// see enableEncodeCache( ), copied with the content
+
+				void                        set( Memory key, Memory value );		// value may be NullValue
+				map_t::iterator             set( map_t::iterator hint, const std::string & key, Memory value );
+				void                        remove( Memory key );
+				void                        removeSubkeys( Memory key );			// all keys beginning with key + "."
+				void                        countValues( Memory key, size_t count, bool isAdded );
+				void                        indexValue( Memory key, Memory value );			// value may be NullValue
+			};
+			struct Detail
+			{
+				std::shared_ptr<Content>    content = std::make_shared<Content>( );
 			};
+
+			const Content &                 data( ) const;
+			Content &                       writable( );							// copies content shared with a snapshot
+
 			std::shared_ptr<Detail>         m_data;
 			Key                             m_key;
 		};
 
 
 
+		//	Publishes versions of an Object from a single writer to any number of reader threads.  Readers
+		//	get the latest snapshot without locking, and the writer keeps updating its own Object.
+		class Published
+		{
+		public:
+			                                Published( );
+			                                Published( const Object & object );
+
+			void                            publish( const Object & object );		// stores object.snapshot( )
+			Object                          latest( ) const;
+			uint64_t                        version( ) const;						// number of publish( ) calls
+
+		private:
+			std::atomic<std::shared_ptr<const Object>> m_latest;
+			std::atomic<uint64_t>           m_version;
+		};
+
+
+
 		class Object::Array
 		{
 		public:
@@ -275,7 +375,7 @@ namespace cpp
 			Object operator*( );
 			const Object operator*( ) const;
 			//bool operator==( iterator & iter ) const;
-			bool operator!=( iterator & iter ) const;
+			bool operator!=( const iterator & iter ) const;
 			iterator & operator++( );
 
 		private:
@@ -340,18 +440,70 @@ namespace cpp
 
 				operator bool( ) const;
 				Object getObject( ) const;
+				void applyTo( Object & object ) const;					// replays the values in order
+			};
+
+			//	Event callbacks for streaming decodes.  Keys and values are only valid during the call.
+			struct Handler
+			{
+				std::function<void( Memory key, Memory value )> onValue;	// key='value'
+				std::function<void( Memory key )> onNull;					// key=null
+				std::function<void( Memory key )> onErase;					// record: null (uses onNull if not set)
+				std::function<void( )> onRecordEnd;						// end of each line
 			};
 
 			Decoder( bool allowInlineDecoding = true );
+			Decoder( Handler handler, bool captureParseSpans = false );
 
 			Result decode( DataBuffer & buffer );
+			Result decode( Input input );								// handler only, reads until end-of-data
+			Result decode( LineReader & lines );						// handler only
 			Result decodeLine( DataBuffer & buffer );
 			Result decodeOne( DataBuffer & buffer );
 
+			//	Returns the position after the newline that ends the record at pos, or npos if the record is incomplete.
+			//	Length-encoded values are skipped, so newlines inside them do not end the record.
+			static size_t findRecordEnd( Memory text, size_t pos = 0 );
+			static size_t findRecordEnd( Memory text, size_t pos, size_t & resume );	// resume is where a scan of more text can continue
+
 			size_t lineNumber( ) const;
 			size_t column( ) const;
 			size_t bytesRead( ) const;
 
+			//	Key prefix of the last line at each indent, used to resume decoding at an indented record.
+			const std::vector<std::string> & context( ) const;
+			void setContext( std::vector<std::string> context );
+
+		private:
+			struct Detail;
+			std::shared_ptr<Detail> m_detail;
+		};
+
+
+
+		//	Encoder writes bit text directly into an Output, DataBuffer, or String.  Output is staged in a
+		//	fixed size buffer, so memory use does not depend on the size of the encoded document.  What is
+		//	staged is only written by flush( ), never by the destructor, so a write error can be thrown.
+		class Encoder
+		{
+		public:
+			static const size_t BufferSize = 64 * 1024;
+
+			Encoder( Output output, bool isRaw = false, size_t bufferSize = BufferSize );
+			Encoder( DataBuffer & buffer, bool isRaw = false );		// throws OutOfBoundsException when full
+			Encoder( String & text, bool isRaw = false );			// appends to text
+			~Encoder( );
+
+			void encode( const Object & object, Object::EncodeFormat rowEncoding = Object::EncodeFormat::Leaf );
+			void encodeDiff( const Object & from, const Object & to );		// see bit::diff( )
+			void flush( );
+
+			//	Writes a record without an Object, e.g. "server : ip='10.5.5.102' port='10667'\n"
+			void beginRecord( Memory key = Memory::Empty );
+			void encodeValue( Memory name, Memory value );
+			void endRecord( );
+			void encodeErase( Memory key );								// "key : null\n", a record of its own
+
 		private:
 			struct Detail;
 			std::shared_ptr<Detail> m_detail;
@@ -406,14 +558,20 @@ namespace cpp
 		inline Object Decoder::Result::getObject( ) const
 		{
 			Object object;
+			applyTo( object );
+			return object;
+		}
+
+
+		inline void Decoder::Result::applyTo( Object & object ) const
+		{
 			for ( const ValueRecord & record : values )
 			{
-				if ( !record.value && !record.valueBuffer.empty( ) )
+				if ( record.isNullRecord( ) )
 					{ object[record.key].erase( ); }
 				else
 					{ object.add( record.key, record.value ); }
 			}
-			return object;
 		}
 
 
@@ -437,13 +595,13 @@ namespace cpp
 
 		inline Object::List::iterator Object::List::end( ) const
 		{
-			return iterator{ (List *)this, m_object.m_data->keys.end( ) };
+			return iterator{ (List *)this, m_object.data( ).keys.end( ) };
 		}
 
 		inline std::vector<Object> Object::List::getAll( ) const
 		{
 			std::vector<Object> result;
-			for ( auto & object : *this )
+			for ( auto && object : *this )
 			{
 				result.push_back( object );
 			}
@@ -453,7 +611,7 @@ namespace cpp
 		inline std::vector<std::string> Object::List::getKeys( ) const
 		{
 			std::vector<std::string> result;
-			for ( auto & object : *this )
+			for ( auto && object : *this )
 			{
 				result.push_back( object.key( ).get( ) );
 			}
@@ -494,10 +652,12 @@ namespace cpp
 
 		inline Decoder::ValueRecord::ValueRecord( ValueRecord && move )
 		{
-			key = move.key;
+			bool isKeyBuffered = move.keyBuffer.size( ) && move.key.begin( ) == move.keyBuffer.data( );
+			bool isValueBuffered = move.valueBuffer.size( ) && move.value.begin( ) == move.valueBuffer.data( );
 			keyBuffer = std::move( move.keyBuffer );
-			value = move.value;
 			valueBuffer = std::move( move.valueBuffer );
+			key = isKeyBuffered ? Memory{ keyBuffer } : move.key;
+			value = isValueBuffered ? Memory{ valueBuffer } : move.value;
 		}
 
 
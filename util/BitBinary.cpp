@@ -0,0 +1,372 @@
+#ifndef TEST
+
+#include "../../cpp/util/BitBinary.h"
+#include "../../cpp/data/DataBuffer.h"
+
+
+namespace cpp::bit
+{
+    const Memory BinaryMagic{ "\0BitB\x01", 6 };
+
+    enum class BinaryOp : uint8_t
+    {
+        Value, Null, Erase, RecordEnd
+    };
+
+
+    //  Position of the '.' before the last segment of key, ignoring dots inside brackets, or npos.
+    size_t findParentEnd( Memory key )
+    {
+        size_t end = Memory::npos;
+        bool isBracketed = false;
+        for ( size_t pos = 0; pos < key.length( ); pos++ )
+        {
+            char ch = key[pos];
+            if ( ch == '[' )
+                { isBracketed = true; }
+            else if ( ch == ']' )
+                { isBracketed = false; }
+            else if ( ch == '.' && !isBracketed )
+                { end = pos; }
+        }
+        return end;
+    }
+
+
+
+    BinaryEncoder::BinaryEncoder( String & output )
+        : m_output( output )
+    {
+        m_output += BinaryMagic;
+    }
+
+
+    void BinaryEncoder::encode( const Object & object )
+    {
+        //  the same records as Encoder with EncodeFormat::Value
+        if ( object.isNulled( ) )
+            { encodeErase( object.key( ).path ); }
+
+        if ( object.value( ) )
+            { encodeValue( object.key( ).path, object.value( ) ); }
+
+        for ( auto && item : object.listValues( ) )
+            { encodeValue( item.key( ).path, item.value( ) ); }
+
+        for ( auto && item : object.listChildren( ) )
+            { encode( item ); }
+    }
+
+
+    void BinaryEncoder::encodeValue( Memory key, Memory value )
+    {
+        if ( value.isNull( ) )
+        {
+            m_output += char( BinaryOp::Null );
+            putKey( key );
+            return;
+        }
+
+        m_output += char( BinaryOp::Value );
+        putKey( key );
+        putBytes( value );
+    }
+
+
+    void BinaryEncoder::encodeErase( Memory key )
+    {
+        m_output += char( BinaryOp::Erase );
+        putKey( key );
+    }
+
+
+    void BinaryEncoder::endRecord( )
+    {
+        m_output += char( BinaryOp::RecordEnd );
+    }
+
+
+    void BinaryEncoder::putVarint( uint64_t value )
+    {
+        for ( ; value >= 0x80; value >>= 7 )
+            { m_output += char( value & 0x7f | 0x80 ); }
+        m_output += char( value );
+    }
+
+
+    void BinaryEncoder::putBytes( Memory bytes )
+    {
+        putVarint( bytes.length( ) );
+        m_output += bytes;
+    }
+
+
+    //  The decoder builds the same dictionary, adding the parent of each key which is written whole.
+    void BinaryEncoder::putKey( Memory key )
+    {
+        size_t parentEnd = findParentEnd( key );
+        if ( parentEnd == Memory::npos )
+        {
+            putVarint( 0 );
+            putBytes( key );
+            return;
+        }
+
+        auto [itr, isAdded] = m_parents.try_emplace( std::string{ key.begin( ), parentEnd }, m_parents.size( ) );
+        if ( isAdded )
+        {
+            putVarint( 0 );
+            putBytes( key );
+        }
+        else
+        {
+            putVarint( itr->second + 1 );
+            putBytes( key.substr( parentEnd + 1 ) );
+        }
+    }
+
+
+
+    BinaryDecoder::BinaryDecoder( Decoder::Handler handler )
+        : m_handler( std::move( handler ) )
+    {
+        if ( !m_handler.onErase )
+            { m_handler.onErase = m_handler.onNull; }
+    }
+
+
+    void BinaryDecoder::decode( Memory message )
+    {
+        check<DecodeException>( isBinary( message ), "bit::BinaryDecoder::decode( ) : expected BitB magic" );
+
+        m_parents.clear( );
+        const char * pos = message.begin( ) + BinaryMagic.length( );
+        const char * end = message.end( );
+        while ( pos < end )
+        {
+            auto op = BinaryOp( *pos++ );
+            switch ( op )
+            {
+            case BinaryOp::Value:
+            {
+                Memory key = getKey( pos, end );
+                Memory value = getBytes( pos, end );
+                if ( m_handler.onValue )
+                    { m_handler.onValue( key, value ); }
+                break;
+            }
+            case BinaryOp::Null:
+            case BinaryOp::Erase:
+            {
+                Memory key = getKey( pos, end );
+                auto & callback = op == BinaryOp::Null ? m_handler.onNull : m_handler.onErase;
+                if ( callback )
+                    { callback( key ); }
+                break;
+            }
+            case BinaryOp::RecordEnd:
+                if ( m_handler.onRecordEnd )
+                    { m_handler.onRecordEnd( ); }
+                break;
+            default:
+                throw DecodeException{ "bit::BinaryDecoder::decode( ) : invalid operation" };
+            }
+        }
+    }
+
+
+    uint64_t BinaryDecoder::getVarint( const char *& pos, const char * end )
+    {
+        uint64_t value = 0;
+        for ( unsigned shift = 0; ; shift += 7 )
+        {
+            check<DecodeException>( pos < end && shift < 64, "bit::BinaryDecoder::decode( ) : truncated or invalid varint" );
+            uint8_t byte = *pos++;
+            value |= uint64_t( byte & 0x7f ) << shift;
+            if ( !( byte & 0x80 ) )
+                { return value; }
+        }
+    }
+
+
+    Memory BinaryDecoder::getBytes( const char *& pos, const char * end )
+    {
+        uint64_t length = getVarint( pos, end );
+        check<DecodeException>( length <= uint64_t( end - pos ), "bit::BinaryDecoder::decode( ) : truncated value" );
+        Memory bytes{ pos, size_t( length ) };
+        pos += length;
+        return bytes;
+    }
+
+
+    Memory BinaryDecoder::getKey( const char *& pos, const char * end )
+    {
+        uint64_t parent = getVarint( pos, end );
+        Memory name = getBytes( pos, end );
+        check<DecodeException>( name.notEmpty( ), "bit::BinaryDecoder::decode( ) : empty key" );
+        if ( parent == 0 )
+        {
+            size_t parentEnd = findParentEnd( name );
+            if ( parentEnd != Memory::npos )
+                { m_parents.emplace_back( name.begin( ), parentEnd ); }
+            return name;
+        }
+
+        check<DecodeException>( parent <= m_parents.size( ), "bit::BinaryDecoder::decode( ) : invalid key prefix" );
+        m_key = m_parents[parent - 1];
+        m_key += '.';
+        m_key.append( name.begin( ), name.end( ) );
+        return m_key;
+    }
+
+
+
+    bool isBinary( Memory data )
+    {
+        return data.length( ) >= BinaryMagic.length( ) && data.substr( 0, BinaryMagic.length( ) ) == BinaryMagic;
+    }
+
+
+    String encodeBinary( const Object & object )
+    {
+        String message;
+        BinaryEncoder{ message }.encode( object );
+        return message;
+    }
+
+
+    Object decodeBinary( Memory message )
+    {
+        Object object;
+        Decoder::Handler handler;
+        handler.onValue = [&object]( Memory key, Memory value ) { object.at( key ) = value; };
+        handler.onNull = [&object]( Memory key ) { object.at( key ) = nullptr; };
+        handler.onErase = [&object]( Memory key ) { object.at( key ).erase( ); };
+
+        BinaryDecoder{ std::move( handler ) }.decode( message );
+        return object;
+    }
+
+
+    //  Each line of text becomes its values and then a RecordEnd, so the records survive the round trip.
+    String textToBinary( Memory text )
+    {
+        String message;
+        BinaryEncoder encoder{ message };
+
+        Decoder::Handler handler;
+        handler.onValue = [&encoder]( Memory key, Memory value ) { encoder.encodeValue( key, value ); };
+        handler.onNull = [&encoder]( Memory key ) { encoder.encodeValue( key, nullptr ); };
+        handler.onErase = [&encoder]( Memory key ) { encoder.encodeErase( key ); };
+        handler.onRecordEnd = [&encoder]( ) { encoder.endRecord( ); };
+
+        //  the decoder requires each record to end with a newline
+        String terminated;
+        if ( text.notEmpty( ) && text[text.length( ) - 1] != '\n' )
+            { terminated = text; terminated += '\n'; text = terminated; }
+
+        Decoder decoder{ std::move( handler ) };
+        DataBuffer buffer{ text };
+        while ( buffer.getable( ) )
+        {
+            auto result = decoder.decode( buffer );
+            if ( !result )
+                { throw Decoder::Exception{ std::move( result ) }; }
+        }
+        return message;
+    }
+
+
+    String binaryToText( Memory message, bool isRaw )
+    {
+        String text;
+        Encoder encoder{ text, isRaw };
+        bool isInRecord = false;
+
+        auto beginRecord = [&]( )
+        {
+            if ( !isInRecord )
+                { encoder.beginRecord( ); isInRecord = true; }
+        };
+
+        Decoder::Handler handler;
+        handler.onValue = [&]( Memory key, Memory value ) { beginRecord( ); encoder.encodeValue( key, value ); };
+        handler.onNull = [&]( Memory key ) { beginRecord( ); encoder.encodeValue( key, nullptr ); };
+        handler.onErase = [&]( Memory key )
+        {
+            if ( isInRecord )
+                { encoder.endRecord( ); isInRecord = false; }
+            encoder.encodeErase( key );
+        };
+        handler.onRecordEnd = [&]( )
+        {
+            if ( isInRecord )
+                { encoder.endRecord( ); isInRecord = false; }
+        };
+
+        BinaryDecoder{ std::move( handler ) }.decode( message );
+        if ( isInRecord )
+            { encoder.endRecord( ); }
+        encoder.flush( );
+        return text;
+    }
+}
+
+#else
+
+#include "../../cpp/meta/Test.h"
+#include "../../cpp/util/BitBinary.h"
+
+using namespace cpp;
+
+TEST_CASE( "BitBinary" )
+{
+	Memory text =
+		"server : ip='10.5.5.102' port='10667'\n"
+		"region[west.1].server.name='a^'b'\n"
+		"region[west.1].server.port=null\n"
+		"client : null\n";
+
+	String message = bit::textToBinary( text );
+	CHECK( bit::isBinary( message ) );
+	CHECK( !bit::isBinary( text ) );
+	CHECK( bit::binaryToText( message ) ==
+		"server.ip='10.5.5.102' server.port='10667'\n"
+		"region[west.1].server.name='a^'b'\n"
+		"region[west.1].server.port=null\n"
+		"client : null\n" );
+
+	//	keys after the first with the same parent are written as a dictionary entry and a name
+	CHECK( message.find( "server.port" ) == Memory::npos );
+	CHECK( message.find( "region[west.1].server.port" ) == Memory::npos );
+
+	bit::Object object;
+	object["server.ip"] = "10.5.5.102";
+	object["server.port"] = "10667";
+	object["region[west].count"] = "3";
+	object["notes"] = "line 1\nline 2";
+
+	bit::Object copy = bit::decodeBinary( bit::encodeBinary( object ) );
+	CHECK( copy["server.ip"].value( ) == "10.5.5.102" );
+	CHECK( copy["server.port"].value( ) == "10667" );
+	CHECK( copy["region[west].count"].value( ) == "3" );
+	CHECK( copy["notes"].value( ) == "line 1\nline 2" );
+
+	//	events, with values pointing into the message
+	String events;
+	bit::Decoder::Handler handler;
+	handler.onValue = [&events]( Memory key, Memory value ) { events += key; events += "="; events += value; events += " "; };
+	handler.onErase = [&events]( Memory key ) { events += key; events += " : null "; };
+	handler.onRecordEnd = [&events]( ) { events += "| "; };
+	bit::BinaryDecoder{ handler }.decode( bit::textToBinary( "a : b='1' c='2'\na.b : null\n" ) );
+	CHECK( events == "a.b=1 a.c=2 | a.b : null | " );
+
+	//	malformed messages throw
+	String truncated = message;
+	truncated.resize( truncated.length( ) - 2 );
+	CHECK_THROWS( bit::decodeBinary( truncated ) );
+	CHECK_THROWS( bit::decodeBinary( text ) );
+	CHECK_THROWS( bit::textToBinary( "a='1\n" ) );
+}
+
+#endif
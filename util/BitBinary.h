@@ -0,0 +1,79 @@
+#pragma once
+
+/*
+
+BitB is a binary encoding of bit records for hot paths like RPC, where even length-encoded text costs
+digit parsing and delimiter scanning.  It carries the same operations as the text, and converts to and from
+text without loss (other than layout and comments):
+
+	message     := magic op*                            magic is "\0BitB" followed by the version byte 1
+	op          := Value key value | Null key | Erase key | RecordEnd
+	key         := varint( parent ) varint( length ) name
+	value       := varint( length ) bytes
+
+Each message has its own dictionary of key prefixes.  A key whose parent (i.e. "region[west].server" of
+"region[west].server.ip") is in the dictionary is written as the parent's entry + 1 followed by its name.
+Otherwise it is written whole after a 0, and its parent becomes the next dictionary entry.  Varints are
+unsigned LEB128.
+
+	String message = bit::encodeBinary( object );
+	bit::Object copy = bit::decodeBinary( message );
+	String text = bit::binaryToText( message );			// for debugging, e.g. server : ip='10.5.5.102'
+
+The decoders report to a Decoder::Handler, with keys and values which are only valid during the call.
+
+*/
+
+#include <unordered_map>
+
+#include "../../cpp/util/Bit.h"
+
+
+namespace cpp::bit
+{
+    class BinaryEncoder
+    {
+    public:
+                                            BinaryEncoder( String & output );      // appends one message to output
+
+        void                                encode( const Object & object );
+        void                                encodeValue( Memory key, Memory value );   // a null value is key=null
+        void                                encodeErase( Memory key );              // i.e. key : null
+        void                                endRecord( );
+
+    private:
+        void                                putVarint( uint64_t value );
+        void                                putBytes( Memory bytes );
+        void                                putKey( Memory key );
+
+        String &                            m_output;
+        std::unordered_map<std::string, size_t> m_parents;                        // dictionary entry of each parent
+    };
+
+
+
+    class BinaryDecoder
+    {
+    public:
+                                            BinaryDecoder( Decoder::Handler handler );
+
+        void                                decode( Memory message );               // throws DecodeException if malformed
+
+    private:
+        uint64_t                            getVarint( const char *& pos, const char * end );
+        Memory                              getBytes( const char *& pos, const char * end );
+        Memory                              getKey( const char *& pos, const char * end );
+
+        Decoder::Handler                    m_handler;
+        std::vector<std::string>            m_parents;
+        std::string                         m_key;                                  // reused for keys with a parent entry
+    };
+
+
+
+    bool                                    isBinary( Memory data );               // begins with the BitB magic
+    String                                  encodeBinary( const Object & object );
+    Object                                  decodeBinary( Memory message );
+    String                                  textToBinary( Memory text );
+    String                                  binaryToText( Memory message, bool isRaw = false );
+}
@@ -0,0 +1,333 @@
+#pragma once
+
+/*
+
+	Binds C++ structs to bit key paths, so records decode straight into fields and structs encode without
+	building an Object.  A struct is bound by specializing bit::Binding with a constexpr field list:
+
+		struct Region { std::string name; int count = 0; };
+		struct Server { std::string ip; uint16_t port = 0; std::map<std::string, Region> regions; std::vector<std::string> tags; };
+
+		template<> struct cpp::bit::Binding<Region>
+			{ static constexpr auto fields = std::make_tuple( BIT_FIELD( Region, name ), BIT_FIELD( Region, count ) ); };
+		template<> struct cpp::bit::Binding<Server>
+			{ static constexpr auto fields = std::make_tuple( BIT_FIELD( Server, ip ), BIT_FIELD( Server, port ),
+				bit::field( "region", &Server::regions ), BIT_FIELD( Server, tags ) ); };
+
+		Server server;
+		bit::decode( "ip='10.5.5.102' port='10667'\nregion[west].count='3'\n", server );
+		String text = bit::encode( server );
+
+	Field types:
+		bound structs			nested keys (e.g. parent.child)
+		std::vector<T>			arrays with index ids (e.g. tags[0]), as produced by Object::Array::append( ), each id
+								at most the vector's size or decode( ) throws DecodeException
+		std::map<string, T>		arrays with named ids (e.g. region[west])
+		strings, bool, numbers	values
+
+	Unbound keys are ignored.  key=null and record erasures reset the field (or remove the named item).
+
+*/
+
+#include <charconv>
+#include <map>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "../../cpp/data/Float.h"
+#include "../../cpp/data/Integer.h"
+#include "../../cpp/data/DataBuffer.h"
+#include "Bit.h"
+
+
+#define BIT_FIELD( type, member ) cpp::bit::field( #member, &type::member )
+
+
+namespace cpp::bit
+{
+
+	template<class T> struct Binding;		// specialized with: static constexpr auto fields = std::make_tuple( field( ... ), ... );
+
+
+	template<class T, class M>
+	struct Field
+	{
+		const char *						name;
+		M T::*								member;
+	};
+
+
+	template<class T, class M>
+	constexpr Field<T, M> field( const char * name, M T::* member )
+		{ return Field<T, M>{ name, member }; }
+
+
+	template<class T> Decoder::Handler		bind( T & object );							// decoder events are written into object
+	template<class T> Decoder::Result		decode( Memory text, T & object );
+	template<class T> void					encode( Encoder & encoder, const T & object, Memory key = Memory::Empty );
+	template<class T> String				encode( const T & object, bool isRaw = false );
+
+
+
+	namespace binding
+	{
+		template<class T, class = void> struct isBound : std::false_type { };
+		template<class T> struct isBound<T, std::void_t<decltype( Binding<T>::fields )>> : std::true_type { };
+
+		template<class T> struct isVector : std::false_type { };
+		template<class T, class A> struct isVector<std::vector<T, A>> : std::true_type { };
+
+		template<class T> struct isMap : std::false_type { };
+		template<class T, class C, class A> struct isMap<std::map<std::string, T, C, A>> : std::true_type { };
+
+		template<class T> constexpr bool isValue = !isBound<T>::value && !isVector<T>::value && !isMap<T>::value;
+
+
+		//	"name.rest" -> "name", "rest" and "name[id].rest" -> "name", "[id].rest"
+		inline Memory splitName( Memory key, Memory & rest )
+		{
+			size_t pos = key.findFirstOf( ".[" );
+			if ( pos == Memory::npos )
+				{ rest = Memory::Empty; return key; }
+
+			rest = ( key[pos] == '.' ) ? key.substr( pos + 1 ) : key.substr( pos );
+			return key.substr( 0, pos );
+		}
+
+
+		//	"[id].rest" -> "id", "rest"
+		inline bool splitItem( Memory key, Memory & id, Memory & rest )
+		{
+			size_t end = key.find( ']' );
+			if ( key.isEmpty( ) || key[0] != '[' || end == Memory::npos )
+				{ return false; }
+
+			id = key.substr( 1, end - 1 );
+			rest = key.substr( end + 1 );
+			if ( rest.notEmpty( ) && rest[0] == '.' )
+				{ rest = rest.substr( 1 ); }
+			return true;
+		}
+
+
+		template<class T>
+		void parseValue( Memory text, T & value )
+		{
+			if constexpr ( std::is_same_v<T, bool> )
+				{ value = ( text == "true" || text == "1" ); }
+			else if constexpr ( std::is_integral_v<T> && std::is_signed_v<T> )
+				{ value = (T)Integer::parse( text ); }
+			else if constexpr ( std::is_integral_v<T> )
+				{ value = (T)Integer::parseUnsigned( text ); }
+			else if constexpr ( std::is_floating_point_v<T> )
+				{ value = (T)Float::parse( text ); }
+			else
+				{ value = T( text ); }
+		}
+
+
+		//	Numbers are formatted into digits, which must outlive the returned Memory.
+		template<class T>
+		Memory formatValue( const T & value, char ( & digits )[32] )
+		{
+			if constexpr ( std::is_same_v<T, bool> )
+				{ return value ? "true" : "false"; }
+			else if constexpr ( std::is_arithmetic_v<T> )
+				{ return Memory{ digits, std::to_chars( digits, digits + sizeof( digits ), value ).ptr }; }
+			else
+				{ return Memory{ value }; }
+		}
+
+
+		//	Sets (or resets, when value is null) the field at the relative key.  Returns false for unbound keys.
+		template<class T>
+		bool assign( T & target, Memory key, Memory value )
+		{
+			if ( key.isEmpty( ) && value.isNull( ) )
+			{
+				target = T{ };
+				return true;
+			}
+
+			if constexpr ( isBound<T>::value )
+			{
+				Memory rest;
+				Memory name = splitName( key, rest );
+				return std::apply( [&]( const auto & ... fields )
+					{ return ( ( name == fields.name && assign( target.*( fields.member ), rest, value ) ) || ... ); },
+					Binding<T>::fields );
+			}
+			else if constexpr ( isVector<T>::value )
+			{
+				Memory id, rest;
+				if ( !splitItem( key, id, rest ) || id.isEmpty( ) || id.findFirstNotOf( "0123456789" ) != Memory::npos )
+					{ return false; }
+
+				//	items overwrite or append, an index past the end would size the vector from untrusted input
+				uint64_t index = Integer::parseUnsigned( id );
+				if ( index >= target.size( ) )
+				{
+					if ( value.isNull( ) )
+						{ return true; }
+					check<DecodeException>( index == target.size( ), "bit::decode( ) : vector index past the end" );
+					target.emplace_back( );
+				}
+				return assign( target[(size_t)index], rest, value );
+			}
+			else if constexpr ( isMap<T>::value )
+			{
+				Memory id, rest;
+				if ( !splitItem( key, id, rest ) )
+					{ return false; }
+
+				if ( rest.isEmpty( ) && value.isNull( ) )
+				{
+					target.erase( id.toString( ) );
+					return true;
+				}
+				return assign( target[id.toString( )], rest, value );
+			}
+			else
+			{
+				if ( key.notEmpty( ) )
+					{ return false; }
+				parseValue( value, target );
+				return true;
+			}
+		}
+
+
+		template<class T>
+		void encodeItem( Encoder & encoder, const T & object, std::string & path );
+
+
+		//	Values of a bound struct are written as one record, followed by a record for each nested value.
+		template<class T>
+		void encodeFields( Encoder & encoder, const T & object, std::string & path )
+		{
+			bool isOpen = false;
+			char digits[32];
+			std::apply( [&]( const auto & ... fields )
+			{
+				auto putValue = [&]( const char * name, const auto & value )
+				{
+					using V = std::decay_t<decltype( value )>;
+					if constexpr ( isValue<V> )
+					{
+						if ( !isOpen )
+							{ encoder.beginRecord( path ); isOpen = true; }
+						encoder.encodeValue( name, formatValue( value, digits ) );
+					}
+				};
+				( putValue( fields.name, object.*( fields.member ) ), ... );
+			}, Binding<T>::fields );
+
+			if ( isOpen )
+				{ encoder.endRecord( ); }
+
+			std::apply( [&]( const auto & ... fields )
+			{
+				auto putNested = [&]( const char * name, const auto & value )
+				{
+					using V = std::decay_t<decltype( value )>;
+					if constexpr ( !isValue<V> )
+					{
+						size_t len = path.length( );
+						if ( len )
+							{ path += '.'; }
+						path += name;
+						encodeItem( encoder, value, path );
+						path.resize( len );
+					}
+				};
+				( putNested( fields.name, object.*( fields.member ) ), ... );
+			}, Binding<T>::fields );
+		}
+
+
+		template<class T>
+		void encodeItem( Encoder & encoder, const T & object, std::string & path )
+		{
+			if constexpr ( isBound<T>::value )
+			{
+				encodeFields( encoder, object, path );
+			}
+			else if constexpr ( isVector<T>::value || isMap<T>::value )
+			{
+				size_t len = path.length( );
+				size_t index = 0;
+				char digits[32];
+				for ( const auto & item : object )
+				{
+					path += '[';
+					if constexpr ( isMap<T>::value )
+						{ path += item.first; }
+					else
+						{ path.append( digits, std::to_chars( digits, digits + sizeof( digits ), index++ ).ptr ); }
+					path += ']';
+
+					if constexpr ( isMap<T>::value )
+						{ encodeItem( encoder, item.second, path ); }
+					else
+						{ encodeItem( encoder, item, path ); }
+					path.resize( len );
+				}
+			}
+			else
+			{
+				char digits[32];
+				encoder.beginRecord( );
+				encoder.encodeValue( path, formatValue( object, digits ) );
+				encoder.endRecord( );
+			}
+		}
+	}
+
+
+
+	template<class T>
+	Decoder::Handler bind( T & object )
+	{
+		static_assert( binding::isBound<T>::value, "bit::bind() : the type needs a bit::Binding specialization" );
+
+		Decoder::Handler handler;
+		handler.onValue = [&object]( Memory key, Memory value )
+			{ binding::assign( object, key, value.isNull( ) ? Memory::Empty : value ); };
+		handler.onNull = [&object]( Memory key )
+			{ binding::assign( object, key, nullptr ); };
+		return handler;
+	}
+
+
+	template<class T>
+	Decoder::Result decode( Memory text, T & object )
+	{
+		DataBuffer buffer{ text };
+		Decoder decoder{ bind( object ) };
+		Decoder::Result result = decoder.decode( buffer );
+		while ( result && buffer.getable( ) )
+			{ result = decoder.decode( buffer ); }
+		return result;
+	}
+
+
+	template<class T>
+	void encode( Encoder & encoder, const T & object, Memory key )
+	{
+		std::string path = key;
+		binding::encodeItem( encoder, object, path );
+	}
+
+
+	template<class T>
+	String encode( const T & object, bool isRaw )
+	{
+		String text;
+		Encoder encoder{ text, isRaw };
+		encode( encoder, object );
+		return text;
+	}
+
+}
@@ -1,183 +1,570 @@
-/*
-#include "../../cpp/data/Integer.h"
-#include "../../cpp/time/Duration.h"
+#ifndef TEST
 
-#include "BitDB.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <tuple>
 
-BitDB::BitDB( )
-    : m_archiveIndex( 0 )
-{
+#include "../../cpp/util/BitDB.h"
+#include "../../cpp/data/DataBuffer.h"
+#include "../../cpp/data/Integer.h"
+#include "../../cpp/file/MemoryFile.h"
+#include "../../cpp/process/Thread.h"
 
-}
 
-BitDB::~BitDB( )
+namespace cpp::bit
 {
-    close( );
-}
+    void BitRouter::add( Memory regex, Handler handler )
+    {
+        auto itr = std::find_if( m_routes.begin( ), m_routes.end( ), [regex]( const Route & route ) { return route.regex == regex; } );
+        if ( itr == m_routes.end( ) )
+            { itr = m_routes.insert( m_routes.end( ), Route{ String{ regex } } ); }
+        itr->handler = std::move( handler );
+        m_isCompiled = false;
+    }
 
-cpp::String BitDB::tableRegexHelper( cpp::Memory tableKey )
-{
-    cpp::String tableRegex = tableKey;
-    tableRegex.replaceAll( ".", "\\." );
-    tableRegex.replaceAll( "[*]", "\\[([^\\]]*)\\]" );
-    return tableRegex;
-}
 
-void BitDB::addTable( cpp::Memory tableRegex, ReadHandler readHandle )
-{
-    m_tables[tableRegex] = std::move(readHandle);
-}
+    void BitRouter::remove( Memory regex )
+    {
+        std::erase_if( m_routes, [regex]( const Route & route ) { return route.regex == regex; } );
+        m_isCompiled = false;
+    }
 
-void BitDB::removeTable( cpp::Memory tableRegex )
-{
-    m_tables.erase( tableRegex );
-}
 
-//
-//filename.ext
-//> filename.[archive-date].[archive-index].ext
-//> filename.2017-10-07.000.ext
-//
+    bool BitRouter::isEmpty( ) const
+    {
+        return m_routes.empty( );
+    }
 
-void BitDB::open( cpp::FilePath filename, LoadHandler handler, FlushHandler flushHandler )
-{
-    m_filename = filename;
 
-    auto fileHistory = scanHistory( m_filename );
-    bool hasExistingData = !fileHistory.empty( );
+    //  Joins the patterns as "(p1)|(p2)|...", so the first pattern with a matched group handles the key.
+    //  The groups of each pattern follow its own group, i.e. match[1] is the pattern's first capture, so
+    //  backreferences are renumbered by the groups before the pattern.
+    void BitRouter::compile( )
+    {
+        std::string combined;
+        size_t group = 1;
+        for ( auto & route : m_routes )
+        {
+            route.group = group;
+            route.groupCount = std::regex{ route.regex.begin( ), route.regex.end( ) }.mark_count( );
+            group += route.groupCount + 1;
+
+            if ( !combined.empty( ) )
+                { combined += '|'; }
+            combined += '(';
+            Memory regex = route.regex;
+            for ( size_t pos = 0; pos < regex.length( ); pos++ )
+            {
+                combined += regex[pos];
+                if ( regex[pos] != '\\' || pos + 1 == regex.length( ) )
+                    { continue; }
+
+                size_t end = pos + 1;
+                while ( end < regex.length( ) && regex[end] >= '0' && regex[end] <= '9' )
+                    { end++; }
+                if ( end == pos + 1 || regex[pos + 1] == '0' )
+                    { combined += regex[++pos]; continue; }             // an escaped character, or \0
+
+                combined += std::to_string( Integer::parseUnsigned( regex.substr( pos + 1, end - pos - 1 ) ) + route.group );
+                pos = end - 1;
+            }
+            combined += ')';
+        }
+
+        m_regex = std::regex{ combined, std::regex::optimize };
+        m_isCompiled = true;
+    }
 
-    cpp::String lastArchiveName;
-    int lastArchiveIndex;
 
-    if ( hasExistingData )
+    bool BitRouter::route( Memory key, Memory value )
     {
-        auto lastFile = *fileHistory.rbegin( );
+        if ( m_routes.empty( ) )
+            { return false; }
+        if ( !m_isCompiled )
+            { compile( ); }
+
+        std::cmatch matches;
+        if ( !std::regex_match( key.begin( ), key.end( ), matches, m_regex ) )
+            { return false; }
 
-        auto filenameElements = lastFile.filename( ).split( "." );
-        lastArchiveName = filenameElements.at( 1 );
-        lastArchiveIndex = (int)cpp::Integer::parse( filenameElements.at( 2 ) );
+        for ( auto & route : m_routes )
+        {
+            if ( !matches[route.group].matched )
+                { continue; }
 
-        //  determine archiveName from date and set index from previous archive
-        m_archiveName = cpp::Date::fromTime( cpp::DateTime::now( ) ).toString( "%F" );
-        m_archiveIndex = ( lastArchiveName == m_archiveName ) ? lastArchiveIndex + 1 : 0;
+            Memory::Match match;
+            for ( size_t index = route.group; index <= route.group + route.groupCount; index++ )
+                { match.groups.push_back( Memory{ matches[index].first, matches[index].second } ); }
+            return route.handler( match, value );
+        }
+        return false;
     }
-    else
+
+
+
+    //  The first line of each segment written by open( ), which starts a generation of segments.
+    const Memory CompactedMarker = "//# compacted\n";
+
+
+    //  "data.2026-10-19.007.bit" is segment 7 of 2026-10-19 for "data.bit"
+    bool parseSegment( Memory segment, Memory stem, Memory extension, Memory & date, size_t & index )
     {
-        //  determine archiveName from date
-        m_archiveName = cpp::Date::fromTime( cpp::DateTime::now( ) ).toString( "%F" );
-        m_archiveIndex = 0;
+        if ( segment.length( ) < stem.length( ) + extension.length( ) + 16
+            || segment.substr( 0, stem.length( ) + 1 ) != String{ stem } + "."
+            || segment.substr( segment.length( ) - extension.length( ) - 1 ) != String{ "." } + extension )
+            { return false; }
+
+        Memory name = segment.substr( stem.length( ) + 1, segment.length( ) - stem.length( ) - extension.length( ) - 2 );
+        if ( name.length( ) < 12 || name[10] != '.' || name.substr( 11 ).findFirstNotOf( "0123456789" ) != Memory::npos )
+            { return false; }
+
+        date = name.substr( 0, 10 );
+        index = (size_t)std::stoull( std::string{ name.begin( ) + 11, name.end( ) } );
+        return true;
     }
 
-    auto archiveFilename = getArchiveFilename( m_archiveName, m_archiveIndex );
-    cpp::check( cpp::File::exists( archiveFilename ) == false, "BitDB::open() : Archive file already exists." );
 
-    //  load the latest archive into the tables
-    if ( hasExistingData )
+    bool isCompacted( const FilePath & segment )
     {
-        cpp::FilePath tempFile = m_filename.parent( ) + cpp::String::format( "%-temp.%", m_filename.name(), m_filename.extension() );
+        auto file = File::readFrom( segment );
+        std::string header( CompactedMarker.length( ), '\0' );
+        return file.read( Memory{ header.data( ), header.length( ) } ) == CompactedMarker;
+    }
+
+
+    struct LoadedSegment
+    {
+        MemoryFile                          file;
+        std::vector<Memory>                 records;
+        std::vector<Decoder::Result>        results;
+    };
+
 
-        m_output = cpp::File::write( tempFile );
-        loadArchive( lastArchiveName, lastArchiveIndex );
+    //  A torn final record, i.e. an interrupted write, is only kept in its archived segment.  Copied forward,
+    //  its length-encoded value could take in the records written after it.
+    void decodeSegment( const FilePath & filename, LoadedSegment & segment )
+    {
+        if ( File::readFrom( filename ).length( ) == 0 )
+            { return; }
 
-        //  flush all tables
-        flushHandler( );
+        segment.file = MemoryFile::read( filename );
+        Memory text = segment.file.data( );
 
-        m_output.close( );
-        cpp::File::rename( tempFile, archiveFilename );
+        Decoder decoder;
+        for ( size_t pos = 0; pos < text.length( ); )
+        {
+            size_t end = Decoder::findRecordEnd( text, pos );
+            if ( end == Memory::npos )
+                { break; }
+
+            Memory record = text.substr( pos, end - pos );
+            DataBuffer buffer{ record };
+            segment.records.push_back( record );
+            segment.results.push_back( decoder.decode( buffer ) );
+            pos = end;
+        }
     }
 
-    m_output = cpp::File::append( archiveFilename );
 
-}
 
-void BitDB::close( )
-{
-    m_output.close( );
-}
+    BitDB::BitDB( )
+    {
+    }
 
-void BitDB::put( const BitData::Record & bitRecord )
-{
-    m_output.put( BitData::encode( bitRecord ) );
-}
 
-void BitDB::put( cpp::Memory bitRecord )
-{
-    m_output.put( bitRecord );
-    if ( bitRecord.isEmpty( ) || bitRecord[bitRecord.length( ) - 1] != '\n' )
+    BitDB::~BitDB( )
     {
-        m_output.put( "\n" );
+        try
+            { close( ); }
+        catch ( IOException & )
+            { }
     }
-}
 
-//  Returns all files in the same directory as filename, and which share the same name (excluding extension) as filename
-std::set<cpp::FilePath> BitDB::scanHistory( cpp::FilePath filename )
-{
-    auto parent = filename.parent( );
-    auto name = filename.name( );
 
-    std::set<cpp::FilePath> history;
-    auto fileList = cpp::File::list( filename.parent( ) );
-    for ( auto & file : fileList )
+    String BitDB::tableRegex( Memory tableKey )
     {
-        if ( file.parent() == parent && file.name( ) == name )
+        const Memory Special = ".^$|()[]{}*+?\\";
+
+        std::string result;
+        for ( size_t pos = 0; pos < tableKey.length( ); pos++ )
         {
-            history.insert( file );
+            if ( tableKey.substr( pos, 3 ) == "[*]" )
+            {
+                result += "\\[([^\\]]*)\\]";
+                pos += 2;
+                continue;
+            }
+            if ( Special.find( tableKey[pos] ) != Memory::npos )
+                { result += '\\'; }
+            result += tableKey[pos];
         }
+        return result;
     }
-    return history;
-}
 
-//  Returns all new filename with the extension modified to reflect archiveName, archiveIndex, and fileIndex
-//      archiveName: i.e. date of file creation, e.g. "2017-10-07"
-//      archiveIndex: auto-incremented index of archive
-cpp::FilePath BitDB::getArchiveFilename( cpp::String archiveName, int archiveIndex )
-{
-    cpp::String archiveFilename = cpp::String::format( "%.%.%.%",
-        m_filename.name( ),
-        archiveName,
-        cpp::Integer::toDecimal( archiveIndex, 3, 0, true ),
-        m_filename.extension( ) );
-    return m_filename.parent( ) + archiveFilename;
-}
 
-void BitDB::loadArchive( cpp::String archiveName, int archiveIndex )
-{
-    cpp::FilePath archiveFile = getArchiveFilename( archiveName, archiveIndex );
+    void BitDB::addTable( Memory tableRegex, ReadHandler handler )
+    {
+        m_router.add( tableRegex, std::move( handler ) );
+    }
+
+
+    void BitDB::removeTable( Memory tableRegex )
+    {
+        m_router.remove( tableRegex );
+    }
+
 
-    if ( cpp::File::exists( archiveFile ) )
+    //  The new segment is written under a temporary name, so if the load fails the current generation
+    //  is still complete and the next open replays it again.
+    void BitDB::open( FilePath filename, FlushHandler flushHandler )
     {
-        for ( auto & cursor : cpp::File::read( archiveFile ).lines( ) )
+        close( );
+        m_filename = std::move( filename );
+
+        auto archived = segments( m_filename );
+        auto first = archived.end( );
+        while ( first != archived.begin( ) )
         {
-            try
-            {
-                auto record = BitData::decode( cursor.line( ) );
+            if ( isCompacted( *--first ) )
+                { break; }
+        }
+        std::vector<FilePath> generation{ first, archived.end( ) };
+
+        auto segment = nextSegment( );
+        auto compactFilename = FilePath{ segment }.concat( ".compact" );
+        m_file = File::create( compactFilename );
+        m_file.write( CompactedMarker );
+
+        loadSegments( generation );
+        m_segmentLength = m_file.length( );
 
-                ReadHandler * handler = nullptr;
-                cpp::String tableKey;
-                cpp::Memory::Match keyMatch;
+        if ( flushHandler )
+            { flushHandler( ); }
 
-                for ( auto & itr : m_tables )
+        m_file.close( );
+        Files::rename( compactFilename, segment );
+
+        auto lock = m_mutex.lock( );
+        openSegment( segment );
+    }
+
+
+    void BitDB::close( )
+    {
+        auto lock = m_mutex.lock( );
+        m_file.close( );
+        m_segment.clear( );
+    }
+
+
+    bool BitDB::isOpen( ) const
+    {
+        auto lock = m_mutex.lock( );
+        return m_segment.notEmpty( );
+    }
+
+
+    void BitDB::setSegmentLimit( size_t length )
+    {
+        auto lock = m_mutex.lock( );
+        m_segmentLimit = length;
+    }
+
+
+    void BitDB::rotate( )
+    {
+        auto lock = m_mutex.lock( );
+        if ( m_segment.notEmpty( ) )
+            { openSegment( nextSegment( ) ); }
+    }
+
+
+    const FilePath & BitDB::segment( ) const
+    {
+        return m_segment;
+    }
+
+
+    void BitDB::put( const Object & records )
+    {
+        writeFile( records.encodeRaw( ) );
+    }
+
+
+    void BitDB::put( Memory records )
+    {
+        writeFile( records );
+    }
+
+
+    std::vector<FilePath> BitDB::segments( const FilePath & filename )
+    {
+        FilePath directory = filename.parent( );
+        Memory stem = filename.stem( );
+        Memory extension = filename.extension( );
+
+        std::vector<std::tuple<std::string, size_t, FilePath>> found;
+        std::error_code error;
+        for ( auto & entry : std::filesystem::directory_iterator{ directory.isEmpty( ) ? FilePath{ "." }.to_path( ) : directory.to_path( ), error } )
+        {
+            auto name = entry.path( ).filename( ).u8string( );
+            Memory segment{ (const char *)name.data( ), (const char *)name.data( ) + name.length( ) };
+
+            Memory date;
+            size_t index;
+            if ( entry.is_regular_file( ) && parseSegment( segment, stem, extension, date, index ) )
+                { found.emplace_back( std::string{ date.begin( ), date.end( ) }, index, directory.isEmpty( ) ? FilePath{ segment } : directory / FilePath{ segment } ); }
+        }
+        std::sort( found.begin( ), found.end( ), []( const auto & lhs, const auto & rhs )
+            { return std::tie( std::get<0>( lhs ), std::get<1>( lhs ) ) < std::tie( std::get<0>( rhs ), std::get<1>( rhs ) ); } );
+
+        std::vector<FilePath> result;
+        for ( auto & item : found )
+            { result.push_back( std::get<2>( item ) ); }
+        return result;
+    }
+
+
+    FilePath BitDB::segmentFilename( Memory date, size_t index ) const
+    {
+        String name = format( "%.%.%.%", m_filename.stem( ), date, Integer::toDecimal( (uint64)index, 3, true ), m_filename.extension( ) );
+        return m_filename.parent( ).isEmpty( ) ? FilePath{ name } : m_filename.parent( ) / FilePath{ name };
+    }
+
+
+    FilePath BitDB::nextSegment( )
+    {
+        String date = DateTime::now( ).toString( "%Y-%m-%d" );
+        m_segmentIndex = ( date == m_segmentDate ) ? m_segmentIndex + 1 : 0;
+        m_segmentDate = date;
+
+        while ( Files::exists( segmentFilename( m_segmentDate, m_segmentIndex ) ) )
+            { m_segmentIndex++; }
+        return segmentFilename( m_segmentDate, m_segmentIndex );
+    }
+
+
+    //  Called with m_mutex held.
+    void BitDB::openSegment( FilePath segment )
+    {
+        m_file.close( );
+        m_segment = std::move( segment );
+        m_file = File::append( m_segment );
+        m_segmentLength = m_file.length( );
+        m_nextDay = DateTime::trimAtDay( DateTime::now( ) ) + Duration::ofDays( 1 );
+    }
+
+
+    //  Each segment is mapped and decoded on its own worker, then the records are routed in order.  Records
+    //  which fail to decode are copied as they are, except a torn final record, see decodeSegment( ).
+    void BitDB::loadSegments( const std::vector<FilePath> & segments )
+    {
+        std::vector<LoadedSegment> loaded( segments.size( ) );
+        std::atomic<size_t> nextSegment = 0;
+        auto worker = [&segments, &loaded, &nextSegment]( )
+        {
+            for ( size_t index = nextSegment++; index < loaded.size( ); index = nextSegment++ )
+                { decodeSegment( segments[index], loaded[index] ); }
+        };
+
+        size_t threadCount = std::min<size_t>( std::max<size_t>( std::thread::hardware_concurrency( ), 1 ), loaded.size( ) );
+        std::vector<Thread> threads;
+        threads.reserve( threadCount );
+        for ( size_t index = 1; index < threadCount; index++ )
+            { threads.emplace_back( worker ); }
+        worker( );
+        for ( auto & thread : threads )
+            { thread.join( ); thread.check( ); }
+
+        Encoder unhandled{ m_file.output( ), true };
+        for ( auto & segment : loaded )
+        {
+            for ( size_t index = 0; index < segment.results.size( ); index++ )
+            {
+                const auto & result = segment.results[index];
+                if ( !result )
                 {
-                    tableKey = itr.first;
-                    keyMatch = record.key.match( tableKey );
-                    if ( keyMatch )
-                        { handler = &(itr.second); break; }
+                    Memory record = segment.records[index];
+                    unhandled.flush( );
+                    m_file.write( record );
+                    if ( record.notEmpty( ) && record[record.length( ) - 1] != '\n' )
+                        { m_file.write( "\n" ); }
+                    continue;
                 }
-                if ( !handler || !(*handler)(tableKey, keyMatch, record) )
+
+                for ( const auto & record : result.values )
                 {
-                    // write lines that are not handled
-                    put( cursor.line( ) );
+                    Memory value = record.isNullRecord( ) ? Memory{ } : record.value;
+                    if ( !m_router.route( record.key, value ) )
+                    {
+                        unhandled.beginRecord( );
+                        unhandled.encodeValue( record.key, value );
+                        unhandled.endRecord( );
+                    }
                 }
-
-            }
-            catch ( cpp::Exception & e )
-            {
-                cpp::debug( "BitDB::loadArchive() : error handling record : error='%', line='%'", e.what( ), cursor.line( ) );
-                // write lines that cause an error
-                put( cursor.line( ) );
             }
+            segment = LoadedSegment{ };         // unmaps the segment
         }
+        unhandled.flush( );
     }
+
+
+    void BitDB::writeFile( Memory records )
+    {
+        auto lock = m_mutex.lock( );
+        check<IOException>( m_file.isOpen( ), "BitDB::put( ) : not open" );
+
+        if ( m_segment.notEmpty( ) && ( DateTime::now( ) >= m_nextDay || ( m_segmentLimit && m_segmentLength >= m_segmentLimit ) ) )
+            { openSegment( nextSegment( ) ); }
+
+        m_file.write( records );
+        m_segmentLength += records.length( );
+        if ( records.isEmpty( ) || records[records.length( ) - 1] != '\n' )
+        {
+            m_file.write( "\n" );
+            m_segmentLength++;
+        }
+    }
+}
+
+#else
+
+#include "../../cpp/meta/Test.h"
+#include "../../cpp/data/Integer.h"
+#include "../../cpp/file/Files.h"
+#include "../../cpp/file/MemoryFile.h"
+#include "../../cpp/util/BitDB.h"
+
+using namespace cpp;
+
+TEST_CASE( "BitRouter" )
+{
+	CHECK( bit::BitDB::tableRegex( "region[*].server.ip" ) == "region\\[([^\\]]*)\\]\\.server\\.ip" );
+
+	std::vector<std::string> routed;
+	bit::BitRouter router;
+	router.add( bit::BitDB::tableRegex( "region[*].name" ), [&]( const Memory::Match & match, Memory value )
+		{ routed.push_back( "name:" + std::string{ match[1] } + "=" + std::string{ value } ); return true; } );
+	router.add( "region\\[([^\\]]*)\\]\\.server\\[([^\\]]*)\\]\\..*", [&]( const Memory::Match & match, Memory value )
+		{ routed.push_back( "server:" + std::string{ match[1] } + "/" + std::string{ match[2] } + ( value.isNull( ) ? "=null" : "" ) ); return true; } );
+	router.add( "region\\[([^\\]]*)\\]\\..*", [&]( const Memory::Match & match, Memory )
+		{ routed.push_back( "region:" + std::string{ match[0] } ); return match[1] != "skip"; } );
+
+	CHECK( router.route( "region[west].name", "West" ) );
+	CHECK( router.route( "region[west].server[a].ip", nullptr ) );
+	CHECK( router.route( "region[east].count", "4" ) );
+	CHECK( !router.route( "region[skip].count", "4" ) );			// the handler did not keep it
+	CHECK( !router.route( "client.name", "x" ) );					// no table
+
+	REQUIRE( routed.size( ) == 4 );
+	CHECK( routed[0] == "name:west=West" );
+	CHECK( routed[1] == "server:west/a=null" );
+	CHECK( routed[2] == "region:region[east].count" );
+
+	//	removing a table recompiles the router, and later tables keep their groups
+	router.remove( bit::BitDB::tableRegex( "region[*].name" ) );
+	routed.clear( );
+	CHECK( router.route( "region[west].name", "West" ) );
+	CHECK( router.route( "region[west].server[b].port", "80" ) );
+	REQUIRE( routed.size( ) == 2 );
+	CHECK( routed[0] == "region:region[west].name" );
+	CHECK( routed[1] == "server:west/b" );
+
+	//	backreferences still refer to their own pattern's groups, and escapes are copied as they are
+	bit::BitRouter pairs;
+	pairs.add( "(a)\\.x", [&]( const Memory::Match &, Memory ) { return true; } );
+	pairs.add( "pair\\[(\\w+)\\]\\.\\1", [&]( const Memory::Match & match, Memory ) { return match[1] == "ab"; } );
+	CHECK( pairs.route( "pair[ab].ab", "1" ) );
+	CHECK( !pairs.route( "pair[ab].cd", "1" ) );
+	CHECK( pairs.route( "a.x", "1" ) );
+}
+
+
+TEST_CASE( "BitDB" )
+{
+	FilePath directory = "bitdb-test";
+	Files::removeAll( directory );
+	Files::createDirectories( directory );
+	FilePath filename = directory / FilePath{ "data.bit" };
+
+	String today = DateTime::now( ).toString( "%Y-%m-%d" );
+	auto segmentOf = [&]( size_t index ) { return directory / FilePath{ format( "data.%.%.bit", today, Integer::toDecimal( (uint64)index, 3, true ) ) }; };
+	auto readText = []( const FilePath & path ) { return std::string{ MemoryFile::read( path ).data( ) }; };
+
+	std::map<std::string, std::string> status;
+	bit::BitDB db;
+	db.addTable( bit::BitDB::tableRegex( "server[*].status" ), [&]( const Memory::Match & match, Memory value )
+	{
+		if ( value.isNull( ) )
+			{ status.erase( std::string{ match[1] } ); }
+		else
+			{ status[std::string{ match[1] }] = value; }
+		return true;
+	} );
+	auto flush = [&]( )
+	{
+		for ( const auto & [name, value] : status )
+		{
+			bit::Object record;
+			record[format( "server[%].status", name )] = value;
+			db.put( record );
+		}
+	};
+
+	//	segments are named by date and index, and rotate at the length limit or on request
+	db.open( filename, flush );
+	CHECK( db.segment( ) == segmentOf( 0 ) );
+	db.put( "server[a].status='up'\nclient.name='x'\n" );
+	db.put( "server[b].status='down'\n" );
+	db.setSegmentLimit( 1 );
+	db.put( "server[a].status='down'\n" );
+	CHECK( db.segment( ) == segmentOf( 1 ) );
+	db.setSegmentLimit( 0 );
+	db.rotate( );
+	CHECK( db.segment( ) == segmentOf( 2 ) );
+	db.put( "server[b].status=null\nclient.port='80'\n" );
+	db.close( );
+
+	auto torn = File::append( segmentOf( 2 ) );
+	torn.write( "client.motd=(20)'torn" );
+	torn.close( );
+
+	auto archived = bit::BitDB::segments( filename );
+	REQUIRE( archived.size( ) == 3 );
+	CHECK( archived[0] == segmentOf( 0 ) );
+	CHECK( archived[2] == segmentOf( 2 ) );
+
+	//	the tables get the records in order, the rest are copied forward, and the torn record stays in the archive
+	db.open( filename, flush );
+	CHECK( status == std::map<std::string, std::string>{ { "a", "down" } } );
+	CHECK( db.segment( ) == segmentOf( 3 ) );
+	CHECK( !Files::exists( FilePath{ segmentOf( 3 ) }.concat( ".compact" ) ) );
+
+	std::string compacted = readText( segmentOf( 3 ) );
+	CHECK( compacted.starts_with( "//# compacted\n" ) );
+	auto copied = bit::decode( compacted );
+	CHECK( copied["client.name"] == "x" );
+	CHECK( copied["client.port"] == "80" );
+	CHECK( copied["server[a].status"] == "down" );				// put by the flush handler
+	CHECK( copied["server[b].status"].value( ).isNull( ) );
+	CHECK( copied["client.motd"].value( ).isNull( ) );
+	CHECK( readText( segmentOf( 2 ) ).ends_with( "client.motd=(20)'torn" ) );
+
+	//	only the segments since the last compacted one are replayed
+	db.put( "server[c].status='up'\n" );
+	status.clear( );
+	db.open( filename, flush );
+	CHECK( status == std::map<std::string, std::string>{ { "a", "down" }, { "c", "up" } } );
+	CHECK( db.segment( ) == segmentOf( 4 ) );
+
+	compacted = readText( segmentOf( 4 ) );
+	CHECK( compacted.find( "client.name" ) != std::string::npos );
+	CHECK( compacted.find( "client.name" ) == compacted.rfind( "client.name" ) );
+	CHECK( bit::BitDB::segments( filename ).size( ) == 5 );
+
+	db.close( );
+	Files::removeAll( directory );
 }
 
-*/
+#endif
@@ -1,44 +1,113 @@
 #pragma once
 
 /*
-#include <set>
-#include <map>
 
-#include "../../cpp/data/Memory.h"
-#include "../../cpp/file/Files.h"
+BitDB is a rolling store of bit records kept in date-archived segment files:
 
-#include "BitData.h"
+	data.bit  >  data.2026-10-19.000.bit, data.2026-10-19.001.bit, data.2026-10-20.000.bit, ...
 
-class BitDB
+Records are appended to the current segment, which is rotated when the date changes or once it reaches
+the segment length limit.  Each open starts a new compacted segment: the segments written since the last
+compacted one are decoded in parallel, then replayed in order through the tables.  Records a table keeps
+are dropped, the rest are copied forward, and the flush handler puts the tables' current state.  Older
+segments are left untouched as the archive.
+
+Tables are key regexes, compiled into a single router so each record is dispatched in one match.
+
+	bit::BitDB db;
+	db.addTable( bit::BitDB::tableRegex( "server[*].status" ), [&]( const Memory::Match & match, Memory value )
+		{ status[match[1]] = value; return true; } );
+	db.open( "data.bit", [&]( ) { for ( auto & item : status ) { db.put( ... ); } } );
+
+*/
+
+#include <functional>
+#include <regex>
+#include <vector>
+
+#include "../../cpp/file/File.h"
+#include "../../cpp/process/Lock.h"
+#include "../../cpp/time/DateTime.h"
+#include "Bit.h"
+
+
+namespace cpp::bit
 {
-public:
-    BitDB( );
-    ~BitDB( );
-
-    typedef std::function<void( float32, std::error_code )> LoadHandler;
-    typedef std::function<bool( cpp::Memory key, cpp::Memory::Match & keyMatch, const BitData::DecodedRecord & bitRecord )> ReadHandler;
-    typedef std::function<void( )> FlushHandler;
-
-    static cpp::String tableRegexHelper( cpp::Memory tableKey );
-    void addTable( cpp::Memory tableRegex, ReadHandler readHandle );
-    void removeTable( cpp::Memory tableRegex );
-
-    void open( cpp::FilePath filename, LoadHandler loadHandler, FlushHandler flushHandler );
-    void close( );
-
-    void put( const BitData::Record & bitRecord );
-    void put( cpp::Memory bitRecord );
-
-private:
-    static std::set<cpp::FilePath> scanHistory( cpp::FilePath filename );
-    cpp::FilePath getArchiveFilename( cpp::String archiveName, int archiveIndex );
-    void loadArchive( cpp::String setName, int setIndex );
-
-private:
-    std::map<cpp::String, ReadHandler> m_tables;
-    cpp::FilePath m_filename;
-    cpp::String m_archiveName;
-    int m_archiveIndex;
-    cpp::File::Output m_output;
-};
-*/
\ No newline at end of file
+    //  Dispatches keys to the first matching pattern, in the order added, with one regex match.  Captures
+    //  and backreferences (e.g. \1) are numbered within each pattern.
+    class BitRouter
+    {
+    public:
+        typedef std::function<bool( const Memory::Match & match, Memory value )> Handler;
+
+        void                                add( Memory regex, Handler handler );
+        void                                remove( Memory regex );
+        bool                                isEmpty( ) const;
+
+        bool                                route( Memory key, Memory value );     // false if no table kept the record
+
+    private:
+        void                                compile( );
+
+        struct Route
+        {
+            String                          regex;
+            Handler                         handler;
+            size_t                          group = 0;                          // capture group of the whole pattern
+            size_t                          groupCount = 0;                     // capture groups within the pattern
+        };
+
+        std::vector<Route>                  m_routes;
+        std::regex                          m_regex;
+        bool                                m_isCompiled = false;
+    };
+
+
+
+    class BitDB
+    {
+    public:
+        typedef BitRouter::Handler          ReadHandler;                        // value is null for an erased key
+        typedef std::function<void( )>      FlushHandler;
+
+                                            BitDB( );
+                                            ~BitDB( );
+
+        static String                       tableRegex( Memory tableKey );      // "region[*].name" matches any region, captured as match[1]
+        void                                addTable( Memory tableRegex, ReadHandler handler );
+        void                                removeTable( Memory tableRegex );
+
+        void                                open( FilePath filename, FlushHandler flushHandler = nullptr );
+        void                                close( );
+        bool                                isOpen( ) const;
+
+        void                                setSegmentLimit( size_t length );   // rotates once a segment reaches length, 0 for no limit
+        void                                rotate( );
+        const FilePath &                    segment( ) const;                   // current segment
+
+        void                                put( const Object & records );
+        void                                put( Memory records );              // encoded records
+
+        static std::vector<FilePath>        segments( const FilePath & filename );     // oldest first
+
+    private:
+        FilePath                            segmentFilename( Memory date, size_t index ) const;
+        FilePath                            nextSegment( );
+        void                                openSegment( FilePath segment );
+        void                                loadSegments( const std::vector<FilePath> & segments );     // copies unhandled records to m_file
+        void                                writeFile( Memory records );
+
+    private:
+        FilePath                            m_filename;
+        BitRouter                           m_router;
+
+        mutable Mutex                       m_mutex;                            // guards the current segment
+        File                                m_file;
+        FilePath                            m_segment;
+        String                              m_segmentDate;
+        size_t                              m_segmentIndex = 0;
+        size_t                              m_segmentLength = 0;
+        size_t                              m_segmentLimit = 0;
+        DateTime                            m_nextDay;
+    };
+}
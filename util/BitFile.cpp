@@ -1,9 +1,40 @@
+#ifndef TEST
+
+#include <utility>
+
 #include "../../cpp/util/BitFile.h"
+#include "../../cpp/data/DataBuffer.h"
+#include "../../cpp/file/MemoryFile.h"
+#include "../../cpp/util/BitFrames.h"
+#include "../../cpp/util/BitImage.h"
 #include "../../cpp/process/Thread.h"
 
 
 namespace cpp::bit
 {
+    namespace
+    {
+        //  bit::decode( ) which also keeps each decoded record, in order.
+        Object decodeRecords( Memory records, std::vector<Decoder::ValueRecord> & values )
+        {
+            Object data;
+            DataBuffer buffer{ records };
+            Decoder decoder;
+            while ( buffer.getable( ) )
+            {
+                Decoder::Result result = decoder.decode( buffer );
+                if ( !result )
+                    { throw Decoder::Exception{ std::move( result ) }; }
+                result.applyTo( data );
+                for ( auto & record : result.values )
+                    { values.push_back( std::move( record ) ); }
+            }
+            return data;
+        }
+    }
+
+
+
     BitFile::BitFile( )
     {
 
@@ -13,7 +44,22 @@ namespace cpp::bit
     BitFile::BitFile( FilePath filename, Handler handler )
         : m_filename{ std::move( filename ) }, m_handler{ std::move( handler ) }
     {
-        reload( );
+        open( );
+    }
+
+
+    BitFile::~BitFile( )
+    {
+        try
+        {
+            auto lock = m_mutex.lock( );
+            lock.wait( [this]( ) { return !m_isCompacting; } );
+            lock.unlock( );
+
+            commit( );
+        }
+        catch ( ... )
+            { }     // the error was already reported to the tickets
     }
 
 
@@ -35,45 +81,259 @@ namespace cpp::bit
         m_handler = std::move( handler );
         m_data.reset( );
 
-        reload( );
+        open( );
 
         assert( m_file.isOpen( ) );
     }
 
 
+    //  Starts from the binary image when it still covers the file, so only the text appended after the
+    //  image is replayed.  Otherwise the whole file is replayed (and rewritten) by reload( ).  A framed
+    //  file first has any torn or damaged tail cut off.
+    void BitFile::open( )
+    {
+        assert( !m_filename.isEmpty( ) );
+
+        if ( m_isFramed && Files::exists( m_filename ) )
+            { recoverFrames( ); }
+
+        if ( m_isValueOnDisk )
+        {
+            loadValues( );
+            return;
+        }
+
+        if ( !loadImage( ) )
+        {
+            reload( );
+            return;
+        }
+
+        auto lock = m_mutex.lock( );
+        lock.wait( [this]( ) { return ( m_written == m_queued || m_error ) && !m_isWriting && !m_isCompacting; } );
+
+        m_file.close( );
+        m_file = File::append( m_filename );
+        if ( m_isFramed )
+            { writeCheckpoint( ); }
+        m_length = m_file.length( );
+        m_deadBytes = 0;
+
+        if ( m_isIndexed )
+        {
+            auto file = File::readFrom( m_filename );
+            m_index.rebuild( file );
+        }
+
+        createFieldIndexes( );
+
+        lock.unlock( );
+        if ( m_handler )
+            { m_handler( m_data ); }
+    }
+
+
+    bool BitFile::loadImage( )
+    {
+        auto image = BitImage::open( BitImage::sidecar( m_filename ) );
+        if ( !image.isValid( ) || !Files::exists( m_filename ) )
+            { return false; }
+
+        try
+        {
+            auto file = File::readFrom( m_filename );
+            if ( !image.covers( file ) )
+                { return false; }
+
+            std::string tail( file.length( ) - image.textLength( ), '\0' );
+            file.seek( image.textLength( ) );
+            for ( size_t pos = 0; pos < tail.length( ); )
+            {
+                Memory data = file.read( Memory{ tail.data( ) + pos, tail.length( ) - pos } );
+                if ( data.isEmpty( ) )
+                    { return false; }
+                pos += data.length( );
+            }
+
+            Object data = image.load( );
+            Decoder decoder;
+            DataBuffer buffer{ tail };
+            while ( buffer.getable( ) )
+            {
+                auto result = decoder.decode( buffer );
+                if ( result.status != Decoder::Status::Ok )
+                    { return false; }               // e.g. a torn record, which reload( ) keeps aside
+                result.applyTo( data );
+            }
+
+            m_data = std::move( data );
+            return true;
+        }
+        catch ( std::exception & )
+        {
+            return false;
+        }
+    }
+
+
+    void BitFile::recoverFrames( )
+    {
+        auto file = File::open( m_filename );
+        auto recovery = BitFrames::recover( file );
+        if ( recovery.length < file.length( ) )
+            { file.truncate( recovery.length ); }
+        m_sequence = recovery.sequence;
+    }
+
+
+    //  Indexes the keys in place rather than decoding the file into m_data.  The file isn't rewritten, so
+    //  a torn last record is ended to be skipped, rather than running into the next append.
+    void BitFile::loadValues( )
+    {
+        auto lock = m_mutex.lock( );
+        lock.wait( [this]( ) { return ( m_written == m_queued || m_error ) && !m_isWriting && !m_isCompacting; } );
+
+        m_file.close( );
+        m_file = File::append( m_filename );
+        if ( m_file.length( ) > 0 )
+        {
+            char last = 0;
+            auto file = File::readFrom( m_filename );
+            file.seek( file.length( ) - 1 );
+            file.read( Memory{ &last, 1 } );
+            if ( last != '\n' )
+                { m_file.write( "\n" ); }
+        }
+
+        m_values.open( m_filename );
+        if ( m_isFramed )
+            { writeCheckpoint( ); }
+        m_length = m_file.length( );
+        m_deadBytes = 0;
+
+        if ( m_isIndexed )
+        {
+            auto file = File::readFrom( m_filename );
+            m_index.rebuild( file );
+        }
+
+        lock.unlock( );
+        if ( m_handler )
+            { m_handler( m_data ); }
+    }
+
+
     void BitFile::reload( )
     {
         assert( !m_filename.isEmpty( ) );
+
+        if ( m_isValueOnDisk )
+        {
+            loadValues( );
+            return;
+        }
+
+        //  the writer must be idle, including its sync, while the file is rewritten
+        auto lock = m_mutex.lock( );
+        lock.wait( [this]( ) { return ( m_written == m_queued || m_error ) && !m_isWriting && !m_isCompacting; } );
         
-        m_file.seek( 0 );
+        m_file.close( );
         m_data.reset( );
 
-        auto reloadFilename = m_filename.append( ".reload" );
+        auto reloadFilename = FilePath{ m_filename }.concat( ".reload" );
         auto reloadFile = File::create( reloadFilename );
 
-        for ( auto cursor : m_file.input( ).lines( ) )
+        if ( Files::exists( m_filename ) && !loadParallel( ) )
         {
-            try
-            {
-                auto record = bit::decode( cursor.line );
-                m_data += record;
-            }
-            catch ( cpp::Exception & )
+            Decoder decoder;
+            auto file = File::readFrom( m_filename );
+            for ( auto cursor : file.input( ).lines( ) )
             {
-                // save bad lines in new file
-                reloadFile.write( cursor.line );
+                DataBuffer buffer{ cursor.line };
+                auto result = decoder.decode( buffer );
+                if ( result )
+                    { result.applyTo( m_data ); }
+                else
+                    { reloadFile.write( cursor.line ); }    // save bad lines in new file
             }
         }
 
-        reloadFile.write( m_data.encodeRaw( ) );
+        Encoder encoder{ reloadFile.output( ), true };
+        encoder.encode( m_data );
+        encoder.flush( );
         reloadFile.close( );
 
-        m_file.close( );
+        replaceFile( reloadFilename );
+
+        m_file = File::append( m_filename );
+        if ( m_isFramed )
+            { writeCheckpoint( ); }
+        m_length = m_file.length( );
+        m_deadBytes = 0;
+
+        auto imageFilename = BitImage::sidecar( m_filename );
+        if ( m_isImaged || Files::exists( imageFilename ) )
+        {
+            auto file = File::readFrom( m_filename );
+            BitImage::save( imageFilename, m_data, file, m_length );
+        }
+
+        if ( m_isIndexed )
+        {
+            auto file = File::readFrom( m_filename );
+            m_index.rebuild( file );        // offsets change when the file is rewritten
+        }
+
+        createFieldIndexes( );
+
+        lock.unlock( );
+        if ( m_handler )
+            { m_handler( m_data ); }
+    }
+
 
-        auto oldFilename = m_filename.append( ".old" );
-        Files::rename( filename( ), oldFilename );
-        Files::rename( reloadFilename, filename( ) );
-        Files::remove( oldFilename );
+    void BitFile::replaceFile( const FilePath & filename )
+    {
+        if ( Files::exists( m_filename ) )
+        {
+            auto oldFilename = FilePath{ m_filename }.concat( ".old" );
+            Files::rename( m_filename, oldFilename );
+            Files::rename( filename, m_filename );
+            Files::remove( oldFilename );
+        }
+        else
+        {
+            Files::rename( filename, m_filename );
+        }
+    }
+
+
+    //  Decodes the mapped file on the worker pool.  If any record fails to decode, false is returned
+    //  so that the file can be replayed line by line, keeping the bad lines.
+    bool BitFile::loadParallel( )
+    {
+        if ( File::readFrom( m_filename ).length( ) == 0 )
+            { return true; }
+
+        try
+        {
+            auto file = MemoryFile::read( m_filename );
+            m_data = bit::decodeParallel( file.data( ) );
+            return true;
+        }
+        catch ( Decoder::Exception & )
+        {
+            m_data.reset( );
+            return false;
+        }
+    }
+
+
+    //  Called with m_mutex held, whenever m_data is replaced.
+    void BitFile::createFieldIndexes( )
+    {
+        for ( auto & [arrayKey, field, type] : m_fieldIndexes )
+            { m_data[arrayKey].createIndex( field, type ); }
     }
 
 
@@ -83,36 +343,882 @@ namespace cpp::bit
     }
 
 
+    void BitFile::enableIndex( size_t prefixDepth )
+    {
+        assert( m_file.isOpen( ) );
+
+        auto lock = m_mutex.lock( );
+        lock.wait( [this]( ) { return ( m_written == m_queued || m_error ) && !m_isWriting; } );
+
+        auto file = File::readFrom( m_filename );
+        m_index = BitIndex::open( BitIndex::sidecar( m_filename ), prefixDepth );
+        m_index.update( file );
+        m_isIndexed = true;
+    }
+
+
+    const BitIndex & BitFile::index( ) const
+    {
+        return m_index;
+    }
+
+
+    void BitFile::enableGroupCommit( Durability durability, Duration interval )
+    {
+        assert( m_file.isOpen( ) );
+
+        auto lock = m_mutex.lock( );
+        m_durability = durability;
+        m_interval = interval;
+        if ( !m_isGroupCommit )
+        {
+            m_isGroupCommit = true;
+            m_writer = [this]( ) { writeBatches( ); };
+        }
+    }
+
+
+    void BitFile::commit( )
+    {
+        auto lock = m_mutex.lock( );
+        Ticket ticket{ this, m_queued };
+        lock.unlock( );
+
+        ticket.wait( );
+    }
+
+
+    void BitFile::enableImage( )
+    {
+        assert( m_file.isOpen( ) && !m_isValueOnDisk );
+
+        auto lock = m_mutex.lock( );
+        lock.wait( [this]( ) { return ( m_written == m_queued || m_error ) && !m_isWriting; } );
+        m_isImaged = true;
+
+        auto file = File::readFrom( m_filename );
+        BitImage::save( BitImage::sidecar( m_filename ), m_data, file, file.length( ) );
+    }
+
+
+    void BitFile::enableFraming( size_t checkpointInterval )
+    {
+        assert( !m_file.isOpen( ) );
+
+        m_isFramed = true;
+        m_checkpointInterval = checkpointInterval;
+    }
+
+
+    void BitFile::enableValuesOnDisk( size_t cacheLength )
+    {
+        assert( !m_file.isOpen( ) );
+
+        m_isValueOnDisk = true;
+        m_values = BitValueIndex{ cacheLength };
+    }
+
+
+    void BitFile::enableCompaction( double minLiveRatio, size_t minLength )
+    {
+        assert( !m_isValueOnDisk );         // compaction encodes m_data
+
+        auto lock = m_mutex.lock( );
+        m_isCompactionEnabled = true;
+        m_minLiveRatio = minLiveRatio;
+        m_minCompactLength = minLength;
+        checkCompaction( );
+    }
+
+
+    void BitFile::compact( )
+    {
+        assert( m_file.isOpen( ) && !m_isValueOnDisk );
+
+        auto lock = m_mutex.lock( );
+        if ( !m_isCompacting )
+        {
+            m_isCompacting = true;
+            m_compactor = [this]( ) { compactFile( ); };
+        }
+    }
+
+
+    bool BitFile::isCompacting( ) const
+    {
+        auto lock = m_mutex.lock( );
+        return m_isCompacting;
+    }
+
+
+    void BitFile::createFieldIndex( Memory arrayKey, Memory field, Object::IndexType type )
+    {
+        assert( !m_isValueOnDisk );
+
+        auto lock = m_mutex.lock( );
+        m_fieldIndexes.emplace_back( arrayKey, field, type );
+        m_data[arrayKey].createIndex( field, type );
+    }
+
+
+    std::vector<std::string> BitFile::findItems( Memory arrayKey, Memory field, Memory value ) const
+    {
+        auto lock = m_mutex.lock( );
+        return m_data[arrayKey].findItems( field, value );
+    }
+
+
+    std::vector<std::string> BitFile::findItems( Memory arrayKey, Memory field, Memory first, Memory last ) const
+    {
+        auto lock = m_mutex.lock( );
+        return m_data[arrayKey].findItems( field, first, last );
+    }
+
+
     Memory BitFile::get( Memory key ) const
     {
+        assert( !m_isValueOnDisk );         // the cached value could be evicted as soon as it is returned, see getCopy( )
+
         return m_data[key];
     }
 
 
-    void BitFile::set( Memory key, Memory value )
+    //  A copy, since with values on disk the cached value can be evicted by another reader, and a value in
+    //  memory replaced by the writer, as soon as the lock is released.
+    std::optional<std::string> BitFile::getCopy( Memory key ) const
+    {
+        if ( m_isValueOnDisk )
+            { return m_values.get( key ); }
+
+        auto lock = m_mutex.lock( );
+        Memory value = m_data[key];
+        if ( value.isNull( ) )
+            { return std::nullopt; }
+        return value.toString( );
+    }
+
+
+    BitFile::Ticket BitFile::set( Memory key, Memory value )
     {
         bit::Object data;
         data[key] = value;
-        
-        m_data += data;
+        String records = data.encodeRaw( );
+
+        Ticket ticket;
+        {
+            auto lock = m_mutex.lock( );
+            if ( m_isValueOnDisk )
+                { m_values.set( key, value ); }
+            else
+            {
+                Memory previous = std::as_const( m_data )[key].value( );
+                if ( previous.notNull( ) )
+                    { m_deadBytes += key.length( ) + previous.length( ) + 4; }      // key='value'\n
+                m_data += data;
+            }
+            ticket = write( records );
+        }
 
-        write( data.encodeRaw( ) );
+        m_subscriptions.dispatch( records );
+        return ticket;
     }
 
 
-    void BitFile::remove( Memory key )
+    BitFile::Ticket BitFile::remove( Memory key )
     {
         bit::Object data;
         data[key].erase( );
+        String records = data.encodeRaw( );
+
+        Ticket ticket;
+        {
+            auto lock = m_mutex.lock( );
+            if ( m_isValueOnDisk )
+                { m_values.remove( key ); }
+            else
+            {
+                const Object removed = std::as_const( m_data )[key];
+                if ( removed.value( ).notNull( ) )
+                    { m_deadBytes += key.length( ) + removed.value( ).length( ) + 4; }
+                for ( const auto & item : removed.listSubkeys( ) )
+                    { m_deadBytes += item.key( ).path.length( ) + item.value( ).length( ) + 4; }
+                m_deadBytes += records.length( );
+                m_data += data;
+            }
+            ticket = write( records );
+        }
+
+        m_subscriptions.dispatch( records );
+        return ticket;
+    }
 
-        m_data += data;
 
-        write( data.encodeRaw( ) );
+    BitFile::Ticket BitFile::assign( const Object & data )
+    {
+        assert( !m_isValueOnDisk );
+
+        String records;
+        Ticket ticket;
+        {
+            auto lock = m_mutex.lock( );
+            records = bit::diff( m_data, data, true );
+            std::vector<Decoder::ValueRecord> values;
+            Object changed = decodeRecords( records, values );
+            countDeadBytes( values );
+            if ( m_fieldIndexes.empty( ) )
+                { m_data = data.snapshot( ); }
+            else
+                { m_data += changed; }             // the field indexes are updated by the changed records only
+
+            ticket = records.notEmpty( ) ? write( records ) : Ticket{ this, m_queued };
+        }
+
+        m_subscriptions.dispatch( records );
+        return ticket;
     }
 
 
-    void BitFile::write( Memory line )
+    BitFile::Ticket BitFile::append( Memory records )
     {
-        m_file.write( line );
+        Object data;
+        std::vector<Decoder::ValueRecord> values;
+        if ( !m_isValueOnDisk )
+            { data = decodeRecords( records, values ); }
+
+        Ticket ticket;
+        {
+            auto lock = m_mutex.lock( );
+            if ( m_isValueOnDisk )
+                { m_values.apply( records ); }
+            else
+            {
+                countDeadBytes( values );
+                m_data += data;
+            }
+            ticket = write( records );
+        }
+
+        m_subscriptions.dispatch( records );
+        return ticket;
+    }
+
+
+    BitSubscriptions::Id BitFile::subscribe( Memory prefix, BitSubscriptions::Handler handler )
+    {
+        return m_subscriptions.subscribe( prefix, std::move( handler ) );
+    }
+
+
+    BitSubscriptions::Id BitFile::subscribe( const BitSelector & selector, BitSubscriptions::Handler handler )
+    {
+        return m_subscriptions.subscribe( selector, std::move( handler ) );
     }
-}
\ No newline at end of file
+
+
+    void BitFile::unsubscribe( BitSubscriptions::Id id )
+    {
+        m_subscriptions.unsubscribe( id );
+    }
+
+
+    void BitFile::setAppendHandler( AppendHandler handler )
+    {
+        auto lock = m_mutex.lock( );
+        lock.wait( [this]( ) { return !m_isWriting; } );
+        m_appendHandler = std::move( handler );
+    }
+
+
+    //  Each update is applied to m_data before its append gets a sequence, so the snapshot holds every
+    //  append up to the returned sequence, and possibly some queued after it.
+    Object BitFile::snapshot( uint64_t * sequence ) const
+    {
+        auto lock = m_mutex.lock( );
+        lock.wait( [this]( ) { return !m_isWriting; } );
+        if ( sequence )
+            { *sequence = m_sequence; }
+        return m_data.snapshot( );
+    }
+
+
+    //  Called with m_mutex held, before values are merged into m_data.  Counts the earlier records they
+    //  overwrite or remove, as set( ) and remove( ) do, and the removals themselves.
+    void BitFile::countDeadBytes( const std::vector<Decoder::ValueRecord> & values )
+    {
+        for ( const auto & record : values )
+        {
+            const Object previous = std::as_const( m_data )[record.key];
+            if ( record.isNullRecord( ) )
+            {
+                for ( const auto & item : previous.listSubkeys( ) )
+                    { m_deadBytes += item.key( ).path.length( ) + item.value( ).length( ) + 4; }
+                m_deadBytes += record.key.length( ) + 8;          // key : null\n
+            }
+            else if ( record.value.isNull( ) )
+                { m_deadBytes += record.key.length( ) + 6; }      // key=null\n
+
+            if ( previous.value( ).notNull( ) )
+                { m_deadBytes += record.key.length( ) + previous.value( ).length( ) + 4; }
+        }
+    }
+
+
+    //  Called with m_mutex held.  With group commit the records are queued for the writer thread,
+    //  so concurrent updates share one write (and one sync).
+    BitFile::Ticket BitFile::write( Memory records )
+    {
+        m_length += records.length( );
+        checkCompaction( );
+
+        if ( !m_isGroupCommit )
+        {
+            writeFile( records );
+            return Ticket{ };
+        }
+
+        if ( m_error )
+            { std::rethrow_exception( m_error ); }
+
+        m_pending.append( records );
+        m_queued++;
+        m_mutex.notifyAll( );
+        return Ticket{ this, m_queued };
+    }
+
+
+    //  Called with m_mutex held.
+    void BitFile::checkCompaction( )
+    {
+        if ( !m_isCompactionEnabled || m_isCompacting || m_length < m_minCompactLength )
+            { return; }
+
+        size_t liveBytes = m_length - std::min( m_deadBytes, m_length );
+        if ( liveBytes < m_length * m_minLiveRatio )
+        {
+            m_isCompacting = true;
+            m_compactor = [this]( ) { compactFile( ); };
+        }
+    }
+
+
+    //  Encodes a snapshot of the data into a new file while updates continue to be appended to the current
+    //  file.  The records appended past the snapshot (the tail) are then copied over, and the new file
+    //  replaces the current one.  Records still queued for the writer are already in the snapshot, so they
+    //  are written out first, keeping them out of the tail: replaying them after the snapshot could erase
+    //  and re-add array items, moving them behind the items added after them.  If anything fails, the current file stays in place.
+    void BitFile::compactFile( )
+    {
+        Thread::setName( "BitFile compaction" );
+
+        auto compactFilename = FilePath{ m_filename }.concat( ".compact" );
+        auto lock = m_mutex.lock( false );
+        try
+        {
+            lock.wait( [this]( ) { return !m_isWriting; } );
+            if ( m_pending.notEmpty( ) )
+            {
+                writeFile( m_pending );
+                m_file.flush( );
+                m_pending.clear( );
+                m_written = m_committed = m_queued;
+                lock.notifyAll( );
+            }
+
+            Object snapshot = m_data.snapshot( );
+            size_t tailOffset = m_file.length( );
+            uint64_t snapshotSequence = m_sequence;
+            lock.unlock( );
+
+            auto compacted = File::create( compactFilename );
+            Encoder encoder{ compacted.output( ), true };
+            encoder.encode( snapshot );
+            encoder.flush( );
+
+            if ( m_isImaged )
+            {
+                //  the image only matches the compacted file, so the current file keeps replaying in full until the switch
+                auto text = File::readFrom( compactFilename );
+                BitImage::save( BitImage::sidecar( m_filename ), snapshot, text, text.length( ) );
+            }
+
+            if ( m_isFramed )
+            {
+                compacted.flush( );
+                compacted.write( BitFrames::checkpoint( snapshotSequence, compacted.length( ) ) );
+            }
+
+            lock.lock( );
+            lock.wait( [this]( ) { return !m_isWriting; } );
+
+            size_t tailStart = compacted.length( );
+            auto file = File::readFrom( m_filename );
+            file.seek( tailOffset );
+            StringBuffer buffer{ 64 * 1024 };
+            for ( size_t remaining = file.length( ) - tailOffset; remaining > 0; )
+            {
+                Memory chunk = file.read( buffer.putable( ).substr( 0, remaining ) );
+                check<IOException>( chunk.notEmpty( ), "BitFile::compactFile( ) : unable to read the tail" );
+                compacted.write( chunk );
+                remaining -= chunk.length( );
+            }
+            file.close( );
+            compacted.flush( );
+            compacted.close( );
+
+            m_file.close( );
+            replaceFile( compactFilename );
+            m_file = File::append( m_filename );
+
+            if ( m_isIndexed )
+            {
+                auto indexFile = File::readFrom( m_filename );
+                m_index.rebuild( indexFile );
+            }
+
+            m_length = m_file.length( ) + m_pending.length( );
+            m_deadBytes = 0;
+            m_sinceCheckpoint = m_file.length( ) - tailStart;
+        }
+        catch ( std::exception & )
+        {
+            //  still holding the lock if the swap failed, so the writer never sees the file closed
+            if ( !lock.hasLock( ) )
+                { lock.lock( ); }
+            if ( !m_file.isOpen( ) )
+                { m_file = File::append( m_filename ); }
+            Files::remove( compactFilename );
+        }
+
+        m_isCompacting = false;
+        lock.notifyAll( );
+    }
+
+
+    //  Called with m_mutex held or, with group commit, on the writer thread while m_isWriting is set, which
+    //  keeps every file swap waiting.  Each append (with group commit, each batch) gets the next sequence.
+    //  Framed records are written behind a header with their sequence and CRC, and a checkpoint follows
+    //  every m_checkpointInterval bytes.
+    void BitFile::writeFile( Memory records )
+    {
+        Memory appended = records;
+        String framed;
+        if ( m_isFramed )
+        {
+            framed = BitFrames::frame( ++m_sequence, records );
+            records = framed;
+        }
+        else
+            { ++m_sequence; }
+
+        size_t offset = m_file.length( );
+        m_file.write( records );
+
+        if ( m_isValueOnDisk )
+            { m_values.append( offset + records.length( ) - appended.length( ), appended ); }
+        if ( m_appendHandler )
+            { m_appendHandler( m_sequence, appended ); }
+
+        if ( m_isIndexed )
+            { m_index.append( offset, records ); }
+
+        if ( m_isFramed && ( m_sinceCheckpoint += records.length( ) ) >= m_checkpointInterval )
+            { writeCheckpoint( ); }
+    }
+
+
+    //  Every frame before a checkpoint must be on disk before the checkpoint is written.
+    void BitFile::writeCheckpoint( )
+    {
+        m_file.flush( );
+
+        size_t offset = m_file.length( );
+        String checkpoint = BitFrames::checkpoint( m_sequence, offset );
+        m_file.write( checkpoint );
+
+        if ( m_isIndexed )
+            { m_index.append( offset, checkpoint ); }
+        m_sinceCheckpoint = 0;
+    }
+
+
+    void BitFile::writeBatches( )
+    {
+        Thread::setName( "BitFile" );
+
+        Time syncTime = Time::now( );
+        while ( true )
+        {
+            String batch;
+            uint64_t sequence;
+            Durability durability;
+            Duration interval;
+            {
+                auto lock = m_mutex.lock( );
+                auto hasPending = [this]( ) { return m_pending.notEmpty( ); };
+                if ( m_durability == Durability::Interval && m_committed < m_written )
+                    { lock.waitUntil( syncTime + m_interval, hasPending ); }
+                else
+                    { lock.wait( hasPending ); }
+
+                std::swap( batch, m_pending );
+                sequence = m_queued;
+                durability = m_durability;
+                interval = m_interval;
+                m_isWriting = true;         // until the batch is written and synced, the file can't be swapped
+            }
+
+            try
+            {
+                if ( batch.notEmpty( ) )
+                    { writeFile( batch ); }
+
+                bool isSync = durability == Durability::Batch
+                    || ( durability == Durability::Interval && Time::now( ) >= syncTime + interval );
+                if ( isSync )
+                {
+                    m_file.flush( );
+                    syncTime = Time::now( );
+                }
+
+                auto lock = m_mutex.lock( );
+                m_isWriting = false;
+                m_written = sequence;
+                if ( isSync || durability == Durability::None )
+                    { m_committed = sequence; }
+                lock.notifyAll( );
+            }
+            catch ( std::exception & )
+            {
+                auto lock = m_mutex.lock( );
+                m_isWriting = false;
+                m_error = std::current_exception( );
+                lock.notifyAll( );
+                return;
+            }
+        }
+    }
+
+
+
+    BitFile::Ticket::Ticket( )
+        : m_file( nullptr ), m_sequence( 0 )
+    {
+    }
+
+
+    BitFile::Ticket::Ticket( const BitFile * file, uint64_t sequence )
+        : m_file( file ), m_sequence( sequence )
+    {
+    }
+
+
+    bool BitFile::Ticket::isCommitted( ) const
+    {
+        if ( !m_file )
+            { return true; }
+
+        auto lock = m_file->m_mutex.lock( );
+        return m_file->m_committed >= m_sequence;
+    }
+
+
+    void BitFile::Ticket::wait( ) const
+    {
+        if ( !m_file )
+            { return; }
+
+        auto lock = m_file->m_mutex.lock( );
+        lock.wait( [this]( ) { return m_file->m_committed >= m_sequence || m_file->m_error; } );
+        if ( m_file->m_committed < m_sequence )
+            { std::rethrow_exception( m_file->m_error ); }
+    }
+}
+
+#else
+
+#include "../../cpp/meta/Test.h"
+#include "../../cpp/util/BitFile.h"
+#include "../../cpp/util/BitImage.h"
+
+using namespace cpp;
+
+TEST_CASE( "BitFile values on disk" )
+{
+	FilePath filename = "test.bit";
+	Files::remove( filename );
+
+	{
+		bit::BitFile file;
+		file.enableValuesOnDisk( 16 );
+		file.load( filename );
+		file.set( "server.ip", "10.5.5.102" );
+		file.set( "server.port", "10667" );
+		file.remove( "server.port" );
+		file.append( "client : name='a'\n" );
+
+		CHECK( file.data( ).isEmpty( ) );
+		CHECK( file.getCopy( "server.ip" ) == "10.5.5.102" );
+		CHECK( file.getCopy( "client.name" ) == "a" );
+		CHECK_FALSE( file.getCopy( "server.port" ) );
+	}
+
+	//	reopened, only the keys are read into memory and the values are read from the file
+	bit::BitFile file;
+	file.enableValuesOnDisk( 16 );
+	file.load( filename );
+	CHECK( file.data( ).isEmpty( ) );
+	CHECK( file.getCopy( "server.ip" ) == "10.5.5.102" );
+	CHECK( file.getCopy( "client.name" ) == "a" );
+	CHECK_FALSE( file.getCopy( "server.port" ) );
+
+	file.set( "server.ip", "10.0.0.1" );
+	file.reload( );
+	CHECK( file.getCopy( "server.ip" ) == "10.0.0.1" );
+	CHECK( bit::decode( File::readFrom( filename ).input( ).readAll( ) )["server.ip"] == "10.0.0.1" );
+}
+
+
+TEST_CASE( "BitFile in memory" )
+{
+	FilePath filename = "test.bit";
+	Files::remove( filename );
+
+	bit::BitFile file{ filename };
+	file.set( "server.ip", "10.5.5.102" );
+	CHECK( file.get( "server.ip" ) == "10.5.5.102" );
+	CHECK( file.getCopy( "server.ip" ) == "10.5.5.102" );
+	CHECK( file.get( "server.port" ).isNull( ) );
+	CHECK_FALSE( file.getCopy( "server.port" ) );
+
+	file.reload( );
+	CHECK( file.get( "server.ip" ) == "10.5.5.102" );
+}
+
+
+TEST_CASE( "BitFile group commit" )
+{
+	FilePath filename = "test.bit";
+	Files::remove( filename );
+
+	SECTION( "updates queued while a batch is written share the next batch" )
+	{
+		bit::BitFile file{ filename };
+		Mutex mutex;
+		std::vector<std::string> appends;
+		bool isReleased = false;
+		file.setAppendHandler( [&]( uint64_t sequence, Memory records )
+		{
+			auto lock = mutex.lock( );
+			appends.push_back( records.toString( ) );
+			lock.notifyAll( );
+			lock.wait( [&]( ) { return isReleased; } );
+		} );
+		file.enableGroupCommit( );
+
+		auto first = file.set( "a", "1" );
+		{
+			auto lock = mutex.lock( );
+			lock.wait( [&]( ) { return appends.size( ) == 1; } );
+		}
+		file.set( "b", "2" );
+		file.set( "c", "3" );
+		auto last = file.remove( "a" );
+		CHECK_FALSE( last.isCommitted( ) );
+		{
+			auto lock = mutex.lock( );
+			isReleased = true;
+			lock.notifyAll( );
+		}
+
+		last.wait( );
+		CHECK( first.isCommitted( ) );
+		CHECK( appends.size( ) == 2 );
+		auto batch = bit::decode( appends.back( ) );
+		CHECK( batch["b"] == "2" );
+		CHECK( batch["c"] == "3" );
+		CHECK( batch["a"].value( ).isNull( ) );
+
+		uint64_t sequence = 0;
+		file.snapshot( &sequence );
+		CHECK( sequence == 2 );
+	}
+
+	SECTION( "each durability commits once the batch is written and synced as it requires" )
+	{
+		using Durability = bit::BitFile::Durability;
+		for ( auto durability : { Durability::None, Durability::Batch, Durability::Interval } )
+		{
+			Files::remove( filename );
+			{
+				bit::BitFile file{ filename };
+				file.enableGroupCommit( durability, Duration::ofMillis( 20 ) );
+				file.set( "a", "1" );
+				auto ticket = file.set( "b", "2" );
+				ticket.wait( );
+				CHECK( ticket.isCommitted( ) );
+				CHECK( bit::decode( File::readFrom( filename ).input( ).readAll( ) )["b"] == "2" );
+
+				file.set( "c", "3" );
+				file.commit( );
+				CHECK( file.get( "c" ) == "3" );
+			}
+			CHECK( bit::BitFile{ filename }.get( "c" ) == "3" );
+		}
+	}
+
+	SECTION( "without group commit the update is already written" )
+	{
+		bit::BitFile file{ filename };
+		auto ticket = file.set( "a", "1" );
+		CHECK( ticket.isCommitted( ) );
+		ticket.wait( );
+		CHECK( bit::decode( File::readFrom( filename ).input( ).readAll( ) )["a"] == "1" );
+	}
+
+	SECTION( "a write error is rethrown by the waiting tickets and the next update" )
+	{
+		bit::BitFile file{ filename };
+		file.setAppendHandler( []( uint64_t sequence, Memory records ) { throw std::runtime_error{ "append failed" }; } );
+		file.enableGroupCommit( );
+
+		auto ticket = file.set( "a", "1" );
+		CHECK_THROWS_AS( ticket.wait( ), std::runtime_error );
+		CHECK_FALSE( ticket.isCommitted( ) );
+		CHECK_THROWS_AS( file.commit( ), std::runtime_error );
+		CHECK_THROWS_AS( file.set( "b", "2" ), std::runtime_error );
+	}
+}
+
+
+TEST_CASE( "BitFile compaction" )
+{
+	FilePath filename = "test.bit";
+	Files::remove( filename );
+
+	SECTION( "updates during compaction are copied over in the tail" )
+	{
+		bit::BitFile file{ filename };
+		String text;
+		for ( size_t index = 0; index < 20000; index++ )
+			{ text += "item[" + std::to_string( index ) + "].value='" + std::to_string( index ) + "'\n"; }
+		file.append( text );
+
+		file.compact( );
+		size_t updates = 0;
+		do
+		{
+			file.set( "item[" + std::to_string( updates ) + "].value", "updated" );
+			file.set( "item[new" + std::to_string( updates ) + "].value", "added" );
+			updates++;
+		}
+		while ( file.isCompacting( ) );
+
+		auto data = file.snapshot( );
+		CHECK( bit::decode( File::readFrom( filename ).input( ).readAll( ) ).encode( ) == data.encode( ) );
+
+		bit::BitFile reopened{ filename };
+		CHECK( reopened.data( ).encode( ) == data.encode( ) );
+		CHECK( reopened.get( "item[new" + std::to_string( updates - 1 ) + "].value" ) == "added" );
+	}
+
+	SECTION( "records queued before the snapshot are not replayed after it" )
+	{
+		{
+			bit::BitFile file{ filename };
+			file.append( "item[a].value='1'\nitem[b].value='2'\n" );
+		}
+
+		bit::BitFile file{ filename };
+		Mutex mutex;
+		bool isBlocked = true;
+		file.setAppendHandler( [&]( uint64_t sequence, Memory records )
+		{
+			auto lock = mutex.lock( );
+			lock.wait( [&]( ) { return !isBlocked; } );
+		} );
+		file.enableGroupCommit( );
+
+		file.set( "x", "1" );         // holds the writer, so the updates below stay queued
+		Thread::sleep( Duration::ofMillis( 10 ) );
+		file.set( "item[a].value", "3" );
+		file.set( "item[c].value", "4" );
+		file.compact( );
+		{
+			auto lock = mutex.lock( );
+			isBlocked = false;
+			lock.notifyAll( );
+		}
+
+		while ( file.isCompacting( ) )
+			{ Thread::sleep( Duration::ofMillis( 1 ) ); }
+		file.commit( );
+
+		//	every update was in the snapshot, so the tail is empty
+		auto data = file.snapshot( );
+		CHECK( File::readFrom( filename ).input( ).readAll( ) == data.encodeRaw( ) );
+		CHECK( bit::BitFile{ filename }.data( ).encode( ) == data.encode( ) );
+	}
+
+	SECTION( "a failed compaction leaves the current file in place" )
+	{
+		bit::BitFile file{ filename };
+		file.set( "a", "1" );
+		file.set( "a", "2" );
+
+		auto compactFilename = FilePath{ filename }.concat( ".compact" );
+		Files::createDirectories( compactFilename );        // the compacted file can't be created
+		file.compact( );
+		while ( file.isCompacting( ) )
+			{ Thread::sleep( Duration::ofMillis( 1 ) ); }
+
+		CHECK_FALSE( Files::exists( compactFilename ) );
+		file.set( "b", "3" );
+		bit::BitFile reopened{ filename };
+		CHECK( reopened.get( "a" ) == "2" );
+		CHECK( reopened.get( "b" ) == "3" );
+	}
+}
+
+
+TEST_CASE( "BitFile image" )
+{
+	FilePath filename = "test.bit";
+	Files::remove( filename );
+	Files::remove( bit::BitImage::sidecar( filename ) );
+
+	{
+		bit::BitFile file{ filename };
+		file.set( "server.name", "0000" );
+		for ( size_t index = 0; index < 1000; index++ )
+			{ file.set( "item[" + std::to_string( index ) + "].value", "1111" ); }
+		file.enableImage( );
+		file.set( "server.ip", "10.0.0.1" );
+	}
+
+	//	the image is loaded and only the appended text is replayed
+	{
+		bit::BitFile file{ filename };
+		CHECK( file.get( "server.name" ) == "0000" );
+		CHECK( file.get( "item[999].value" ) == "1111" );
+		CHECK( file.get( "server.ip" ) == "10.0.0.1" );
+		file.set( "server.ip", "10.0.0.2" );
+	}
+	CHECK( bit::BitFile{ filename }.get( "server.ip" ) == "10.0.0.2" );
+
+	//	a rewrite of the imaged text, even one which keeps its length and last page, isn't covered
+	String text = File::readFrom( filename ).input( ).readAll( );
+	REQUIRE( text.length( ) > bit::BitImage::PageSize );
+	REQUIRE( text.data.find( "'0000'" ) < bit::BitImage::PageSize );
+	for ( size_t pos = text.data.find( "'0000'" ); pos != std::string::npos; pos = text.data.find( "'0000'", pos ) )
+		{ text.data.replace( pos, 6, "'9999'" ); }
+	auto rewritten = File::create( filename );
+	rewritten.write( text );
+	rewritten.close( );
+
+	bit::BitFile file{ filename };
+	CHECK( file.get( "server.name" ) == "9999" );
+	CHECK( file.get( "item[999].value" ) == "1111" );
+	CHECK( file.get( "server.ip" ) == "10.0.0.2" );
+}
+
+#endif
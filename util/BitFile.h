@@ -1,8 +1,14 @@
 #pragma once
 
 #include <functional>
+#include <optional>
+#include <tuple>
 #include "../../cpp/file/File.h"
+#include "../../cpp/process/Thread.h"
 #include "Bit.h"
+#include "BitIndex.h"
+#include "BitSubscriptions.h"
+#include "BitValueIndex.h"
 
 namespace cpp::bit
 {
@@ -10,29 +16,147 @@ namespace cpp::bit
     {
     public:
         typedef std::function<void( Object )> Handler;
+        typedef std::function<void( uint64_t sequence, Memory records )> AppendHandler;
+
+        enum class Durability
+        {
+            None,                                                               // written, left to the OS to sync
+            Batch,                                                              // synced after each batch is written
+            Interval                                                            // synced at most once per interval
+        };
+
+        //  Returned by each update.  With group commit enabled, wait( ) blocks until the batch holding the
+        //  update is written and synced as the durability requires.  Otherwise the update is already written.
+        class Ticket
+        {
+        public:
+                                            Ticket( );
+
+            bool                            isCommitted( ) const;
+            void                            wait( ) const;                      // rethrows a write error
+
+        private:
+            friend class BitFile;
+                                            Ticket( const BitFile * file, uint64_t sequence );
+
+            const BitFile *                 m_file;
+            uint64_t                        m_sequence;
+        };
 
                                             BitFile( );
                                             BitFile( FilePath filename, Handler handler = nullptr );
+                                            ~BitFile( );
 
         const FilePath &                    filename( ) const;
-        const Object &                      data( ) const;
+        const Object &                      data( ) const;                      // empty with values on disk
 
         void                                load( FilePath filename, Handler handler = nullptr );
-        void                                reload( );
+        void                                reload( );                          // rewrites the file, or only reindexes it with values on disk
 
         bool                                isOpen( ) const;
+
+        void                                enableIndex(                        // maintains the sidecar index on each write
+                                                size_t prefixDepth = BitIndex::DefaultPrefixDepth );
+        const BitIndex &                    index( ) const;
+
+        void                                enableGroupCommit(                  // updates from any thread are queued and written in batches
+                                                Durability durability = Durability::Batch,
+                                                Duration interval = Duration::ofMillis( 10 ) );
+        void                                commit( );                          // waits for every queued update
+
+        void                                enableImage( );                     // saves a binary image at each compaction, for faster opens
+
+        void                                enableFraming(                      // before load( ), CRC frames each append, see BitFrames
+                                                size_t checkpointInterval = 1024 * 1024 );
+
+        void                                enableValuesOnDisk(                 // before load( ), keeps only the keys in memory, see BitValueIndex
+                                                size_t cacheLength = BitValueIndex::DefaultCacheLength );
+
+        void                                enableCompaction(                   // compacts on a worker thread once too little of the file is live
+                                                double minLiveRatio = 0.5,
+                                                size_t minLength = 1024 * 1024 );
+        void                                compact( );                         // starts a background compaction now
+        bool                                isCompacting( ) const;
         
-        Memory                              get( Memory key ) const;
-        void                                set( Memory key, Memory value );
-        void                                remove( Memory key );
+        void                                createFieldIndex(                   // see Object::createIndex( ), kept across reloads
+                                                Memory arrayKey,
+                                                Memory field,
+                                                Object::IndexType type = Object::IndexType::Hash );
+        std::vector<std::string>            findItems( Memory arrayKey, Memory field, Memory value ) const;
+        std::vector<std::string>            findItems( Memory arrayKey, Memory field, Memory first, Memory last ) const;
+
+        Memory                              get( Memory key ) const;            // not with values on disk, valid until key is next updated
+        std::optional<std::string>          getCopy( Memory key ) const;        // a copy, empty if key has no value
+        Ticket                              set( Memory key, Memory value );
+        Ticket                              remove( Memory key );
+        Ticket                              assign( const Object & data );     // writes only the records which differ, not with values on disk
+        Ticket                              append( Memory records );           // applies and writes encoded records, e.g. from a primary
+
+        BitSubscriptions::Id                subscribe(                          // called on the updating thread with the keys each update changes
+                                                Memory prefix,
+                                                BitSubscriptions::Handler handler );
+        BitSubscriptions::Id                subscribe( const BitSelector & selector, BitSubscriptions::Handler handler );
+        void                                unsubscribe( BitSubscriptions::Id id );
+
+        void                                setAppendHandler(                   // called on the writing thread after each append is written
+                                                AppendHandler handler );
+        Object                              snapshot( uint64_t * sequence = nullptr ) const;   // with the sequence of the last append it holds
 
     private:
-        void                                write( Memory line );
+        void                                open( );
+        bool                                loadImage( );
+        void                                recoverFrames( );
+        void                                loadValues( );
+        bool                                loadParallel( );
+        Ticket                              write( Memory records );
+        void                                writeFile( Memory records );
+        void                                writeBatches( );
+        void                                writeCheckpoint( );
+        void                                checkCompaction( );
+        void                                countDeadBytes( const std::vector<Decoder::ValueRecord> & values );
+        void                                compactFile( );
+        void                                replaceFile( const FilePath & filename );
+        void                                createFieldIndexes( );
 
     private:
         FilePath                            m_filename;
         Handler                             m_handler;
         File                                m_file;
         Object                              m_data;
+        BitIndex                            m_index;
+        bool                                m_isIndexed = false;
+        std::vector<std::tuple<std::string, std::string, Object::IndexType>> m_fieldIndexes;
+
+        mutable Mutex                       m_mutex;                            // guards m_data and the group commit queue
+        bool                                m_isGroupCommit = false;
+        Durability                          m_durability = Durability::None;
+        Duration                            m_interval;
+        String                              m_pending;                          // encoded records waiting for the writer
+        uint64_t                            m_queued = 0;                       // sequence of the last queued update
+        uint64_t                            m_written = 0;
+        uint64_t                            m_committed = 0;
+        std::exception_ptr                  m_error;
+        bool                                m_isWriting = false;                // the writer is appending a batch
+        Thread                              m_writer;
+
+        bool                                m_isCompactionEnabled = false;
+        double                              m_minLiveRatio = 0.5;
+        size_t                              m_minCompactLength = 0;
+        size_t                              m_length = 0;                       // file length, including queued records
+        size_t                              m_deadBytes = 0;                    // estimated bytes of overwritten or removed records
+        bool                                m_isCompacting = false;
+        bool                                m_isImaged = false;
+        Thread                              m_compactor;
+
+        bool                                m_isFramed = false;
+        size_t                              m_checkpointInterval = 0;
+        uint64_t                            m_sequence = 0;                     // sequence of the last append (frame) written
+        AppendHandler                       m_appendHandler;
+        size_t                              m_sinceCheckpoint = 0;              // bytes written since the last checkpoint
+
+        bool                                m_isValueOnDisk = false;            // m_data stays empty, m_values holds the keys
+        BitValueIndex                       m_values;
+
+        BitSubscriptions                    m_subscriptions;
     };
 }
\ No newline at end of file
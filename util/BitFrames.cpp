@@ -0,0 +1,256 @@
+#ifndef TEST
+
+#include <charconv>
+
+#include "../../cpp/util/BitFrames.h"
+#include "../../cpp/data/Crc32c.h"
+
+
+namespace cpp::bit
+{
+    struct FrameHeader
+    {
+        bool                                isCheckpoint = false;
+        uint64_t                            sequence = 0;
+        uint64_t                            length = 0;             // frames
+        uint64_t                            offset = 0;             // checkpoints
+        uint32_t                            crc = 0;
+    };
+
+
+    bool parseField( Memory & line, Memory name, uint64_t & value, int radix = 10 )
+    {
+        if ( line.length( ) <= name.length( ) || line.substr( 0, name.length( ) ) != name || line[name.length( )] != '=' )
+            { return false; }
+
+        const char * begin = line.begin( ) + name.length( ) + 1;
+        auto result = std::from_chars( begin, line.end( ), value, radix );
+        if ( result.ec != std::errc{ } || result.ptr == begin )
+            { return false; }
+
+        line = Memory{ result.ptr, line.end( ) };
+        if ( line.notEmpty( ) && line[0] == ' ' )
+            { line = line.substr( 1 ); }
+        return true;
+    }
+
+
+    //  "//# frame=<sequence> length=<bytes> crc=<hex>" or "//# checkpoint=<sequence> offset=<offset> crc=<hex>"
+    bool parseHeader( Memory line, FrameHeader & header )
+    {
+        Memory Prefix = "//# ";
+        if ( line.length( ) < Prefix.length( ) || line.substr( 0, Prefix.length( ) ) != Prefix )
+            { return false; }
+
+        line = line.substr( Prefix.length( ) );
+        Memory fields = line;
+        uint64_t crc;
+
+        header.isCheckpoint = line.substr( 0, 10 ) == "checkpoint";
+        bool isValid = header.isCheckpoint
+            ? parseField( line, "checkpoint", header.sequence ) && parseField( line, "offset", header.offset )
+            : parseField( line, "frame", header.sequence ) && parseField( line, "length", header.length );
+
+        if ( header.isCheckpoint && isValid )
+            { fields = fields.substr( 0, fields.length( ) - line.length( ) - 1 ); }
+
+        if ( !isValid || !parseField( line, "crc", crc, 16 ) || line.notEmpty( ) )
+            { return false; }
+
+        header.crc = (uint32_t)crc;
+        return !header.isCheckpoint || Crc32c::compute( fields ) == header.crc;     // checkpoints protect themselves
+    }
+
+
+    String formatCrc( uint32_t crc )
+    {
+        char digits[8];
+        for ( int index = 7; index >= 0; index--, crc >>= 4 )
+            { digits[index] = "0123456789abcdef"[crc & 0xf]; }
+        return String{ digits, sizeof( digits ) };
+    }
+
+
+
+    String BitFrames::frame( uint64_t sequence, Memory records )
+    {
+        String result = format( "//# frame=% length=% crc=%\n", sequence, records.length( ), formatCrc( Crc32c::compute( records ) ) );
+        result.append( records );
+        return result;
+    }
+
+
+    String BitFrames::checkpoint( uint64_t sequence, size_t offset )
+    {
+        String fields = format( "checkpoint=% offset=%", sequence, offset );
+        return format( "//# % crc=%\n", fields, formatCrc( Crc32c::compute( fields ) ) );
+    }
+
+
+    BitFrames::Recovery BitFrames::scan( Memory text, size_t pos, uint64_t sequence )
+    {
+        Recovery result{ pos, sequence, Memory::npos };
+        while ( pos < text.length( ) )
+        {
+            size_t end = text.find( '\n', pos );
+            FrameHeader header;
+            if ( end == Memory::npos || !parseHeader( text.substr( pos, end - pos ), header ) )
+                { break; }
+
+            if ( header.isCheckpoint )
+            {
+                if ( header.sequence != sequence )
+                    { break; }
+                result.checkpoint = pos;
+                pos = end + 1;
+            }
+            else
+            {
+                size_t begin = end + 1;
+                if ( header.sequence != sequence + 1 || header.length > text.length( ) - begin
+                    || Crc32c::compute( text.substr( begin, (size_t)header.length ) ) != header.crc )
+                    { break; }
+
+                sequence = header.sequence;
+                pos = begin + (size_t)header.length;
+            }
+
+            result.length = pos;
+            result.sequence = sequence;
+        }
+        return result;
+    }
+
+
+    //  Reads back from the end of the file in growing windows until the last checkpoint is found.  A file
+    //  without any checkpoint was never framed, and is valid as it is.
+    BitFrames::Recovery BitFrames::recover( File & file )
+    {
+        const Memory Marker = "//# checkpoint=";
+
+        size_t length = file.length( );
+        size_t window = 64 * 1024;
+        std::string buffer;
+        while ( true )
+        {
+            size_t start = length > window ? length - window : 0;
+            buffer.resize( length - start );
+            file.seek( start );
+            for ( size_t pos = 0; pos < buffer.length( ); )
+            {
+                Memory data = file.read( Memory{ buffer.data( ) + pos, buffer.length( ) - pos } );
+                check<IOException>( data.notEmpty( ), "BitFrames::recover( ) : unable to read the file" );
+                pos += data.length( );
+            }
+
+            Memory text = buffer;
+            for ( size_t pos = text.rfind( Marker ); pos != Memory::npos; pos = pos ? text.rfind( Marker, pos - 1 ) : Memory::npos )
+            {
+                size_t end = text.find( '\n', pos );
+                FrameHeader header;
+                bool isLineStart = pos > 0 ? text[pos - 1] == '\n' : start == 0;
+                if ( isLineStart && end != Memory::npos && parseHeader( text.substr( pos, end - pos ), header ) && header.offset == start + pos )
+                {
+                    Recovery result = scan( text, pos, header.sequence );
+                    result.length += start;
+                    result.checkpoint += start;
+                    return result;
+                }
+            }
+
+            if ( start == 0 )
+                { return Recovery{ length, 0, Memory::npos }; }
+            window *= 4;
+        }
+    }
+}
+
+#else
+
+#include "../../cpp/meta/Test.h"
+#include "../../cpp/data/Crc32c.h"
+#include "../../cpp/util/BitFrames.h"
+#include "../../cpp/util/Bit.h"
+
+using namespace cpp;
+
+TEST_CASE( "Crc32c" )
+{
+	CHECK( Crc32c::software( 0, "123456789" ) == 0xE3069283 );
+	CHECK( Crc32c::compute( "123456789" ) == 0xE3069283 );
+	CHECK( Crc32c::compute( "" ) == 0 );
+
+	std::string data( 1000, ' ' );
+	for ( size_t index = 0; index < data.length( ); index++ )
+		{ data[index] = (char)( index * 7 ); }
+
+	Memory text = data;
+	CHECK( Crc32c::compute( text ) == Crc32c::software( 0, text ) );
+	CHECK( Crc32c::extend( Crc32c::compute( text.substr( 0, 333 ) ), text.substr( 333 ) ) == Crc32c::compute( text ) );
+}
+
+
+TEST_CASE( "BitFrames" )
+{
+	String text;
+	text += "server : ip='10.5.5.102'\n";						// unframed beginning, e.g. a compacted snapshot
+	text += bit::BitFrames::checkpoint( 2, text.length( ) );
+	text += bit::BitFrames::frame( 3, "server.port='10667'\n" );
+	text += bit::BitFrames::frame( 4, "client.name=(3)'a\nb'\n" );
+	size_t checkpoint = text.length( );
+	text += bit::BitFrames::checkpoint( 4, checkpoint );
+	text += bit::BitFrames::frame( 5, "server.port='10668'\n" );
+	size_t valid = text.length( );
+
+	//	frames are comments to the decoder
+	auto data = bit::decode( text );
+	CHECK( data["server.port"] == "10668" );
+	CHECK( data["client.name"] == "a\nb" );
+
+	auto result = bit::BitFrames::scan( text, 0, 0 );
+	CHECK( result.length == 0 );							// not a frame
+
+	size_t first = text.find( "//# checkpoint" );
+	result = bit::BitFrames::scan( text, first, 2 );
+	CHECK( result.length == valid );
+	CHECK( result.sequence == 5 );
+	CHECK( result.checkpoint == checkpoint );
+
+	//	torn, damaged, and out of sequence frames end the valid part
+	String torn = text + bit::BitFrames::frame( 6, "server.port='10669'\n" ).substr( 0, 30 );
+	CHECK( bit::BitFrames::scan( torn, first, 2 ).length == valid );
+
+	String damaged = text;
+	damaged.data[damaged.length( ) - 3] = 'x';
+	CHECK( bit::BitFrames::scan( damaged, first, 2 ).length == checkpoint + bit::BitFrames::checkpoint( 4, checkpoint ).length( ) );
+
+	String skipped = text + bit::BitFrames::frame( 7, "server.port='10669'\n" );
+	CHECK( bit::BitFrames::scan( skipped, first, 2 ).length == valid );
+
+	//	recovery starts at the last checkpoint of the file
+	FilePath filename = "test-frames.bit";
+	auto file = File::create( filename );
+	file.write( torn );
+	file.close( );
+
+	file = File::readFrom( filename );
+	auto recovery = bit::BitFrames::recover( file );
+	CHECK( recovery.length == valid );
+	CHECK( recovery.sequence == 5 );
+	CHECK( recovery.checkpoint == checkpoint );
+	file.close( );
+
+	file = File::create( filename );
+	file.write( "server.ip='10.0.0.1'\n" );			// never framed
+	file.close( );
+
+	file = File::readFrom( filename );
+	recovery = bit::BitFrames::recover( file );
+	CHECK( recovery.length == file.length( ) );
+	CHECK( recovery.checkpoint == Memory::npos );
+	file.close( );
+
+	Files::remove( filename );
+}
+
+#endif
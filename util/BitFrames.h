@@ -0,0 +1,47 @@
+#pragma once
+
+/*
+
+BitFrames protects the records appended to a Bit file.  Each append is preceded by a frame header which
+carries a sequence number, the length of the records and their CRC-32C:
+
+	//# frame=12 length=38 crc=5a3c0f1e
+	server : ip='10.5.5.102' port='10667'
+
+Checkpoint lines mark positions which were synced with every frame before them valid, so recovery only
+checks the frames after the last checkpoint.  Since both are comments, framed files still decode as bit.
+
+	//# checkpoint=12 offset=4096 crc=0b51e7a2
+
+Recovery returns the length of the valid prefix, so a torn final write is cut off at the last complete
+frame rather than being read as data.
+
+	auto file = File::open( "data.bit" );
+	auto recovery = bit::BitFrames::recover( file );
+	if ( recovery.length < file.length( ) )
+		{ file.truncate( recovery.length ); }
+
+*/
+
+#include "../../cpp/file/File.h"
+#include "../../cpp/data/String.h"
+
+
+namespace cpp::bit
+{
+    struct BitFrames
+    {
+        struct Recovery
+        {
+            size_t                          length;                 // end of the last valid frame or checkpoint
+            uint64_t                        sequence;               // sequence of the last valid frame
+            size_t                          checkpoint;             // offset of the last checkpoint, or npos
+        };
+
+        static String                       frame( uint64_t sequence, Memory records );
+        static String                       checkpoint( uint64_t sequence, size_t offset );    // offset of the checkpoint line itself
+
+        static Recovery                     scan( Memory text, size_t pos, uint64_t sequence );  // validates the frames from pos
+        static Recovery                     recover( File & file );                             // scans from the last checkpoint
+    };
+}
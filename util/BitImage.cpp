@@ -0,0 +1,440 @@
+#ifndef TEST
+
+#include <algorithm>
+#include <cstring>
+
+#include "../../cpp/util/BitImage.h"
+#include "../../cpp/data/Crc32c.h"
+#include "../../cpp/file/MemoryFile.h"
+
+
+namespace cpp::bit
+{
+    //  Layout: the header page, then page-aligned tables of keys, nulled keys, records, record items and
+    //  live counts (all in their sorted or recorded order), then the heap of key and value text.
+    struct BitImage::Detail
+    {
+        static constexpr char               Magic[8] = { 'B', 'I', 'T', 'I', 'M', 'A', 'G', 'E' };
+        static constexpr uint32_t           Version = 2;                        // 2: the fingerprint covers all of the text
+
+        struct Ref                                                              // text in the heap
+        {
+            uint64_t                        offset;
+            uint64_t                        length;
+        };
+
+        struct KeyEntry
+        {
+            Ref                             key;
+            Ref                             value;
+        };
+
+        struct RecordEntry
+        {
+            Ref                             name;
+            uint64_t                        firstItem;
+            uint64_t                        itemCount;
+        };
+
+        struct CountEntry
+        {
+            Ref                             key;
+            uint64_t                        count;
+        };
+
+        struct Table
+        {
+            uint64_t                        offset;
+            uint64_t                        count;                              // entries, or bytes for the heap
+        };
+
+        struct Header
+        {
+            char                            magic[8];
+            uint32_t                        version;
+            uint32_t                        pageSize;
+            uint64_t                        imageLength;
+            uint64_t                        textLength;
+            uint64_t                        textFingerprint;
+            Table                           keys;
+            Table                           nulled;                             // Ref entries
+            Table                           records;
+            Table                           items;                              // Ref entries
+            Table                           counts;
+            Table                           heap;
+        };
+
+        bool                                validate( );
+        Memory                              text( const Ref & ref ) const;
+        template<class T> const T *         table( const Table & table ) const
+                                                { return reinterpret_cast<const T *>( image.begin( ) + table.offset ); }
+
+        String                              buffer;                             // owned image, or
+        MemoryFile                          file;                               // mapped image
+        Memory                              image;
+        const Header *                      header = nullptr;
+    };
+
+
+    bool BitImage::Detail::validate( )
+    {
+        if ( image.length( ) < sizeof( Header ) )
+            { return false; }
+
+        auto h = reinterpret_cast<const Header *>( image.begin( ) );
+        if ( std::memcmp( h->magic, Magic, sizeof( Magic ) ) != 0 || h->version != Version || h->imageLength != image.length( ) )
+            { return false; }
+
+        auto fits = [&]( const Table & table, size_t entrySize )
+            { return table.offset <= image.length( ) && table.count <= ( image.length( ) - table.offset ) / entrySize; };
+
+        if ( !fits( h->keys, sizeof( KeyEntry ) ) || !fits( h->nulled, sizeof( Ref ) ) || !fits( h->records, sizeof( RecordEntry ) )
+            || !fits( h->items, sizeof( Ref ) ) || !fits( h->counts, sizeof( CountEntry ) ) || !fits( h->heap, 1 ) )
+            { return false; }
+
+        header = h;
+        return true;
+    }
+
+
+    //  Refs are checked on use, so a damaged heap can't read outside the image.
+    Memory BitImage::Detail::text( const Ref & ref ) const
+    {
+        check<DecodeException>( ref.offset <= header->heap.count && ref.length <= header->heap.count - ref.offset,
+            "BitImage : text reference is outside of the image" );
+        return Memory{ image.begin( ) + header->heap.offset + ref.offset, (size_t)ref.length };
+    }
+
+
+
+    FilePath BitImage::sidecar( const FilePath & filename )
+    {
+        return FilePath{ filename }.concat( ".image" );
+    }
+
+
+    //  CRC-32C of all of the text with its length, so any rewrite of the imaged text is told apart, not only
+    //  one which changes its end.  A short read (the text was truncated) can't match the saved fingerprint.
+    uint64_t BitImage::fingerprint( File & text, size_t textLength )
+    {
+        char buffer[16 * PageSize];
+        uint32_t crc = 0;
+
+        text.seek( 0 );
+        for ( size_t remaining = textLength; remaining > 0; )
+        {
+            Memory data = text.read( Memory{ buffer, std::min( remaining, sizeof( buffer ) ) } );
+            if ( data.isEmpty( ) )
+                { break; }
+            crc = Crc32c::extend( crc, data );
+            remaining -= data.length( );
+        }
+
+        return ( (uint64_t)textLength << 32 ) ^ crc;
+    }
+
+
+    String BitImage::encode( const Object & object, size_t textLength, uint64_t textFingerprint )
+    {
+        auto & content = object.data( );
+
+        std::string heap;
+        auto put = [&heap]( const std::string & text )
+        {
+            Detail::Ref ref{ heap.length( ), text.length( ) };
+            heap += text;
+            return ref;
+        };
+
+        std::vector<Detail::KeyEntry> keys;
+        keys.reserve( content.keys.size( ) );
+        for ( auto & entry : content.keys )
+            { keys.push_back( Detail::KeyEntry{ put( entry.first ), put( entry.second ) } ); }
+
+        std::vector<Detail::Ref> nulled;
+        nulled.reserve( content.nulled.size( ) );
+        for ( auto & key : content.nulled )
+            { nulled.push_back( put( key ) ); }
+
+        std::vector<Detail::RecordEntry> records;
+        std::vector<Detail::Ref> items;
+        for ( auto & record : content.records )
+        {
+            records.push_back( Detail::RecordEntry{ put( record.first ), items.size( ), record.second.size( ) } );
+            for ( size_t index = 0; index < record.second.size( ); index++ )
+                { items.push_back( put( record.second.getAt( index ) ) ); }
+        }
+
+        std::vector<Detail::CountEntry> counts;
+        for ( auto & entry : content.liveCounts )
+            { counts.push_back( Detail::CountEntry{ put( entry.first ), entry.second } ); }
+
+        Detail::Header header{ };
+        std::memcpy( header.magic, Detail::Magic, sizeof( header.magic ) );
+        header.version = Detail::Version;
+        header.pageSize = PageSize;
+        header.textLength = textLength;
+        header.textFingerprint = textFingerprint;
+
+        size_t length = PageSize;
+        auto place = [&length]( Detail::Table & table, size_t count, size_t entrySize )
+        {
+            table = Detail::Table{ length, count };
+            length = ( length + count * entrySize + PageSize - 1 ) / PageSize * PageSize;
+        };
+        place( header.keys, keys.size( ), sizeof( Detail::KeyEntry ) );
+        place( header.nulled, nulled.size( ), sizeof( Detail::Ref ) );
+        place( header.records, records.size( ), sizeof( Detail::RecordEntry ) );
+        place( header.items, items.size( ), sizeof( Detail::Ref ) );
+        place( header.counts, counts.size( ), sizeof( Detail::CountEntry ) );
+        place( header.heap, heap.length( ), 1 );
+        header.imageLength = length;
+
+        std::string image( length, '\0' );
+        auto copy = [&image]( const Detail::Table & table, const void * data, size_t size )
+            { if ( size ) { std::memcpy( image.data( ) + table.offset, data, size ); } };
+        copy( Detail::Table{ 0, 1 }, &header, sizeof( header ) );
+        copy( header.keys, keys.data( ), keys.size( ) * sizeof( Detail::KeyEntry ) );
+        copy( header.nulled, nulled.data( ), nulled.size( ) * sizeof( Detail::Ref ) );
+        copy( header.records, records.data( ), records.size( ) * sizeof( Detail::RecordEntry ) );
+        copy( header.items, items.data( ), items.size( ) * sizeof( Detail::Ref ) );
+        copy( header.counts, counts.data( ), counts.size( ) * sizeof( Detail::CountEntry ) );
+        copy( header.heap, heap.data( ), heap.length( ) );
+
+        return String{ std::move( image ) };
+    }
+
+
+    void BitImage::save( const FilePath & imageFilename, const Object & object, File & text, size_t textLength )
+    {
+        String image = encode( object, textLength, fingerprint( text, textLength ) );
+
+        auto tempFilename = FilePath{ imageFilename }.concat( ".tmp" );
+        auto file = File::create( tempFilename );
+        file.write( image );
+        file.flush( );
+        file.close( );
+
+        if ( Files::exists( imageFilename ) )
+            { Files::remove( imageFilename ); }
+        Files::rename( tempFilename, imageFilename );
+    }
+
+
+    BitImage BitImage::open( const FilePath & imageFilename )
+    {
+        BitImage result;
+        if ( !Files::exists( imageFilename ) )
+            { return result; }
+
+        try
+        {
+            auto detail = std::make_shared<Detail>( );
+            detail->file = MemoryFile::read( imageFilename );
+            detail->image = detail->file.data( );
+            if ( detail->validate( ) )
+                { result.m_detail = detail; }
+        }
+        catch ( std::exception & )
+        {
+        }
+        return result;
+    }
+
+
+
+    BitImage::BitImage( )
+    {
+    }
+
+
+    BitImage::BitImage( String image )
+        : m_detail{ std::make_shared<Detail>( ) }
+    {
+        m_detail->buffer = std::move( image );
+        m_detail->image = m_detail->buffer;
+        if ( !m_detail->validate( ) )
+            { m_detail.reset( ); }
+    }
+
+
+    bool BitImage::isValid( ) const
+    {
+        return m_detail != nullptr;
+    }
+
+
+    bool BitImage::covers( File & text ) const
+    {
+        if ( !isValid( ) || text.length( ) < textLength( ) )
+            { return false; }
+        return fingerprint( text, textLength( ) ) == m_detail->header->textFingerprint;
+    }
+
+
+    size_t BitImage::textLength( ) const
+    {
+        return isValid( ) ? (size_t)m_detail->header->textLength : 0;
+    }
+
+
+    size_t BitImage::size( ) const
+    {
+        return isValid( ) ? (size_t)m_detail->header->keys.count : 0;
+    }
+
+
+    Memory BitImage::get( Memory key ) const
+    {
+        if ( !isValid( ) )
+            { return nullptr; }
+
+        auto & detail = *m_detail;
+        auto keys = detail.table<Detail::KeyEntry>( detail.header->keys );
+        auto end = keys + detail.header->keys.count;
+        auto itr = std::lower_bound( keys, end, key, [&detail]( const Detail::KeyEntry & entry, Memory key )
+            { return Memory::compare( detail.text( entry.key ), key ) < 0; } );
+
+        if ( itr == end || detail.text( itr->key ) != key )
+            { return nullptr; }
+
+        Memory value = detail.text( itr->value );
+        return value == NullValue ? Memory{ nullptr } : value;
+    }
+
+
+    bool BitImage::isNulled( Memory key ) const
+    {
+        if ( !isValid( ) )
+            { return false; }
+
+        auto & detail = *m_detail;
+        auto nulled = detail.table<Detail::Ref>( detail.header->nulled );
+        auto end = nulled + detail.header->nulled.count;
+        auto itr = std::lower_bound( nulled, end, key, [&detail]( const Detail::Ref & ref, Memory key )
+            { return Memory::compare( detail.text( ref ), key ) < 0; } );
+
+        return itr != end && detail.text( *itr ) == key;
+    }
+
+
+    //  The tables are already in map order, so each insert is at the end.
+    Object BitImage::load( ) const
+    {
+        Object result;
+        if ( !isValid( ) )
+            { return result; }
+
+        auto & detail = *m_detail;
+        auto & header = *detail.header;
+        auto & content = result.writable( );
+
+        auto keys = detail.table<Detail::KeyEntry>( header.keys );
+        for ( size_t index = 0; index < header.keys.count; index++ )
+            { content.keys.emplace_hint( content.keys.end( ), detail.text( keys[index].key ).toString( ), detail.text( keys[index].value ).toString( ) ); }
+
+        auto nulled = detail.table<Detail::Ref>( header.nulled );
+        for ( size_t index = 0; index < header.nulled.count; index++ )
+            { content.nulled.emplace_hint( content.nulled.end( ), detail.text( nulled[index] ).toString( ) ); }
+
+        auto records = detail.table<Detail::RecordEntry>( header.records );
+        auto items = detail.table<Detail::Ref>( header.items );
+        for ( size_t index = 0; index < header.records.count; index++ )
+        {
+            auto & record = records[index];
+            check<DecodeException>( record.firstItem <= header.items.count && record.itemCount <= header.items.count - record.firstItem,
+                "BitImage : record items are outside of the image" );
+
+            auto & set = content.records.emplace_hint( content.records.end( ), detail.text( record.name ).toString( ), IndexedSet<std::string>{ } )->second;
+            set.reserve( (size_t)record.itemCount );
+            for ( size_t item = 0; item < record.itemCount; item++ )
+                { set.add( detail.text( items[record.firstItem + item] ).toString( ) ); }
+        }
+
+        auto counts = detail.table<Detail::CountEntry>( header.counts );
+        for ( size_t index = 0; index < header.counts.count; index++ )
+            { content.liveCounts.emplace_hint( content.liveCounts.end( ), detail.text( counts[index].key ).toString( ), (size_t)counts[index].count ); }
+
+        return result;
+    }
+}
+
+#else
+
+#include "../../cpp/meta/Test.h"
+#include "../../cpp/util/BitImage.h"
+
+using namespace cpp;
+
+TEST_CASE( "BitImage" )
+{
+	auto data = bit::decode(
+		"server : ip='10.5.5.102' port='10667'\n"
+		"region[west] : count='3'\n"
+		"region[east] : count='4'\n"
+		"region[north].count='5'\n"
+		"region[north] : null\n"
+		"client.name=(3)'a\nb'\n" );
+
+	String text = data.encodeRaw( );
+	bit::BitImage image{ bit::BitImage::encode( data, text.length( ), 0 ) };
+	REQUIRE( image.isValid( ) );
+	CHECK( image.textLength( ) == text.length( ) );
+
+	//	searched in place
+	CHECK( image.get( "server.ip" ) == "10.5.5.102" );
+	CHECK( image.get( "client.name" ) == "a\nb" );
+	CHECK( image.get( "server.host" ).isNull( ) );
+	CHECK( image.get( "region[north]" ).isNull( ) );
+	CHECK( image.isNulled( "region[north]" ) );
+	CHECK( !image.isNulled( "region[west]" ) );
+
+	//	bulk-loaded with the same keys, nulled keys and record order
+	auto loaded = image.load( );
+	CHECK( loaded.encode( ) == data.encode( ) );
+	CHECK( bit::diff( data, loaded ).isEmpty( ) );
+	CHECK( loaded["region"].asArray( ).size( ) == data["region"].asArray( ).size( ) );
+
+	loaded["region[south].count"] = "6";
+	CHECK( loaded["region"].asArray( ).size( ) == data["region"].asArray( ).size( ) + 1 );
+
+	//	damaged images are rejected
+	String damaged = bit::BitImage::encode( data, text.length( ), 0 );
+	damaged.data.resize( damaged.length( ) - 1 );
+	CHECK( !bit::BitImage{ damaged }.isValid( ) );
+	CHECK( !bit::BitImage{ "BITIMAGE" }.isValid( ) );
+
+	//	an image only covers the text it was saved with
+	FilePath filename = "test-image.bit";
+	FilePath imageFilename = bit::BitImage::sidecar( filename );
+
+	auto file = File::create( filename );
+	file.write( text );
+	file.close( );
+
+	{
+		auto textFile = File::readFrom( filename );
+		bit::BitImage::save( imageFilename, data, textFile, text.length( ) );
+	}
+
+	{
+		auto textFile = File::readFrom( filename );
+		auto saved = bit::BitImage::open( imageFilename );
+		CHECK( saved.covers( textFile ) );
+		CHECK( saved.get( "region[east].count" ) == "4" );
+	}
+
+	file = File::create( filename );
+	file.write( "server.ip='10.0.0.1'\n" );
+	file.close( );
+
+	{
+		auto textFile = File::readFrom( filename );
+		CHECK( !bit::BitImage::open( imageFilename ).covers( textFile ) );
+	}
+
+	Files::remove( filename );
+	Files::remove( imageFilename );
+}
+
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+
+/*
+
+BitImage is a binary snapshot of an Object which covers the beginning of a Bit file, so opening the file
+only needs to replay the text written after it.  The sorted keys and values, the nulled keys and the
+array records are stored in page-aligned tables, so the image can be memory-mapped and searched in place,
+or bulk-loaded into an Object without decoding.
+
+The image records the length of the text it covers along with a CRC-32C of all of that text, and is only
+used while the Bit file still begins with that text.  Checking it reads the covered text once, which is
+still much less work than decoding it.
+
+	auto image = bit::BitImage::open( bit::BitImage::sidecar( "data.bit" ) );
+	auto file = File::readFrom( "data.bit" );
+	if ( image.covers( file ) )
+	{
+		Memory ip = image.get( "server.ip" );			// binary search of the mapped keys
+		Object data = image.load( );					// then replay the text from image.textLength( )
+	}
+
+*/
+
+#include "../../cpp/file/File.h"
+#include "../../cpp/util/Bit.h"
+
+
+namespace cpp::bit
+{
+    class BitImage
+    {
+    public:
+        static constexpr size_t             PageSize = 4096;
+
+        static FilePath                     sidecar( const FilePath & filename );   // i.e. filename + ".image"
+        static uint64_t                     fingerprint( File & text, size_t textLength );
+        static String                       encode(                                 // image of the whole Object
+                                                const Object & object,
+                                                size_t textLength,
+                                                uint64_t textFingerprint );
+        static void                         save(                                   // writes the image to a temporary file and renames it
+                                                const FilePath & imageFilename,
+                                                const Object & object,
+                                                File & text,
+                                                size_t textLength );
+        static BitImage                     open( const FilePath & imageFilename ); // maps the image, invalid if missing or damaged
+
+                                            BitImage( );
+                                            BitImage( String image );
+
+        bool                                isValid( ) const;
+        bool                                covers( File & text ) const;           // text still begins with the imaged text
+        size_t                              textLength( ) const;
+        size_t                              size( ) const;                          // number of keys
+
+        Memory                              get( Memory key ) const;               // null if the key has no value
+        bool                                isNulled( Memory key ) const;
+        Object                              load( ) const;
+
+    private:
+        struct Detail;
+        std::shared_ptr<Detail>             m_detail;
+    };
+}
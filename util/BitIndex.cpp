@@ -0,0 +1,523 @@
+#ifndef TEST
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+#include "../../cpp/util/BitIndex.h"
+#include "../../cpp/data/DataBuffer.h"
+#include "../../cpp/data/Integer.h"
+
+
+namespace cpp::bit
+{
+    //  Returns the first depth segments of key.  A segment begins at an unbracketed '.' or '['.
+    Memory keyPrefix( Memory key, size_t depth )
+    {
+        int brackets = 0;
+        for ( size_t pos = 1; pos < key.length( ); pos++ )
+        {
+            char c = key[pos];
+            if ( c == ']' && brackets > 0 )
+                { brackets--; }
+            else if ( brackets == 0 && ( c == '.' || c == '[' ) && --depth == 0 )
+                { return key.substr( 0, pos ); }
+
+            if ( c == '[' )
+                { brackets++; }
+        }
+        return key;
+    }
+
+
+    size_t keyDepth( Memory key )
+    {
+        size_t depth = 1;
+        while ( keyPrefix( key, depth ).length( ) < key.length( ) )
+            { depth++; }
+        return depth;
+    }
+
+
+    //  i.e. key is prefix or a subkey of prefix
+    bool isWithin( Memory key, Memory prefix )
+    {
+        size_t len = prefix.length( );
+        if ( key.length( ) < len || key.substr( 0, len ) != prefix )
+            { return false; }
+        return key.length( ) == len || key[len] == '.' || key[len] == '[';
+    }
+
+
+    Memory readRange( File & file, size_t offset, size_t length, std::string & buffer )
+    {
+        buffer.resize( length );
+        file.seek( offset );
+
+        size_t pos = 0;
+        while ( pos < length )
+        {
+            Memory data = file.read( Memory{ buffer.data( ) + pos, length - pos } );
+            if ( data.isEmpty( ) )
+                { break; }
+            pos += data.length( );
+        }
+        return Memory{ buffer.data( ), pos };
+    }
+
+
+    //  Decodes every record in buffer, stopping at the first malformed one.
+    void decodeRecords( Decoder & decoder, DataBuffer & buffer )
+    {
+        while ( buffer.getable( ) && decoder.decode( buffer ) )
+            { }
+    }
+
+
+    //  Applies the decoded values which are within key (and the erasure of its parents) to object.
+    Decoder::Handler subtreeHandler( Object & object, Memory key )
+    {
+        std::string prefix = key;
+
+        Decoder::Handler handler;
+        handler.onValue = [&object, prefix]( Memory key, Memory value )
+        {
+            if ( isWithin( key, prefix ) )
+                { object.add( key, value ); }
+        };
+        handler.onNull = [&object, prefix]( Memory key )
+        {
+            if ( isWithin( key, prefix ) )
+                { object.add( key, nullptr ); }
+        };
+        handler.onErase = [&object, prefix]( Memory key )
+        {
+            if ( isWithin( key, prefix ) || isWithin( prefix, key ) )
+                { object[key].erase( ); }
+        };
+        return handler;
+    }
+
+
+
+    struct BitIndex::Detail
+    {
+        Detail( size_t prefixDepth );
+
+        void load( const FilePath & indexFilename );
+        void index( size_t offset, Memory records );
+        void add( Range range, const std::set<std::string> & prefixList, const std::set<std::string> & eraseList, std::string & lines );
+
+        size_t prefixDepth;
+        size_t length = 0;
+        bool isSynced = true;                                                   // decoder context follows the last indexed record
+        std::vector<Range> ranges;
+        std::map<std::string, std::vector<size_t>> prefixes;                   // key prefix -> range indexes
+        std::map<std::string, std::vector<size_t>> erases;                     // erased key above prefixDepth -> range indexes
+
+        Decoder decoder;
+        std::set<std::string> recordPrefixes;
+        std::set<std::string> recordErases;
+
+        FilePath filename;
+        File file;
+    };
+
+
+    BitIndex::Detail::Detail( size_t prefixDepth )
+        : prefixDepth{ prefixDepth }
+    {
+        check<cpp::Exception>( prefixDepth > 0, "bit::BitIndex : prefixDepth must be at least 1" );
+
+        Decoder::Handler handler;
+        handler.onValue = [this]( Memory key, Memory )
+            { recordPrefixes.emplace( keyPrefix( key, this->prefixDepth ) ); };
+        handler.onNull = [this]( Memory key )
+            { recordPrefixes.emplace( keyPrefix( key, this->prefixDepth ) ); };
+        handler.onErase = [this]( Memory key )
+        {
+            recordPrefixes.emplace( keyPrefix( key, this->prefixDepth ) );
+            if ( keyDepth( key ) < this->prefixDepth )
+                { recordErases.emplace( key ); }
+        };
+        decoder = Decoder{ handler, false };
+    }
+
+
+    //  Reads the saved ranges.  The decoder context after the last range is unknown until that
+    //  record is decoded again, which update( ) does before indexing appended records.
+    void BitIndex::Detail::load( const FilePath & indexFilename )
+    {
+        filename = indexFilename;
+        if ( !Files::exists( filename ) )
+        {
+            file = File::create( filename );
+            file.write( format( "depth='%'\n", prefixDepth ) );
+            return;
+        }
+
+        Range range{ 0, 0 };
+        std::set<std::string> prefixList, eraseList;
+        std::string lines;
+
+        Decoder::Handler handler;
+        handler.onValue = [&]( Memory key, Memory value )
+        {
+            if ( key == "depth" )
+                { prefixDepth = (size_t)Integer::parseUnsigned( value ); }
+            else if ( key == "offset" )
+                { range.offset = (size_t)Integer::parseUnsigned( value ); }
+            else if ( key == "length" )
+                { range.length = (size_t)Integer::parseUnsigned( value ); }
+            else if ( key == "context" )
+                { range.context.emplace_back( value ); }
+            else if ( key == "prefix" )
+                { prefixList.emplace( value ); }
+            else if ( key == "erase" )
+                { eraseList.emplace( value ); }
+        };
+        handler.onRecordEnd = [&]( )
+        {
+            if ( range.length > 0 )
+                { add( std::move( range ), prefixList, eraseList, lines ); }
+            range = Range{ 0, 0 };
+            prefixList.clear( );
+            eraseList.clear( );
+        };
+
+        Decoder reader{ handler };
+        auto result = reader.decode( File::readFrom( filename ).input( ) );
+        if ( !result )
+            { throw Decoder::Exception{ std::move( result ) }; }
+
+        isSynced = ranges.empty( );
+        file = File::append( filename );
+    }
+
+
+    //  Indexes each complete record.  Records which end before length have already been indexed
+    //  and are only decoded to restore the key context.
+    void BitIndex::Detail::index( size_t offset, Memory records )
+    {
+        std::string lines;
+        size_t pos = 0;
+        while ( true )
+        {
+            size_t end = Decoder::findRecordEnd( records, pos );
+            if ( end == Memory::npos )
+                { break; }
+
+            Range range{ offset + pos, end - pos };
+            if ( records[pos] == '\t' )
+                { range.context = decoder.context( ); }
+
+            recordPrefixes.clear( );
+            recordErases.clear( );
+            DataBuffer buffer{ records.substr( pos, end - pos ) };
+            bool isDecoded = (bool)decoder.decode( buffer );
+
+            if ( isDecoded && range.offset >= length && !recordPrefixes.empty( ) )
+                { add( std::move( range ), recordPrefixes, recordErases, lines ); }
+
+            length = std::max( length, offset + end );
+            pos = end;
+        }
+        isSynced = true;
+
+        if ( !lines.empty( ) && file.isOpen( ) )
+            { file.write( lines ); }
+    }
+
+
+    void BitIndex::Detail::add( Range range, const std::set<std::string> & prefixList, const std::set<std::string> & eraseList, std::string & lines )
+    {
+        size_t id = ranges.size( );
+        for ( auto & prefix : prefixList )
+            { prefixes[prefix].push_back( id ); }
+        for ( auto & key : eraseList )
+            { erases[key].push_back( id ); }
+
+        auto putField = [&lines]( Memory name, Memory value )
+        {
+            lines += format( " %=(%)'", name, value.length( ) );
+            lines.append( value.begin( ), value.end( ) );
+            lines += '\'';
+        };
+
+        lines += format( "offset='%' length='%'", range.offset, range.length );
+        for ( auto & context : range.context )
+            { putField( "context", context ); }
+        for ( auto & prefix : prefixList )
+            { putField( "prefix", prefix ); }
+        for ( auto & key : eraseList )
+            { putField( "erase", key ); }
+        lines += '\n';
+
+        length = std::max( length, range.offset + range.length );
+        ranges.emplace_back( std::move( range ) );
+    }
+
+
+
+    FilePath BitIndex::sidecar( const FilePath & filename )
+    {
+        return FilePath{ filename }.concat( ".index" );
+    }
+
+
+    BitIndex BitIndex::open( const FilePath & indexFilename, size_t prefixDepth )
+    {
+        BitIndex index{ prefixDepth };
+        index.m_detail->load( indexFilename );
+        return index;
+    }
+
+
+    BitIndex::BitIndex( size_t prefixDepth )
+        : m_detail{ std::make_shared<Detail>( prefixDepth ) }
+    {
+    }
+
+
+    size_t BitIndex::prefixDepth( ) const
+    {
+        return m_detail->prefixDepth;
+    }
+
+
+    size_t BitIndex::length( ) const
+    {
+        return m_detail->length;
+    }
+
+
+    size_t BitIndex::size( ) const
+    {
+        return m_detail->ranges.size( );
+    }
+
+
+    void BitIndex::clear( )
+    {
+        auto & detail = *m_detail;
+        detail.length = 0;
+        detail.isSynced = true;
+        detail.ranges.clear( );
+        detail.prefixes.clear( );
+        detail.erases.clear( );
+        detail.decoder.setContext( { } );
+
+        if ( detail.file.isOpen( ) )
+        {
+            detail.file = File::create( detail.filename );
+            detail.file.write( format( "depth='%'\n", detail.prefixDepth ) );
+        }
+    }
+
+
+    void BitIndex::append( size_t offset, Memory records )
+    {
+        check<cpp::Exception>( offset >= m_detail->length, "bit::BitIndex::append() : records overlap the index" );
+        m_detail->index( offset, records );
+    }
+
+
+    void BitIndex::update( File & file )
+    {
+        auto & detail = *m_detail;
+        size_t fileLength = file.length( );
+        if ( fileLength < detail.length )
+            { rebuild( file ); return; }
+
+        size_t from = detail.length;
+        if ( !detail.isSynced )
+        {
+            from = detail.ranges.back( ).offset;
+            detail.decoder.setContext( detail.ranges.back( ).context );
+        }
+
+        if ( from < fileLength )
+        {
+            std::string buffer;
+            detail.index( from, readRange( file, from, fileLength - from, buffer ) );
+        }
+    }
+
+
+    void BitIndex::rebuild( File & file )
+    {
+        clear( );
+        update( file );
+    }
+
+
+    std::vector<BitIndex::Range> BitIndex::find( Memory key ) const
+    {
+        auto & detail = *m_detail;
+        size_t depth = keyDepth( key );
+        std::vector<size_t> ids;
+
+        auto collect = [&ids]( const std::vector<size_t> & list )
+            { ids.insert( ids.end( ), list.begin( ), list.end( ) ); };
+
+        if ( depth >= detail.prefixDepth )
+        {
+            auto itr = detail.prefixes.find( keyPrefix( key, detail.prefixDepth ).toString( ) );
+            if ( itr != detail.prefixes.end( ) )
+                { collect( itr->second ); }
+        }
+        else
+        {
+            //  shorter keys match every prefix within them
+            for ( auto itr = detail.prefixes.lower_bound( key.toString( ) ); itr != detail.prefixes.end( ); itr++ )
+            {
+                Memory prefix = itr->first;
+                if ( prefix.substr( 0, key.length( ) ) != key )
+                    { break; }
+                if ( isWithin( prefix, key ) )
+                    { collect( itr->second ); }
+            }
+        }
+
+        //  erasing a parent key also removes key
+        for ( size_t level = 1; level < std::min( depth, detail.prefixDepth ); level++ )
+        {
+            auto itr = detail.erases.find( keyPrefix( key, level ).toString( ) );
+            if ( itr != detail.erases.end( ) )
+                { collect( itr->second ); }
+        }
+
+        std::sort( ids.begin( ), ids.end( ) );
+        ids.erase( std::unique( ids.begin( ), ids.end( ) ), ids.end( ) );
+
+        std::vector<Range> result;
+        result.reserve( ids.size( ) );
+        for ( size_t id : ids )
+            { result.push_back( detail.ranges[id] ); }
+        return result;
+    }
+
+
+    Object BitIndex::lookup( Memory text, Memory key ) const
+    {
+        Object object;
+        Decoder decoder{ subtreeHandler( object, key ) };
+
+        auto ranges = find( key );
+        for ( size_t i = 0; i < ranges.size( ); )
+        {
+            //  adjacent records are decoded together
+            size_t begin = ranges[i].offset;
+            size_t end = begin + ranges[i].length;
+            decoder.setContext( ranges[i].context );
+            for ( i++; i < ranges.size( ) && ranges[i].offset == end; i++ )
+                { end += ranges[i].length; }
+
+            DataBuffer buffer{ text.substr( begin, end - begin ) };
+            decodeRecords( decoder, buffer );
+        }
+        return object;
+    }
+
+
+    Object BitIndex::lookup( File & file, Memory key ) const
+    {
+        Object object;
+        Decoder decoder{ subtreeHandler( object, key ) };
+        std::string buffer;
+
+        auto ranges = find( key );
+        for ( size_t i = 0; i < ranges.size( ); )
+        {
+            size_t begin = ranges[i].offset;
+            size_t end = begin + ranges[i].length;
+            decoder.setContext( ranges[i].context );
+            for ( i++; i < ranges.size( ) && ranges[i].offset == end; i++ )
+                { end += ranges[i].length; }
+
+            DataBuffer data{ readRange( file, begin, end - begin, buffer ) };
+            decodeRecords( decoder, data );
+        }
+        return object;
+    }
+}
+
+#else
+
+#include "../../cpp/meta/Test.h"
+#include "../../cpp/util/BitIndex.h"
+
+using namespace cpp;
+
+TEST_CASE( "BitIndex" )
+{
+	Memory text =
+		"server : ip='10.5.5.102' port='10667'\n"
+		"client : name='a'\n"
+		"region[east]:\n"
+		"\tserver:\n"
+		"\t\tip='10.0.0.1'\n"
+		"\tcount='3'\n"
+		"// comment\n"
+		"server.port='10668'\n"
+		"region : null\n"
+		"region[west]:\n"
+		"\tserver.ip='10.0.0.2'\n";
+
+	bit::BitIndex index;
+	index.append( 0, text );
+	CHECK( index.length( ) == text.length( ) );
+
+	CHECK( index.find( "server" ).size( ) == 2 );
+	CHECK( index.find( "client.name" ).size( ) == 1 );
+	CHECK( index.lookup( text, "server" ).encode( ) == bit::decode( "server : ip='10.5.5.102' port='10668'\n" ).encode( ) );
+
+	//	indented records are decoded with their saved context, and erasing a parent is included
+	auto region = index.lookup( text, "region[east].server" );
+	CHECK( region["region"].isNulled( ) );
+	CHECK( region["region[east].server.ip"] == "10.0.0.1" );
+	CHECK( index.lookup( text, "region[east].count" )["region[east].count"] == "3" );
+
+	//	adjacent records are decoded together, every one of them
+	auto east = index.lookup( text, "region[east]" );
+	CHECK( east["region[east].server.ip"] == "10.0.0.1" );
+	CHECK( east["region[east].count"] == "3" );
+	CHECK( index.lookup( text, "region" ).encode( ) == bit::decode( "region[east].server.ip='10.0.0.1'\nregion[east].count='3'\nregion : null\nregion[west].server.ip='10.0.0.2'\n" ).encode( ) );
+
+	//	the sidecar is extended on append and reloaded with the same ranges
+	FilePath filename = "test.bit";
+	FilePath indexFilename = bit::BitIndex::sidecar( filename );
+	Files::remove( indexFilename );
+
+	auto file = File::create( filename );
+	file.write( text );
+	file.close( );
+
+	{
+		auto fileIndex = bit::BitIndex::open( indexFilename );
+		auto data = File::readFrom( filename );
+		fileIndex.update( data );
+		CHECK( fileIndex.size( ) == index.size( ) );
+	}
+
+	file = File::append( filename );
+	file.write( "\tcount='4'\n" );		// continues region[west]
+	file.close( );
+
+	auto reopened = bit::BitIndex::open( indexFilename );
+	CHECK( reopened.size( ) == index.size( ) );
+
+	auto data = File::readFrom( filename );
+	reopened.update( data );
+	CHECK( reopened.size( ) == index.size( ) + 1 );
+	CHECK( reopened.lookup( data, "region[west]" )["region[west].server.ip"] == "10.0.0.2" );
+	CHECK( reopened.lookup( data, "region[west]" )["region[west].count"] == "4" );
+	CHECK( reopened.lookup( data, "region[west].count" )["region[west].count"] == "4" );
+	CHECK( reopened.lookup( data, "server.port" )["server.port"] == "10668" );
+
+	data.close( );
+	Files::remove( filename );
+	Files::remove( indexFilename );
+}
+
+#endif
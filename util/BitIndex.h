@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+
+BitIndex is a sidecar offset index which allows part of a Bit file to be read without replaying the whole
+file.  The byte range of each record is listed under the key prefixes (up to prefixDepth segments) of
+the keys it touches.  Indented records also keep the key context of the lines above them, so decoding
+can begin at the record itself.
+
+The index is saved next to the data file as Bit records and is extended as records are appended.
+
+	auto file = File::readFrom( "data.bit" );
+	auto index = bit::BitIndex::open( bit::BitIndex::sidecar( "data.bit" ) );
+	index.update( file );								// indexes any records appended since the index was saved
+
+	auto server = index.lookup( file, "server" );		// reads only the records which touch server.*
+	Memory ip = server["server.ip"];
+
+*/
+
+#include "../../cpp/file/File.h"
+#include "../../cpp/util/Bit.h"
+
+
+namespace cpp::bit
+{
+    class BitIndex
+    {
+    public:
+        static constexpr size_t             DefaultPrefixDepth = 2;
+
+        struct Range
+        {
+            size_t                          offset;
+            size_t                          length;
+            std::vector<std::string>        context;                // key prefix at each indent, for indented records
+        };
+
+        static FilePath                     sidecar( const FilePath & filename );   // i.e. filename + ".index"
+        static BitIndex                     open(                                   // loads (or creates) a sidecar index
+                                                const FilePath & indexFilename,
+                                                size_t prefixDepth = DefaultPrefixDepth );
+
+                                            BitIndex( size_t prefixDepth = DefaultPrefixDepth );
+
+        size_t                              prefixDepth( ) const;
+        size_t                              length( ) const;                        // end of the last indexed record
+        size_t                              size( ) const;                          // number of indexed records
+
+        void                                clear( );
+        void                                append( size_t offset, Memory records );    // indexes the complete records at offset
+        void                                update( File & file );                      // indexes the records past length( )
+        void                                rebuild( File & file );
+
+        std::vector<Range>                  find( Memory key ) const;               // ranges which may touch key, in file order
+        Object                              lookup( Memory text, Memory key ) const;
+        Object                              lookup( File & file, Memory key ) const;
+
+    private:
+        struct Detail;
+        std::shared_ptr<Detail>             m_detail;
+    };
+}
@@ -0,0 +1,579 @@
+#if __has_include(<openssl/ssl.h>)
+#ifndef TEST
+
+#include <atomic>
+#include <charconv>
+#include <deque>
+#include <vector>
+
+#include "../../cpp/util/BitReplication.h"
+#include "../../cpp/process/Lock.h"
+#include "../../cpp/process/Random.h"
+
+
+namespace cpp::bit
+{
+    uint64_t parseSequence( Memory value )
+    {
+        uint64_t result = 0;
+        std::from_chars( value.begin( ), value.end( ), result );
+        return result;
+    }
+
+
+    //  Reads the message at pos once it was received in full, i.e. a bit record header followed by its payload.
+    bool readMessage( Memory buffer, size_t & pos, ReplicationMessage & message )
+    {
+        size_t end = buffer.find( '\n', pos );
+        if ( end == Memory::npos )
+            { return false; }
+
+        Memory line = buffer.substr( pos, end + 1 - pos );
+        const Object header = bit::decode( line );
+        message.type = line.substr( 0, line.find( ' ' ) );
+        auto field = [&]( const char * name ) { return parseSequence( header[message.type + "." + name].value( ) ); };
+
+        message.epoch = field( "epoch" );
+        message.sequence = field( "sequence" );
+        uint64_t length = field( "length" );
+        if ( buffer.length( ) - ( end + 1 ) < length )
+            { return false; }
+
+        message.payload = buffer.substr( end + 1, length );
+        pos = end + 1 + length;
+        return true;
+    }
+
+
+
+    struct BitPrimary::Detail
+        : public std::enable_shared_from_this<BitPrimary::Detail>
+    {
+        struct Follower
+        {
+            bool                            isFollowing = false;    // sends appends, false until its snapshot is sent
+            uint64_t                        sent = 0;
+            uint64_t                        acknowledged = 0;
+        };
+
+                                            Detail( asio::io_context & io, BitFile & file, size_t backlogLimit );
+
+        void                                open( uint16_t port, const std::string & address );
+        void                                close( );
+
+        void                                onAppend( uint64_t appendSequence, Memory records );     // on the writing thread
+        void                                onRecv( const std::string & addr, std::string & recvBuffer );
+        void                                follow( const std::string & addr, const ReplicationMessage & message );
+        void                                sendSnapshot( const std::string & addr );
+        bool                                sendRecords( const std::string & addr, Follower & follower, bool isForced );
+        void                                sendAppends( );
+        void                                scheduleSend( );
+
+        asio::io_context &                  io;
+        BitFile &                           file;
+        TcpServer                           server;
+        uint64_t                            epoch;
+        size_t                              backlogLimit;
+
+        mutable Mutex                       mutex;                  // guards the backlog and followers, appends arrive on the writing thread
+        std::deque<std::pair<uint64_t, std::string>> backlog;       // the latest appends, by sequence
+        size_t                              backlogLength = 0;
+        uint64_t                            sequence = 0;
+        bool                                isSendPending = false;
+        std::map<std::string, Follower>     followers;
+    };
+
+
+    BitPrimary::Detail::Detail( asio::io_context & context, BitFile & bitFile, size_t limit )
+        : io( context ), file( bitFile ), epoch( Random{ }.rand( ) ), backlogLimit( limit )
+    {
+    }
+
+
+    void BitPrimary::Detail::open( uint16_t port, const std::string & address )
+    {
+        std::weak_ptr<Detail> weak = weak_from_this( );
+        server.open( io, port,
+            []( std::error_code, const std::string & ) { },
+            [weak]( const std::string & addr, std::string & recvBuffer ) { if ( auto self = weak.lock( ) ) { self->onRecv( addr, recvBuffer ); } },
+            [weak]( const std::string & addr, std::error_code )
+            {
+                if ( auto self = weak.lock( ) )
+                    { auto lock = self->mutex.lock( ); self->followers.erase( addr ); }
+            },
+            address );
+
+        file.setAppendHandler( [this]( uint64_t appendSequence, Memory records ) { onAppend( appendSequence, records ); } );
+
+        uint64_t snapshotSequence;
+        file.snapshot( &snapshotSequence );
+
+        auto lock = mutex.lock( );
+        sequence = std::max( sequence, snapshotSequence );
+    }
+
+
+    void BitPrimary::Detail::close( )
+    {
+        file.setAppendHandler( nullptr );
+        server.close( );
+    }
+
+
+    //  Appends are kept until backlogLimit bytes of later ones arrive.  A follower behind them is sent a snapshot.
+    void BitPrimary::Detail::onAppend( uint64_t appendSequence, Memory records )
+    {
+        auto lock = mutex.lock( );
+        backlog.emplace_back( appendSequence, records );
+        backlogLength += records.length( );
+        sequence = appendSequence;
+
+        while ( backlogLength > backlogLimit && backlog.size( ) > 1 )
+        {
+            backlogLength -= backlog.front( ).second.length( );
+            backlog.pop_front( );
+        }
+
+        if ( !followers.empty( ) )
+            { scheduleSend( ); }
+    }
+
+
+    void BitPrimary::Detail::onRecv( const std::string & addr, std::string & recvBuffer )
+    {
+        size_t pos = 0;
+        ReplicationMessage message;
+        while ( readMessage( recvBuffer, pos, message ) )
+        {
+            if ( message.type == "follow" )
+                { follow( addr, message ); }
+            else if ( message.type == "ack" )
+            {
+                auto lock = mutex.lock( );
+                auto found = followers.find( addr );
+                if ( found != followers.end( ) )
+                    { found->second.acknowledged = std::max( found->second.acknowledged, message.sequence ); }
+            }
+            else
+            {
+                server.disconnect( addr );
+                return;
+            }
+        }
+        recvBuffer.erase( 0, pos );
+    }
+
+
+    //  A follower resumes after its sequence if it follows this epoch and the backlog still holds every later
+    //  append.  It is always answered, with an empty records message if it is up to date.
+    void BitPrimary::Detail::follow( const std::string & addr, const ReplicationMessage & message )
+    {
+        {
+            auto lock = mutex.lock( );
+            auto & follower = followers[addr];
+            follower.isFollowing = false;
+
+            uint64_t first = backlog.empty( ) ? sequence + 1 : backlog.front( ).first;
+            if ( message.epoch == epoch && message.sequence <= sequence && message.sequence + 1 >= first )
+            {
+                follower.isFollowing = true;
+                follower.sent = message.sequence;
+                follower.acknowledged = message.sequence;
+                sendRecords( addr, follower, true );
+                return;
+            }
+        }
+
+        sendSnapshot( addr );
+    }
+
+
+    //  Not called with mutex held, since the writing thread holds the BitFile lock while it calls onAppend( ).
+    void BitPrimary::Detail::sendSnapshot( const std::string & addr )
+    {
+        uint64_t snapshotSequence;
+        String payload = file.snapshot( &snapshotSequence ).encodeRaw( );
+        std::string message = format( "snapshot : epoch='%' sequence='%' length='%'\n", epoch, snapshotSequence, payload.length( ) );
+        server.send( addr, message.append( payload.begin( ), payload.end( ) ) );
+
+        auto lock = mutex.lock( );
+        auto found = followers.find( addr );
+        if ( found != followers.end( ) )
+        {
+            found->second.isFollowing = true;
+            found->second.sent = snapshotSequence;
+            scheduleSend( );
+        }
+    }
+
+
+    //  Called with mutex held.  Sends every append after the follower's last, a message each, or returns false
+    //  if some are no longer in the backlog.
+    bool BitPrimary::Detail::sendRecords( const std::string & addr, Follower & follower, bool isForced )
+    {
+        if ( follower.sent >= sequence && !isForced )
+            { return true; }
+
+        uint64_t first = backlog.empty( ) ? sequence + 1 : backlog.front( ).first;
+        if ( follower.sent + 1 < first )
+            { return false; }
+
+        std::string messages;
+        for ( size_t index = follower.sent + 1 - first; index < backlog.size( ); index++ )
+        {
+            const auto & [appendSequence, records] = backlog[index];
+            messages += format( "records : epoch='%' sequence='%' length='%'\n", epoch, appendSequence, records.length( ) );
+            messages += records;
+        }
+        if ( messages.empty( ) )
+            { messages = format( "records : epoch='%' sequence='%' length='0'\n", epoch, sequence ); }      // up to date
+
+        server.send( addr, std::move( messages ) );
+        follower.sent = sequence;
+        return true;
+    }
+
+
+    void BitPrimary::Detail::sendAppends( )
+    {
+        std::vector<std::string> behind;
+        {
+            auto lock = mutex.lock( );
+            isSendPending = false;
+            for ( auto & [addr, follower] : followers )
+            {
+                if ( follower.isFollowing && !sendRecords( addr, follower, false ) )
+                {
+                    follower.isFollowing = false;
+                    behind.push_back( addr );
+                }
+            }
+        }
+
+        for ( const auto & addr : behind )
+            { sendSnapshot( addr ); }
+    }
+
+
+    //  Called with mutex held.  Appends arriving before the io thread gets to them are sent together.
+    void BitPrimary::Detail::scheduleSend( )
+    {
+        if ( isSendPending )
+            { return; }
+
+        isSendPending = true;
+        std::weak_ptr<Detail> weak = weak_from_this( );
+        asio::post( io, [weak]( ) { if ( auto self = weak.lock( ) ) { self->sendAppends( ); } } );
+    }
+
+
+
+    BitPrimary::BitPrimary( asio::io_context & io, BitFile & file, uint16_t port, const std::string & address, size_t backlogLength )
+        : m_detail{ std::make_shared<Detail>( io, file, backlogLength ) }
+    {
+        m_detail->open( port, address );
+    }
+
+
+    BitPrimary::~BitPrimary( )
+    {
+        m_detail->close( );
+    }
+
+
+    uint64_t BitPrimary::epoch( ) const
+    {
+        return m_detail->epoch;
+    }
+
+
+    uint64_t BitPrimary::sequence( ) const
+    {
+        auto lock = m_detail->mutex.lock( );
+        return m_detail->sequence;
+    }
+
+
+    std::map<std::string, uint64_t> BitPrimary::acknowledged( ) const
+    {
+        auto lock = m_detail->mutex.lock( );
+        std::map<std::string, uint64_t> result;
+        for ( const auto & [addr, follower] : m_detail->followers )
+            { result[addr] = follower.acknowledged; }
+        return result;
+    }
+
+
+
+    struct BitFollower::Detail
+        : public std::enable_shared_from_this<BitFollower::Detail>
+    {
+                                            Detail( asio::io_context & io, BitFile & file, std::string address, Duration reconnectDelay );
+
+        void                                connect( );
+        void                                disconnect( );
+        void                                reconnect( );
+        void                                onConnect( std::error_code error );
+        void                                onRecv( std::string & recvBuffer );
+        void                                apply( const ReplicationMessage & message );
+
+        asio::io_context &                  io;
+        BitFile &                           file;
+        std::string                         address;
+        Duration                            reconnectDelay;
+        TcpConnection                       connection;
+        AsyncTimer                          reconnectTimer;
+        uint64_t                            generation = 0;         // of the current connection
+
+        std::atomic<bool>                   isFollowing = false;
+        std::atomic<uint64_t>               epoch = 0;
+        std::atomic<uint64_t>               sequence = 0;           // kept across reconnects, so the follower resumes
+    };
+
+
+    BitFollower::Detail::Detail( asio::io_context & context, BitFile & bitFile, std::string addr, Duration delay )
+        : io( context ), file( bitFile ), address( std::move( addr ) ), reconnectDelay( delay )
+    {
+    }
+
+
+    //  A dropped connection can still call its handlers until its pending reads complete, so they are
+    //  ignored once a newer connection was made.
+    void BitFollower::Detail::connect( )
+    {
+        std::weak_ptr<Detail> weak = weak_from_this( );
+        uint64_t current = ++generation;
+        auto isCurrent = [weak, current]( ) { auto self = weak.lock( ); return self && self->generation == current ? self : nullptr; };
+
+        connection.connect( io, address,
+            [isCurrent]( std::error_code error ) { if ( auto self = isCurrent( ) ) { self->onConnect( error ); } },
+            [isCurrent]( std::string & recvBuffer ) { if ( auto self = isCurrent( ) ) { self->onRecv( recvBuffer ); } },
+            [isCurrent]( std::error_code ) { if ( auto self = isCurrent( ) ) { self->reconnect( ); } } );
+    }
+
+
+    void BitFollower::Detail::disconnect( )
+    {
+        generation++;
+        connection.disconnect( );
+    }
+
+
+    void BitFollower::Detail::reconnect( )
+    {
+        isFollowing = false;
+
+        std::weak_ptr<Detail> weak = weak_from_this( );
+        reconnectTimer = AsyncTimer::waitFor( &io, reconnectDelay, [weak]( ) { if ( auto self = weak.lock( ) ) { self->connect( ); } } );
+    }
+
+
+    void BitFollower::Detail::onConnect( std::error_code error )
+    {
+        if ( error )
+        {
+            reconnect( );
+            return;
+        }
+
+        connection.send( format( "follow : epoch='%' sequence='%'\n", epoch.load( ), sequence.load( ) ) );
+    }
+
+
+    //  Applies every message received in full, then acknowledges them at once.
+    void BitFollower::Detail::onRecv( std::string & recvBuffer )
+    {
+        size_t pos = 0;
+        try
+        {
+            ReplicationMessage message;
+            while ( readMessage( recvBuffer, pos, message ) )
+                { apply( message ); }
+        }
+        catch ( std::exception & )
+        {
+            recvBuffer.clear( );
+            disconnect( );
+            reconnect( );                       // resumes after the last append applied
+            return;
+        }
+
+        recvBuffer.erase( 0, pos );
+        if ( pos > 0 )
+            { connection.send( format( "ack : sequence='%'\n", sequence.load( ) ) ); }
+    }
+
+
+    void BitFollower::Detail::apply( const ReplicationMessage & message )
+    {
+        if ( message.type == "snapshot" )
+        {
+            file.assign( bit::decode( message.payload ) );
+            epoch = message.epoch;
+            sequence = message.sequence;
+            isFollowing = true;
+            return;
+        }
+
+        check<IOException>( message.type == "records", "BitFollower : unexpected message from the primary" );
+        check<IOException>( message.epoch == epoch && message.sequence <= sequence + 1, "BitFollower : missing appends" );
+
+        //  an append already applied is skipped, since replaying it could reorder arrays
+        if ( message.sequence > sequence )
+        {
+            file.append( message.payload );
+            sequence = message.sequence;
+        }
+        isFollowing = true;
+    }
+
+
+
+    BitFollower::BitFollower( asio::io_context & io, BitFile & file, std::string address, Duration reconnectDelay )
+        : m_detail{ std::make_shared<Detail>( io, file, std::move( address ), reconnectDelay ) }
+    {
+        m_detail->connect( );
+    }
+
+
+    BitFollower::~BitFollower( )
+    {
+        m_detail->disconnect( );
+        m_detail->reconnectTimer.cancel( );
+    }
+
+
+    bool BitFollower::isFollowing( ) const
+    {
+        return m_detail->isFollowing;
+    }
+
+
+    uint64_t BitFollower::epoch( ) const
+    {
+        return m_detail->epoch;
+    }
+
+
+    uint64_t BitFollower::sequence( ) const
+    {
+        return m_detail->sequence;
+    }
+}
+
+#else
+
+#include "../../cpp/meta/Test.h"
+#include "../../cpp/file/Files.h"
+#include "../../cpp/network/TcpConnection.h"
+#include "../../cpp/process/AsyncIO.h"
+#include "../../cpp/util/BitReplication.h"
+
+using namespace cpp;
+
+TEST_CASE( "BitReplication" )
+{
+	//	a message is read once its payload arrived in full
+	std::string text = "records : epoch='7' sequence='3' length='20'\nserver.port='10667'\nack : sequence='3'\n";
+	bit::ReplicationMessage message;
+	size_t pos = 0;
+	CHECK_FALSE( bit::readMessage( Memory{ text }.substr( 0, 60 ), pos, message ) );
+	CHECK( pos == 0 );
+	REQUIRE( bit::readMessage( text, pos, message ) );
+	CHECK( message.type == "records" );
+	CHECK( message.epoch == 7 );
+	CHECK( message.sequence == 3 );
+	CHECK( message.payload == "server.port='10667'\n" );
+	REQUIRE( bit::readMessage( text, pos, message ) );
+	CHECK( message.type == "ack" );
+	CHECK( message.payload.isEmpty( ) );
+	CHECK( pos == text.length( ) );
+	CHECK_FALSE( bit::readMessage( text, pos, message ) );
+
+	//	a primary and its followers on localhost, on this thread
+	AsyncIO io;
+	auto runUntil = [&io]( auto isDone )
+	{
+		Time timeout = Time::now( ) + Duration::ofSeconds( 5 );
+		while ( !isDone( ) && Time::now( ) < timeout )
+			{ io.runOne( Duration::ofMillis( 10 ) ); }
+		return isDone( );
+	};
+
+	Files::remove( "replication.bit" );
+	Files::remove( "replication-copy.bit" );
+	bit::BitFile data{ "replication.bit" };
+	data.set( "server.ip", "10.5.5.102" );
+	bit::BitPrimary primary{ io.context( ), data, 7301, "localhost", 64 };
+	CHECK( primary.sequence( ) == 1 );
+
+	{
+		//	a new follower is sent a snapshot, then each append as it is written
+		bit::BitFile copy{ "replication-copy.bit" };
+		bit::BitFollower follower{ io.context( ), copy, "localhost:7301" };
+		REQUIRE( runUntil( [&]( ) { return follower.isFollowing( ); } ) );
+		CHECK( follower.epoch( ) == primary.epoch( ) );
+		CHECK( copy.data( )["server.ip"] == "10.5.5.102" );
+
+		data.set( "server.port", "10667" );
+		data.append( "region[west].count='1'\nregion[east].count='2'\n" );
+		data.remove( "server.ip" );
+		data.append( "client.name='a'\n" );
+		REQUIRE( runUntil( [&]( ) { return follower.sequence( ) == primary.sequence( ); } ) );
+		CHECK( copy.data( ).encode( ) == data.data( ).encode( ) );
+		CHECK( copy.data( )["region"].asArray( ).atIndex( 1 ).key( ).path == "region[east]" );
+		CHECK( runUntil( [&]( ) { auto acknowledged = primary.acknowledged( ); return acknowledged.size( ) == 1 && acknowledged.begin( )->second == primary.sequence( ); } ) );
+	}
+
+	//	a raw connection stands in for a follower, to see what each follow request is answered with
+	struct Peer { TcpConnection connection; std::string received; };
+	auto follow = [&]( uint64_t epoch, uint64_t sequence )
+	{
+		auto peer = std::make_shared<Peer>( );
+		std::weak_ptr<Peer> weak = peer;
+		peer->connection.connect( io.context( ), "localhost:7301",
+			[weak, epoch, sequence]( std::error_code error )
+			{
+				if ( auto self = weak.lock( ); self && !error )
+					{ self->connection.send( format( "follow : epoch='%' sequence='%'\n", epoch, sequence ) ); }
+			},
+			[weak]( std::string & recvBuffer ) { if ( auto self = weak.lock( ) ) { self->received += recvBuffer; } recvBuffer.clear( ); },
+			[]( std::error_code ) { } );
+
+		bit::ReplicationMessage first;
+		runUntil( [&]( ) { size_t start = 0; return bit::readMessage( peer->received, start, first ); } );
+		peer->connection.disconnect( );
+		return peer->received;
+	};
+	auto firstOf = []( const std::string & received )
+	{
+		bit::ReplicationMessage first;
+		size_t start = 0;
+		REQUIRE( bit::readMessage( received, start, first ) );
+		return first;
+	};
+
+	//	a follower of this epoch resumes after its sequence, and one up to date is sent an empty message
+	uint64_t last = primary.sequence( );
+	std::string resumed = follow( primary.epoch( ), last - 1 );
+	CHECK( firstOf( resumed ).type == "records" );
+	CHECK( firstOf( resumed ).sequence == last );
+	CHECK( firstOf( resumed ).payload == "client.name='a'\n" );
+
+	std::string current = follow( primary.epoch( ), last );
+	CHECK( firstOf( current ).type == "records" );
+	CHECK( firstOf( current ).sequence == last );
+	CHECK( firstOf( current ).payload.isEmpty( ) );
+
+	//	a follower behind the backlog, or of another epoch, is sent a snapshot instead
+	for ( int item = 0; item < 10; item++ )
+		{ data.set( format( "item[%]", item ), "0123456789" ); }
+	std::string behind = follow( primary.epoch( ), last );
+	CHECK( firstOf( behind ).type == "snapshot" );
+	CHECK( firstOf( behind ).sequence == primary.sequence( ) );
+	CHECK( bit::decode( firstOf( behind ).payload ).encode( ) == data.data( ).encode( ) );
+	CHECK( firstOf( follow( 0, 0 ) ).type == "snapshot" );
+}
+
+#endif
+#endif
@@ -0,0 +1,100 @@
+#pragma once
+
+/*
+
+Log-shipping replication of a BitFile.  The primary streams each append to its followers as it is written,
+and a follower applies them to its own BitFile:
+
+    follower > primary      follow : epoch='..' sequence='..'       resume after this sequence
+    primary > follower      snapshot : epoch='..' sequence='..' length='..'     then the encoded data
+    primary > follower      records : epoch='..' sequence='..' length='..'      then that append
+    follower > primary      ack : sequence='..'
+
+Sequences are those of BitFile's appends, and the epoch identifies the primary's run of them.  A follower
+which is new, follows another epoch, or is behind the appends the primary keeps in memory is sent a
+snapshot first.  Otherwise it resumes after the last sequence it applied, e.g. after a reconnect.  Each
+append is a message of its own, so a follower skips any it already applied rather than replaying it out
+of order, and an up to date follower is sent an empty one.  The follower acknowledges once per received
+batch of messages rather than per append.
+
+    bit::BitFile data{ "primary.bit" };
+    bit::BitPrimary primary{ io, data, 7000 };
+
+    bit::BitFile copy{ "copy.bit" };
+    bit::BitFollower follower{ io, copy, "localhost:7000" };
+
+*/
+
+#if __has_include(<openssl/ssl.h>)
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "../../cpp/network/TcpServer.h"
+#include "../../cpp/network/TcpConnection.h"
+#include "BitFile.h"
+
+
+namespace cpp::bit
+{
+    struct ReplicationMessage
+    {
+        std::string                         type;                   // follow, snapshot, records or ack
+        uint64_t                            epoch = 0;
+        uint64_t                            sequence = 0;
+        Memory                              payload;                // into the buffer read from
+    };
+
+    bool                                    readMessage(            // false until the message at pos was received in full
+                                                Memory buffer,
+                                                size_t & pos,
+                                                ReplicationMessage & message );
+
+
+
+    class BitPrimary
+    {
+    public:
+        static constexpr size_t             DefaultBacklog = 16 * 1024 * 1024;
+
+                                            BitPrimary(
+                                                asio::io_context & io,
+                                                BitFile & file,
+                                                uint16_t port,
+                                                const std::string & address = "localhost",
+                                                size_t backlogLength = DefaultBacklog );   // bytes of appends kept for resuming followers
+                                            ~BitPrimary( );
+
+        uint64_t                            epoch( ) const;
+        uint64_t                            sequence( ) const;                  // of the last append
+        std::map<std::string, uint64_t>     acknowledged( ) const;              // last sequence acknowledged by each follower
+
+    private:
+        struct Detail;
+        std::shared_ptr<Detail>             m_detail;
+    };
+
+
+
+    class BitFollower
+    {
+    public:
+                                            BitFollower(
+                                                asio::io_context & io,
+                                                BitFile & file,
+                                                std::string address,
+                                                Duration reconnectDelay = Duration::ofMillis( 500 ) );
+                                            ~BitFollower( );
+
+        bool                                isFollowing( ) const;               // connected and up to date with the snapshot
+        uint64_t                            epoch( ) const;
+        uint64_t                            sequence( ) const;                  // of the last append applied
+
+    private:
+        struct Detail;
+        std::shared_ptr<Detail>             m_detail;
+    };
+}
+
+#endif
@@ -0,0 +1,360 @@
+#ifndef TEST
+
+#include <string_view>
+
+#include "../../cpp/util/BitSelector.h"
+
+
+namespace cpp::bit
+{
+    //  End of the key segment at pos, i.e. the next '.' outside of brackets.
+    size_t segmentEnd( Memory key, size_t pos )
+    {
+        bool isBracketed = false;
+        for ( ; pos < key.length( ); pos++ )
+        {
+            char ch = key[pos];
+            if ( ch == '[' )
+                { isBracketed = true; }
+            else if ( ch == ']' )
+                { isBracketed = false; }
+            else if ( ch == '.' && !isBracketed )
+                { break; }
+        }
+        return pos;
+    }
+
+
+    std::string_view toView( Memory memory )
+    {
+        return std::string_view{ memory.begin( ), memory.length( ) };
+    }
+
+
+
+    BitSelector::BitSelector( Memory pattern )
+        : m_pattern( pattern )
+    {
+        for ( size_t pos = 0; ; pos++ )
+        {
+            size_t end = segmentEnd( pattern, pos );
+            Memory segment = pattern.substr( pos, end - pos );
+            check<std::invalid_argument>( segment.notEmpty( ), "BitSelector( ) : empty segment in pattern" );
+
+            Step step;
+            if ( segment == "**" )
+                { step.segment = Segment::AnyDepth; }
+            else if ( segment == "*" )
+                { step.segment = Segment::Any; }
+            else
+            {
+                size_t open = segment.find( '[' );
+                step.name = segment.substr( 0, open );
+                if ( open != Memory::npos )
+                {
+                    check<std::invalid_argument>( segment[segment.length( ) - 1] == ']', "BitSelector( ) : expected ']' in pattern" );
+                    Memory item = segment.substr( open + 1, segment.length( ) - open - 2 );
+                    size_t dots = item.find( ".." );
+                    if ( item == "*" )
+                        { step.item = Item::Any; }
+                    else if ( dots != Memory::npos )
+                    {
+                        step.item = Item::Range;
+                        step.first = item.substr( 0, dots );
+                        step.last = item.substr( dots + 2 );
+                    }
+                    else
+                    {
+                        step.item = Item::Exact;
+                        step.first = item;
+                    }
+                }
+            }
+            m_steps.push_back( std::move( step ) );
+
+            if ( end >= pattern.length( ) )
+                { break; }
+            pos = end;
+        }
+        check<std::invalid_argument>( m_steps.size( ) <= MaxSegments, "BitSelector( ) : too many segments in pattern" );
+
+        //  the literal segments the pattern begins with, up to the first wildcard
+        for ( const auto & step : m_steps )
+        {
+            if ( step.segment != Segment::Name || step.name == "*" )
+                { break; }
+
+            m_prefix += step.name;
+            if ( step.item == Item::None )
+                { m_prefix += '.'; continue; }
+
+            m_prefix += '[';
+            if ( step.item != Item::Exact )
+                { break; }
+            m_prefix += step.first;
+            m_prefix += "].";
+        }
+        if ( !m_prefix.empty( ) && m_prefix.back( ) == '.' )
+            { m_prefix.pop_back( ); }
+    }
+
+
+    const std::string & BitSelector::pattern( ) const
+    {
+        return m_pattern;
+    }
+
+
+    const std::string & BitSelector::prefix( ) const
+    {
+        return m_prefix;
+    }
+
+
+    bool BitSelector::matches( Memory key ) const
+    {
+        size_t deadEnd;
+        return match( key, deadEnd );
+    }
+
+
+    bool BitSelector::matchesBelow( Memory key ) const
+    {
+        size_t deadEnd;
+        return match( key, deadEnd ) || deadEnd == Memory::npos;
+    }
+
+
+    BitSelector::Selection BitSelector::select( const Object & object ) const
+    {
+        return Selection{ *this, object };
+    }
+
+
+    const BitSelector::keymap_t & BitSelector::keys( const Object & object )
+    {
+        return object.data( ).keys;
+    }
+
+
+    bool BitSelector::matches( const Step & step, Memory segment ) const
+    {
+        if ( step.segment != Segment::Name )
+            { return true; }
+
+        size_t open = segment.find( '[' );
+        if ( step.name != "*" && toView( segment.substr( 0, open ) ) != step.name )
+            { return false; }
+        if ( open == Memory::npos || step.item == Item::None )
+            { return open == Memory::npos && step.item == Item::None; }
+
+        auto item = toView( segment.substr( open + 1, segment.length( ) - open - 2 ) );
+        switch ( step.item )
+        {
+        case Item::Exact:
+            return item == step.first;
+        case Item::Range:
+            return item >= step.first && item <= step.last;
+        default:
+            return true;
+        }
+    }
+
+
+    //  Each state is a step of the pattern, with one past the last step for a match.  A ** step can
+    //  match no segment, so it also adds the state after it.
+    uint64_t BitSelector::closure( uint64_t states ) const
+    {
+        for ( size_t index = 0; index < m_steps.size( ); index++ )
+        {
+            if ( ( states >> index & 1 ) && m_steps[index].segment == Segment::AnyDepth )
+                { states |= uint64_t{ 1 } << ( index + 1 ); }
+        }
+        return states;
+    }
+
+
+    uint64_t BitSelector::advance( uint64_t states, Memory segment ) const
+    {
+        uint64_t next = 0;
+        for ( size_t index = 0; index < m_steps.size( ); index++ )
+        {
+            if ( !( states >> index & 1 ) )
+                { continue; }
+            if ( m_steps[index].segment == Segment::AnyDepth )
+                { next |= uint64_t{ 1 } << index; }
+            else if ( matches( m_steps[index], segment ) )
+                { next |= uint64_t{ 1 } << ( index + 1 ); }
+        }
+        return closure( next );
+    }
+
+
+    //  Once no state is left, no key which begins with the segments so far can match either.
+    bool BitSelector::match( Memory key, size_t & deadEnd ) const
+    {
+        deadEnd = Memory::npos;
+        uint64_t states = closure( 1 );
+        for ( size_t pos = 0; ; pos++ )
+        {
+            size_t end = segmentEnd( key, pos );
+            states = advance( states, key.substr( pos, end - pos ) );
+            if ( !states )
+            {
+                deadEnd = end;
+                return false;
+            }
+
+            if ( end >= key.length( ) )
+                { break; }
+            pos = end;
+        }
+        return states >> m_steps.size( ) & 1;
+    }
+
+
+
+    BitSelector::Selection::Selection( const BitSelector & selector, const Object & object )
+        : m_selector( selector ), m_object( object )
+    {
+        const std::string & path = object.key( ).path;
+        if ( !path.empty( ) )
+            { m_base = path + "."; }
+        m_start = m_base + selector.m_prefix;
+    }
+
+
+    BitSelector::iterator BitSelector::Selection::begin( ) const
+    {
+        return iterator{ this, keys( m_object ).lower_bound( m_start ) };
+    }
+
+
+    BitSelector::iterator BitSelector::Selection::end( ) const
+    {
+        return iterator{ this, keys( m_object ).end( ) };
+    }
+
+
+    std::vector<std::string> BitSelector::Selection::getKeys( ) const
+    {
+        std::vector<std::string> result;
+        for ( auto match : *this )
+            { result.emplace_back( match.key ); }
+        return result;
+    }
+
+
+
+    BitSelector::iterator::iterator( const Selection * selection, key_iterator itr )
+        : m_selection( selection ), m_itr( itr )
+    {
+        seek( );
+    }
+
+
+    BitSelector::Match BitSelector::iterator::operator*( ) const
+    {
+        return Match{ Memory{ m_itr->first }.substr( m_selection->m_base.length( ) ), m_itr->second };
+    }
+
+
+    bool BitSelector::iterator::operator!=( const iterator & other ) const
+    {
+        return m_itr != other.m_itr;
+    }
+
+
+    BitSelector::iterator & BitSelector::iterator::operator++( )
+    {
+        ++m_itr;
+        seek( );
+        return *this;
+    }
+
+
+    void BitSelector::iterator::seek( )
+    {
+        const auto & keys = BitSelector::keys( m_selection->m_object );
+        const std::string & start = m_selection->m_start;
+        size_t baseLength = m_selection->m_base.length( );
+
+        while ( m_itr != keys.end( ) )
+        {
+            const std::string & key = m_itr->first;
+            if ( key.compare( 0, start.length( ), start ) != 0 )
+            {
+                m_itr = keys.end( );
+                return;
+            }
+
+            size_t deadEnd;
+            if ( m_itr->second != NullValue && m_selection->m_selector.match( Memory{ key }.substr( baseLength ), deadEnd ) )
+                { return; }
+            if ( m_itr->second == NullValue || deadEnd == Memory::npos )
+            {
+                ++m_itr;
+                continue;
+            }
+
+            //  skip the subtree below the segment where matching failed, i.e. its keys up to key + "/"
+            m_skip.assign( key, 0, baseLength + deadEnd );
+            m_skip += '/';
+            m_itr = keys.lower_bound( m_skip );
+        }
+    }
+}
+
+#else
+
+#include "../../cpp/meta/Test.h"
+#include "../../cpp/util/BitSelector.h"
+
+using namespace cpp;
+
+TEST_CASE( "BitSelector" )
+{
+	bit::Object object = bit::decode(
+		"region[east].server : ip='10.0.0.1' port='80'\n"
+		"region[west].server : ip='10.0.0.2' port='81'\n"
+		"region[west].name='w'\n"
+		"port='1'\n"
+		"client.port='2'\n"
+		"array[a]='1'\n"
+		"array[c]='3'\n"
+		"array[g]='7'\n" );
+
+	auto keys = [&object]( Memory pattern )
+	{
+		std::string result;
+		for ( const auto & key : bit::BitSelector{ pattern }.select( object ).getKeys( ) )
+			{ result += result.empty( ) ? key : " " + key; }
+		return result;
+	};
+
+	CHECK( keys( "region[*].server.*" ) == "region[east].server.ip region[east].server.port region[west].server.ip region[west].server.port" );
+	CHECK( keys( "**.port" ) == "client.port port region[east].server.port region[west].server.port" );
+	CHECK( keys( "array[a..f]" ) == "array[a] array[c]" );
+	CHECK( keys( "region[west].server.ip" ) == "region[west].server.ip" );
+	CHECK( keys( "region.*" ) == "" );
+
+	//	segments are matched whole, and ** also matches no segment
+	bit::BitSelector items{ "server[*]" };
+	CHECK( items.matches( "server[a]" ) );
+	CHECK( !items.matches( "server" ) );
+	CHECK( !items.matches( "server[a].ip" ) );
+	CHECK( bit::BitSelector{ "a.**.b" }.matches( "a.b" ) );
+	CHECK( bit::BitSelector{ "a.**.b" }.matches( "a.x[1.2].y.b" ) );
+	CHECK( !bit::BitSelector{ "a.**.b" }.matches( "a.x.c" ) );
+
+	//	keys are relative to the selected view, and the selection keeps a copy of a temporary selector
+	std::string values;
+	for ( auto [key, value] : bit::BitSelector{ "*" }.select( object["region[west]"] ) )
+		{ values += key + "=" + value; }
+	CHECK( values == "name=w" );
+
+	CHECK_THROWS( bit::BitSelector{ "a..b" } );
+	CHECK_THROWS( bit::BitSelector{ "a[b" } );
+}
+
+#endif
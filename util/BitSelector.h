@@ -0,0 +1,133 @@
+#pragma once
+
+/*
+
+BitSelector selects the values of an Object whose keys match a path pattern.  Patterns are matched a key
+segment at a time, segments being delimited by '.' outside of brackets:
+
+	region[*].server.*		any item of region, then any child of its server
+	**.port					port at any depth, including the root
+	array[a..f]				items of array with IDs from a to f (inclusive, compared as bytes)
+	server[*]				segments are matched whole, so server[*] only matches array items
+
+The pattern is compiled once into a small automaton over the segments.  Selecting walks the Object's sorted
+keys from the pattern's literal prefix, and once no match is possible below a segment, skips the whole
+subtree under it.  Iterating does not allocate per match.
+
+	bit::BitSelector ports{ "region[*].server.port" };
+	for ( auto [key, value] : ports.select( object ) )
+		{ ... }
+
+*/
+
+#include "../../cpp/util/Bit.h"
+
+
+namespace cpp::bit
+{
+    size_t                                  segmentEnd( Memory key, size_t pos );  // the next '.' outside of brackets from pos, or the length
+
+
+
+    class BitSelector
+    {
+    public:
+        static constexpr size_t             MaxSegments = 63;
+
+        struct Match
+        {
+            Memory                          key;                    // relative to the selected Object's key
+            Memory                          value;
+        };
+
+        class Selection;
+        class iterator;
+
+                                            BitSelector( Memory pattern );
+
+        const std::string &                 pattern( ) const;
+        const std::string &                 prefix( ) const;        // literal start of every matching key, e.g. "region[" of region[*].ip
+        bool                                matches( Memory key ) const;
+        bool                                matchesBelow( Memory key ) const;   // key or some key below it could match
+        Selection                           select( const Object & object ) const;    // holds a copy of the selector, so it may be a temporary
+
+    private:
+        typedef std::map<std::string, std::string> keymap_t;          // i.e. Object's key storage
+        typedef keymap_t::const_iterator    key_iterator;
+
+        static const keymap_t &             keys( const Object & object );
+
+        enum class Segment
+        {
+            Name,                                                   // name, or name[...] with item set
+            Any,                                                    // *
+            AnyDepth                                                // **, zero or more segments
+        };
+
+        enum class Item
+        {
+            None, Exact, Any, Range
+        };
+
+        struct Step
+        {
+            Segment                         segment = Segment::Name;
+            std::string                     name;                   // "*" matches any name
+            Item                            item = Item::None;
+            std::string                     first;                  // Exact and Range
+            std::string                     last;                   // Range
+        };
+
+        bool                                matches( const Step & step, Memory segment ) const;
+        uint64_t                            closure( uint64_t states ) const;
+        uint64_t                            advance( uint64_t states, Memory segment ) const;
+        bool                                match( Memory key, size_t & deadEnd ) const;   // deadEnd is set past the segment where matching failed
+
+        friend class iterator;
+
+        std::string                         m_pattern;
+        std::vector<Step>                   m_steps;
+        std::string                         m_prefix;               // literal start of every matching key
+    };
+
+
+
+    class BitSelector::iterator
+    {
+    public:
+        Match                               operator*( ) const;
+        bool                                operator!=( const iterator & other ) const;
+        iterator &                          operator++( );
+
+    private:
+        friend class Selection;
+                                            iterator( const Selection * selection, key_iterator itr );
+
+        void                                seek( );                // to the next match, from m_itr
+
+        const Selection *                   m_selection;
+        key_iterator                        m_itr;
+        std::string                         m_skip;                 // reused to seek past subtrees
+    };
+
+
+
+    class BitSelector::Selection
+    {
+    public:
+        iterator                            begin( ) const;
+        iterator                            end( ) const;
+
+        std::vector<std::string>            getKeys( ) const;
+
+    private:
+        friend class BitSelector;
+        friend class iterator;
+                                            Selection( const BitSelector & selector, const Object & object );
+
+        BitSelector                         m_selector;
+        Object                              m_object;
+        std::string                         m_base;                 // the Object's key + ".", or empty at the root
+        std::string                         m_start;                // m_base + the pattern's prefix
+    };
+}
@@ -0,0 +1,302 @@
+#ifndef TEST
+
+#include <algorithm>
+#include <string_view>
+
+#include "../../cpp/util/BitSharded.h"
+#include "../../cpp/util/BitSelector.h"
+#include "../../cpp/process/Lock.h"
+
+
+namespace cpp::bit
+{
+    struct ShardedObject::Detail
+    {
+        struct Shard
+        {
+            Mutex                           mutex;
+            Object                          object;
+        };
+
+        Memory                              prefix( Memory key, bool & isAbove ) const;
+        size_t                              shardOf( Memory key ) const;
+        std::vector<Lock>                   lockAll( ) const;
+
+        mutable std::vector<Shard>          shards;
+        size_t                              depth;
+    };
+
+
+    //  The first depth segments of key, cut before any array item.  isAbove is set when key has fewer
+    //  segments, so the keys below it may be in any shard.
+    Memory ShardedObject::Detail::prefix( Memory key, bool & isAbove ) const
+    {
+        isAbove = false;
+        size_t end = 0;
+        for ( size_t count = 0, pos = 0; count < depth; count++, pos = end + 1 )
+        {
+            if ( key.isEmpty( ) || pos > key.length( ) )
+            {
+                isAbove = true;
+                return key;
+            }
+
+            end = segmentEnd( key, pos );
+            size_t item = key.substr( pos, end - pos ).find( '[' );
+            if ( item != Memory::npos )
+                { return key.substr( 0, pos + item ); }
+        }
+        return key.substr( 0, end );
+    }
+
+
+    size_t ShardedObject::Detail::shardOf( Memory key ) const
+    {
+        bool isAbove;
+        Memory path = prefix( key, isAbove );
+        return std::hash<std::string_view>{ }( std::string_view{ path.begin( ), path.length( ) } ) % shards.size( );
+    }
+
+
+    //  Always in shard order, so writers locking several shards cannot deadlock.
+    std::vector<Lock> ShardedObject::Detail::lockAll( ) const
+    {
+        std::vector<Lock> locks;
+        locks.reserve( shards.size( ) );
+        for ( auto & shard : shards )
+            { locks.push_back( shard.mutex.lock( ) ); }
+        return locks;
+    }
+
+
+
+    ShardedObject::ShardedObject( size_t shardCount, size_t depth )
+        : m_detail{ std::make_shared<Detail>( ) }
+    {
+        check<std::invalid_argument>( shardCount > 0 && depth > 0, "ShardedObject( ) : shardCount and depth must be at least 1" );
+        m_detail->shards = std::vector<Detail::Shard>( shardCount );
+        m_detail->depth = depth;
+    }
+
+
+    void ShardedObject::assign( Memory key, Memory value )
+    {
+        auto & shard = m_detail->shards[m_detail->shardOf( key )];
+        auto lock = shard.mutex.lock( );
+        shard.object.at( key ).assign( value );
+    }
+
+
+    void ShardedObject::erase( Memory key )
+    {
+        bool isAbove;
+        m_detail->prefix( key, isAbove );
+        size_t home = m_detail->shardOf( key );
+        if ( !isAbove )
+        {
+            auto & shard = m_detail->shards[home];
+            auto lock = shard.mutex.lock( );
+            shard.object.at( key ).erase( );
+            return;
+        }
+
+        auto locks = m_detail->lockAll( );
+        for ( size_t index = 0; index < m_detail->shards.size( ); index++ )
+        {
+            auto view = m_detail->shards[index].object.at( key );
+            if ( index == home && key.notEmpty( ) )
+                { view.erase( ); }
+            else
+                { view.clear( ); }
+        }
+    }
+
+
+    //  Splits object's keys into one Object per shard, then appends each to its shard with every shard
+    //  involved locked, so a snapshot sees all of object or none of it.
+    void ShardedObject::append( const Object & object )
+    {
+        const auto & from = object.data( );
+        const std::string & path = object.key( ).path;
+        size_t pathLen = path.empty( ) ? 0 : path.length( ) + 1;
+
+        std::vector<Object> parts( m_detail->shards.size( ) );
+        std::vector<bool> isPart( parts.size( ), false );
+        std::vector<std::string> cleared;
+        auto add = [&]( const std::string & fullKey, const std::string & value )
+        {
+            Memory key = ( fullKey.length( ) > pathLen ) ? Memory{ fullKey }.substr( pathLen ) : Memory::Empty;
+            size_t index = m_detail->shardOf( key );
+            isPart[index] = true;
+            if ( from.nulled.count( fullKey ) )
+            {
+                bool isAbove;
+                m_detail->prefix( key, isAbove );
+                if ( isAbove )
+                    { cleared.push_back( key.toString( ) ); }
+                parts[index].at( key ).erase( );
+            }
+            if ( value != NullValue )
+                { parts[index].at( key ).assign( value ); }
+        };
+
+        auto itr = from.keys.begin( );
+        auto last = from.keys.end( );
+        if ( !path.empty( ) )
+        {
+            itr = from.keys.find( path );
+            if ( itr != last )
+                { add( itr->first, itr->second ); }
+            itr = from.keys.lower_bound( path + "." );
+            last = from.keys.lower_bound( path + "/" );       // '/' follows '.'
+        }
+        for ( ; itr != last; itr++ )
+            { add( itr->first, itr->second ); }
+
+        std::vector<Lock> locks;
+        for ( size_t index = 0; index < parts.size( ); index++ )
+        {
+            if ( isPart[index] || !cleared.empty( ) )
+                { locks.push_back( m_detail->shards[index].mutex.lock( ) ); }
+        }
+
+        for ( size_t index = 0; index < parts.size( ); index++ )
+        {
+            auto & shard = m_detail->shards[index].object;
+            for ( const auto & key : cleared )
+            {
+                if ( index != m_detail->shardOf( key ) )
+                    { shard.at( key ).clear( ); }
+            }
+            if ( isPart[index] )
+                { shard.append( parts[index] ); }
+        }
+    }
+
+
+    //  A key is only ever in the shard of its prefix, and so is each array, so the shards' contents merge
+    //  without conflicts.  Arrays are copied with their records, keeping their item order.
+    Object ShardedObject::snapshot( ) const
+    {
+        std::vector<Object> shards;
+        {
+            auto locks = m_detail->lockAll( );
+            for ( const auto & shard : m_detail->shards )
+                { shards.push_back( shard.object.snapshot( ) ); }
+        }
+
+        Object result;
+        auto & to = result.writable( );
+        for ( const auto & shard : shards )
+        {
+            const auto & from = shard.data( );
+            to.keys.insert( from.keys.begin( ), from.keys.end( ) );
+            to.nulled.insert( from.nulled.begin( ), from.nulled.end( ) );
+            to.records.insert( from.records.begin( ), from.records.end( ) );
+            to.liveCounts.insert( from.liveCounts.begin( ), from.liveCounts.end( ) );
+        }
+        return result;
+    }
+
+
+    Object ShardedObject::snapshotOf( Memory key ) const
+    {
+        auto & shard = m_detail->shards[m_detail->shardOf( key )];
+        auto lock = shard.mutex.lock( );
+        return shard.object.snapshot( );
+    }
+
+
+    String ShardedObject::encode( Object::EncodeFormat format ) const
+    {
+        return snapshot( ).encode( format );
+    }
+
+
+    size_t ShardedObject::shardCount( ) const
+    {
+        return m_detail->shards.size( );
+    }
+
+
+    size_t ShardedObject::shardOf( Memory key ) const
+    {
+        return m_detail->shardOf( key );
+    }
+}
+
+#else
+
+#include "../../cpp/meta/Test.h"
+#include "../../cpp/process/Thread.h"
+#include "../../cpp/util/BitSharded.h"
+
+using namespace cpp;
+
+TEST_CASE( "ShardedObject" )
+{
+	bit::ShardedObject object;
+	CHECK( object.shardOf( "region[east].name" ) == object.shardOf( "region[west].name" ) );
+	CHECK( object.shardOf( "server.ip" ) == object.shardOf( "server.port" ) );
+
+	//	concurrent writers, each to its own prefix
+	std::vector<Thread> writers;
+	writers.reserve( 4 );
+	for ( int writer = 0; writer < 4; writer++ )
+	{
+		writers.emplace_back( [&object, writer]( )
+		{
+			for ( int item = 0; item < 100; item++ )
+				{ object.assign( String::format( "writer%.item[%]", writer, item ), String::format( "%", item ) ); }
+		} );
+	}
+	for ( auto & thread : writers )
+		{ thread.join( ); thread.check( ); }
+
+	bit::Object snapshot = object.snapshot( );
+	CHECK( snapshot["writer0.item[99]"].value( ) == "99" );
+	CHECK( snapshot["writer3.item"].asArray( ).size( ) == 100 );
+	CHECK( snapshot["writer2.item"].asArray( ).atIndex( 0 ).key( ).path == "writer2.item[0]" );
+	CHECK( snapshot["writer2.item"].asArray( ).atIndex( 2 ).key( ).path == "writer2.item[2]" );		// key order would give item[10]
+	CHECK( snapshot["writer2.item"].asArray( ).atIndex( 99 ).key( ).path == "writer2.item[99]" );
+
+	//	append merges into the shards, and a nulled key replaces its subtree
+	bit::Object update;
+	update["writer1"].erase( );
+	update["writer1.done"] = "1";
+	update["server.ip"] = "10.5.5.102";
+	object.append( update );
+	object.erase( "writer2" );
+	object.erase( "writer3.item[0]" );
+
+	bit::Object merged = object.snapshot( );
+	CHECK( merged["writer1.item[0]"].value( ).isNull( ) );
+	CHECK( merged["writer1.done"].value( ) == "1" );
+	CHECK( merged["writer2"].isNulled( ) );
+	CHECK( merged["writer3.item"].asArray( ).size( ) == 99 );
+	CHECK( object.snapshotOf( "server" )["server.ip"].value( ) == "10.5.5.102" );
+	CHECK( object.encode( ) == merged.encode( ) );
+
+	//	keys above the prefix depth are erased in every shard
+	bit::ShardedObject deep{ 4, 2 };
+	deep.assign( "a.b.x", "1" );
+	deep.assign( "a.c.x", "2" );
+	deep.assign( "d", "3" );
+	deep.erase( "a" );
+	deep.assign( "a.c.y", "4" );
+
+	bit::Object plain;
+	plain["a.b.x"] = "1";
+	plain["a.c.x"] = "2";
+	plain["d"] = "3";
+	plain["a"].erase( );
+	plain["a.c.y"] = "4";
+	CHECK( deep.encode( bit::Object::EncodeFormat::Compact ) == plain.encode( bit::Object::EncodeFormat::Compact ) );
+	CHECK( deep.snapshot( )["a"].isNulled( ) );
+
+	deep.erase( "" );
+	CHECK( deep.encode( ) == "" );
+	CHECK_THROWS( bit::ShardedObject{ 0 } );
+}
+
+#endif
@@ -0,0 +1,48 @@
+#pragma once
+
+/*
+
+ShardedObject is a bit::Object for many writer threads.  Keys are split into shards by their first segments
+(the prefix depth, 1 by default), each shard an Object with its own lock, so writers to different prefixes
+do not wait on each other.  A prefix never extends into an array item, so each array stays in one shard with
+its item order.
+
+	bit::ShardedObject object;
+	object.assign( "server.ip", "10.5.5.102" );			// from any thread
+	object.append( bit::decode( records ) );			// each shard it touches is updated atomically
+	String text = object.encode( );					// every shard at one point in time
+
+snapshot( ) locks every shard just long enough to take its O(1) Object::snapshot( ), then merges them
+without any lock held, so it costs a copy of the keys but never blocks writers for that long.  Readers of
+a single prefix can take the snapshot of its shard instead, which is O(1).
+
+Erasing a key above the prefix depth (e.g. "a" with a depth of 2) clears the keys below it in every shard.
+
+*/
+
+#include "../../cpp/util/Bit.h"
+
+
+namespace cpp::bit
+{
+    class ShardedObject
+    {
+    public:
+                                            ShardedObject( size_t shardCount = 16, size_t depth = 1 );
+
+        void                                assign( Memory key, Memory value );    // a null value removes key, see Object::assign( )
+        void                                erase( Memory key );                    // i.e. key : null, "" clears every shard
+        void                                append( const Object & object );       // merges object's keys at the root, see Object::append( )
+
+        Object                              snapshot( ) const;                     // every shard at one point in time
+        Object                              snapshotOf( Memory key ) const;        // O(1) snapshot of the shard holding key
+        String                              encode( Object::EncodeFormat format = Object::EncodeFormat::Leaf ) const;
+
+        size_t                              shardCount( ) const;
+        size_t                              shardOf( Memory key ) const;
+
+    private:
+        struct Detail;
+        std::shared_ptr<Detail>             m_detail;
+    };
+}
@@ -0,0 +1,280 @@
+#ifndef TEST
+
+#include <algorithm>
+#include <optional>
+#include <string_view>
+
+#include "../../cpp/util/BitSubscriptions.h"
+#include "../../cpp/data/DataBuffer.h"
+#include "../../cpp/process/Lock.h"
+
+
+namespace cpp::bit
+{
+    struct BitSubscriptions::Detail
+    {
+        struct Subscription
+        {
+            Id                              id;
+            Handler                         handler;
+            std::optional<BitSelector>      selector;               // none for a prefix
+            std::string                     path;                   // of the node holding it
+            std::vector<std::string>        keys;                   // matched by the current dispatch
+        };
+
+        struct Node
+        {
+            std::map<std::string, Node, std::less<>> children;     // by key segment
+            std::vector<Subscription *>     subscriptions;
+        };
+
+        Node *                              find( Memory path, bool isAdded );
+        void                                match( Subscription & subscription, const std::string & key );
+        void                                matchAll( Node & node, const std::string & key );
+        void                                dispatch( const std::vector<std::pair<std::string, bool>> & changes );
+        Id                                  add( Memory path, Handler handler, std::optional<BitSelector> selector );
+
+        mutable Mutex                       mutex;
+        Node                                root;
+        std::map<Id, Subscription>          subscriptions;
+        std::vector<Subscription *>         matched;
+        Id                                  nextId = 1;
+    };
+
+
+    BitSubscriptions::Detail::Node * BitSubscriptions::Detail::find( Memory path, bool isAdded )
+    {
+        Node * node = &root;
+        for ( size_t pos = 0; pos < path.length( ); pos++ )
+        {
+            size_t end = segmentEnd( path, pos );
+            std::string_view segment{ path.begin( ) + pos, end - pos };
+            auto itr = node->children.find( segment );
+            if ( itr == node->children.end( ) )
+            {
+                if ( !isAdded )
+                    { return nullptr; }
+                itr = node->children.emplace( std::string{ segment }, Node{ } ).first;
+            }
+            node = &itr->second;
+            pos = end;
+        }
+        return node;
+    }
+
+
+    void BitSubscriptions::Detail::match( Subscription & subscription, const std::string & key )
+    {
+        if ( subscription.keys.empty( ) )
+            { matched.push_back( &subscription ); }
+        else if ( subscription.keys.back( ) == key )
+            { return; }
+        subscription.keys.push_back( key );
+    }
+
+
+    void BitSubscriptions::Detail::matchAll( Node & node, const std::string & key )
+    {
+        for ( Subscription * subscription : node.subscriptions )
+            { match( *subscription, key ); }
+        for ( auto & [segment, child] : node.children )
+            { matchAll( child, key ); }
+    }
+
+
+    //  Each key visits the nodes of its own segments, whose prefixes it is at or below.  Selectors there
+    //  are tested against the key, and for an erased key, against the keys it may have removed.
+    void BitSubscriptions::Detail::dispatch( const std::vector<std::pair<std::string, bool>> & changes )
+    {
+        std::vector<std::pair<Handler, std::vector<std::string>>> calls;
+        {
+            auto lock = mutex.lock( );
+            for ( const auto & [key, isErased] : changes )
+            {
+                Node * node = &root;
+                for ( size_t pos = 0; ; pos++ )
+                {
+                    for ( Subscription * subscription : node->subscriptions )
+                    {
+                        const auto & selector = subscription->selector;
+                        if ( !selector || ( isErased ? selector->matchesBelow( key ) : selector->matches( key ) ) )
+                            { match( *subscription, key ); }
+                    }
+                    if ( pos >= key.length( ) )
+                        { break; }
+
+                    size_t end = segmentEnd( key, pos );
+                    auto itr = node->children.find( std::string_view{ key.data( ) + pos, end - pos } );
+                    if ( itr == node->children.end( ) )
+                        { node = nullptr; break; }
+                    node = &itr->second;
+                    pos = end;
+                }
+
+                if ( node && isErased )
+                {
+                    for ( auto & [segment, child] : node->children )
+                        { matchAll( child, key ); }
+                }
+            }
+
+            std::sort( matched.begin( ), matched.end( ), []( auto * a, auto * b ) { return a->id < b->id; } );
+            for ( Subscription * subscription : matched )
+            {
+                calls.emplace_back( subscription->handler, std::move( subscription->keys ) );
+                subscription->keys.clear( );
+            }
+            matched.clear( );
+        }
+
+        for ( auto & [handler, keys] : calls )
+            { handler( keys ); }
+    }
+
+
+    BitSubscriptions::Id BitSubscriptions::Detail::add( Memory path, Handler handler, std::optional<BitSelector> selector )
+    {
+        check<std::invalid_argument>( bool( handler ), "BitSubscriptions::subscribe( ) : handler is required" );
+
+        auto lock = mutex.lock( );
+        Id id = nextId++;
+        Subscription & subscription = subscriptions[id];
+        subscription.id = id;
+        subscription.handler = std::move( handler );
+        subscription.selector = std::move( selector );
+        subscription.path = path.toString( );
+        find( path, true )->subscriptions.push_back( &subscription );
+        return id;
+    }
+
+
+
+    BitSubscriptions::BitSubscriptions( )
+        : m_detail{ std::make_shared<Detail>( ) }
+    {
+    }
+
+
+    BitSubscriptions::Id BitSubscriptions::subscribe( Memory prefix, Handler handler )
+    {
+        return m_detail->add( prefix, std::move( handler ), std::nullopt );
+    }
+
+
+    //  The selector is held at its literal prefix, less any item it ends inside, e.g. "region" of "region[*]".
+    BitSubscriptions::Id BitSubscriptions::subscribe( const BitSelector & selector, Handler handler )
+    {
+        Memory path = selector.prefix( );
+        if ( path.notEmpty( ) && path[path.length( ) - 1] == '[' )
+        {
+            size_t end = path.rfind( '.' );
+            path = ( end == Memory::npos ) ? Memory::Empty : path.substr( 0, end );
+        }
+        return m_detail->add( path, std::move( handler ), selector );
+    }
+
+
+    void BitSubscriptions::unsubscribe( Id id )
+    {
+        auto lock = m_detail->mutex.lock( );
+        auto itr = m_detail->subscriptions.find( id );
+        if ( itr == m_detail->subscriptions.end( ) )
+            { return; }
+
+        auto & held = m_detail->find( itr->second.path, false )->subscriptions;
+        held.erase( std::find( held.begin( ), held.end( ), &itr->second ) );
+        m_detail->subscriptions.erase( itr );
+    }
+
+
+    bool BitSubscriptions::isEmpty( ) const
+    {
+        auto lock = m_detail->mutex.lock( );
+        return m_detail->subscriptions.empty( );
+    }
+
+
+    void BitSubscriptions::dispatch( Memory records )
+    {
+        if ( isEmpty( ) )
+            { return; }
+
+        std::vector<std::pair<std::string, bool>> changes;
+        Decoder::Handler handler;
+        handler.onValue = [&changes]( Memory key, Memory ) { changes.emplace_back( key.toString( ), false ); };
+        handler.onNull = [&changes]( Memory key ) { changes.emplace_back( key.toString( ), false ); };
+        handler.onErase = [&changes]( Memory key ) { changes.emplace_back( key.toString( ), true ); };
+
+        Decoder decoder{ std::move( handler ) };
+        DataBuffer buffer{ records };
+        while ( buffer.getable( ) && decoder.decode( buffer ) )
+            { }
+
+        m_detail->dispatch( changes );
+    }
+
+
+    void BitSubscriptions::dispatch( const Object & from, const Object & to )
+    {
+        if ( !isEmpty( ) )
+            { dispatch( diff( from, to, true ) ); }
+    }
+}
+
+#else
+
+#include "../../cpp/meta/Test.h"
+#include "../../cpp/util/BitSubscriptions.h"
+
+using namespace cpp;
+
+TEST_CASE( "BitSubscriptions" )
+{
+	std::map<std::string, std::string> received;
+	auto handler = [&received]( std::string name )
+	{
+		return [&received, name]( const std::vector<std::string> & keys )
+		{
+			for ( const auto & key : keys )
+				{ received[name] += received[name].empty( ) ? key : " " + key; }
+		};
+	};
+
+	bit::BitSubscriptions subscriptions;
+	CHECK( subscriptions.isEmpty( ) );
+	subscriptions.subscribe( "server", handler( "server" ) );
+	subscriptions.subscribe( "region[west].server", handler( "west" ) );
+	subscriptions.subscribe( bit::BitSelector{ "region[*].server.port" }, handler( "ports" ) );
+	auto all = subscriptions.subscribe( "", handler( "all" ) );
+
+	subscriptions.dispatch(
+		"server : ip='10.5.5.102' port='10667'\n"
+		"region[east].server.port='80'\n"
+		"region[west].server.ip='10.0.0.2'\n"
+		"client.port='1'\n" );
+	CHECK( received["server"] == "server.ip server.port" );
+	CHECK( received["west"] == "region[west].server.ip" );
+	CHECK( received["ports"] == "region[east].server.port" );
+	CHECK( received["all"] == "server.ip server.port region[east].server.port region[west].server.ip client.port" );
+
+	//	an erased key reaches the subscriptions below it, and selectors which may match below it
+	received.clear( );
+	subscriptions.unsubscribe( all );
+	subscriptions.dispatch( "region[west] : null\nserverless='1'\n" );
+	CHECK( received["west"] == "region[west]" );
+	CHECK( received["ports"] == "region[west]" );
+	CHECK( received["server"] == "" );
+	CHECK( received["all"] == "" );
+
+	//	the keys which differ between two objects
+	received.clear( );
+	bit::Object from;
+	from["server.ip"] = "10.5.5.102";
+	from["server.port"] = "10667";
+	bit::Object to = from.copy( );
+	to["server.port"] = "10668";
+	subscriptions.dispatch( from, to );
+	CHECK( received["server"] == "server.port" );
+}
+
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+
+/*
+
+BitSubscriptions calls each subscriber with only the keys it cares about, out of the keys a batch of records
+changes.  A subscription is to a key prefix (the key and every key below it) or to a BitSelector pattern.
+
+Subscriptions are held in a tree by key segment, a selector at the segments of its literal prefix.  Each changed
+key walks the tree along its own segments, so dispatch costs the depth of the key rather than the number of
+subscriptions.  An erased key (i.e. key : null) also reaches every subscription below it.
+
+	bit::BitSubscriptions subscriptions;
+	subscriptions.subscribe( "server", []( const std::vector<std::string> & keys ) { ... } );
+	subscriptions.subscribe( bit::BitSelector{ "region[*].port" }, ... );
+	subscriptions.dispatch( "server : ip='10.5.5.102'\n" );		// calls the first with server.ip
+
+Handlers are called on the dispatching thread, once per dispatch with all of their keys, and without any lock
+held, so they may subscribe or unsubscribe.
+
+*/
+
+#include "../../cpp/util/BitSelector.h"
+
+
+namespace cpp::bit
+{
+    class BitSubscriptions
+    {
+    public:
+        typedef std::function<void( const std::vector<std::string> & keys )> Handler;
+        typedef uint64_t                    Id;
+
+                                            BitSubscriptions( );
+
+        Id                                  subscribe( Memory prefix, Handler handler );       // "" for every key
+        Id                                  subscribe( const BitSelector & selector, Handler handler );
+        void                                unsubscribe( Id id );
+        bool                                isEmpty( ) const;
+
+        void                                dispatch( Memory records );                        // the keys encoded records change
+        void                                dispatch( const Object & from, const Object & to ); // the keys which differ, see bit::diff( )
+
+    private:
+        struct Detail;
+        std::shared_ptr<Detail>             m_detail;
+    };
+}
@@ -0,0 +1,320 @@
+#ifndef TEST
+
+#include <list>
+#include <map>
+#include <unordered_map>
+
+#include "../../cpp/util/BitValueIndex.h"
+#include "../../cpp/data/DataBuffer.h"
+#include "../../cpp/file/MemoryFile.h"
+#include "../../cpp/process/Lock.h"
+
+
+namespace cpp::bit
+{
+    struct BitValueIndex::Detail
+    {
+        struct Entry
+        {
+            size_t                          offset = Memory::npos;  // of the value in the file, npos while it is in memory
+            size_t                          length = 0;
+            std::string                     value;
+        };
+
+        typedef std::list<std::pair<size_t, std::string>> Cache;   // values by offset, most recently read first
+
+        void                                index( Memory text, size_t offset, bool isWritten );
+        void                                setValue( Memory key, Memory value );
+        void                                removeKey( Memory key );
+        Memory                              read( const Entry & entry );
+
+        size_t                              cacheLimit;
+        mutable Mutex                       mutex;
+        std::map<std::string, Entry>        keys;
+        File                                file;
+
+        Cache                               cache;
+        std::unordered_map<size_t, Cache::iterator> cached;
+        size_t                              cacheLength = 0;
+    };
+
+
+    //  Replays the records in text, which begins at offset in the file.  Values are located in the file when
+    //  they were length-encoded, i.e. the decoder returned them from the text itself.  Records which were
+    //  only appended (isWritten) were already applied by set( ) or remove( ), and only move values which
+    //  are unchanged since to the file.
+    void BitValueIndex::Detail::index( Memory text, size_t offset, bool isWritten )
+    {
+        auto location = [&]( Memory value )
+        {
+            bool isInText = value.begin( ) >= text.begin( ) && value.end( ) <= text.end( ) && value.notEmpty( );
+            return isInText ? offset + ( value.begin( ) - text.begin( ) ) : Memory::npos;
+        };
+
+        Decoder::Handler handler;
+        if ( isWritten )
+        {
+            handler.onValue = [&]( Memory key, Memory value )
+            {
+                auto itr = keys.find( key );
+                size_t valueOffset = location( value );
+                if ( itr != keys.end( ) && itr->second.offset == Memory::npos && valueOffset != Memory::npos && Memory{ itr->second.value } == value )
+                    { itr->second = Entry{ valueOffset, value.length( ) }; }
+            };
+        }
+        else
+        {
+            handler.onValue = [&]( Memory key, Memory value )
+            {
+                size_t valueOffset = location( value );
+                if ( valueOffset != Memory::npos )
+                    { keys[key] = Entry{ valueOffset, value.length( ) }; }
+                else
+                    { setValue( key, value ); }
+            };
+            handler.onNull = [&]( Memory key ) { keys.erase( key ); };
+            handler.onErase = [&]( Memory key ) { removeKey( key ); };
+        }
+
+        //  record by record, so a bad record is skipped rather than ending the replay
+        Decoder decoder{ std::move( handler ) };
+        for ( size_t pos = 0; pos < text.length( ); )
+        {
+            size_t end = Decoder::findRecordEnd( text, pos );
+            if ( end == Memory::npos )
+                { break; }
+
+            DataBuffer buffer{ text.substr( pos, end - pos ) };
+            decoder.decode( buffer );
+            pos = end;
+        }
+    }
+
+
+    void BitValueIndex::Detail::setValue( Memory key, Memory value )
+    {
+        Entry & entry = keys[key];
+        entry.offset = Memory::npos;
+        entry.length = value.length( );
+        entry.value = value;
+    }
+
+
+    void BitValueIndex::Detail::removeKey( Memory key )
+    {
+        if ( key.isEmpty( ) )
+        {
+            keys.clear( );
+            return;
+        }
+
+        keys.erase( key );
+        keys.erase( keys.lower_bound( key + "." ), keys.lower_bound( key + "/" ) );     // '/' follows '.'
+    }
+
+
+    Memory BitValueIndex::Detail::read( const Entry & entry )
+    {
+        auto found = cached.find( entry.offset );
+        if ( found != cached.end( ) )
+        {
+            cache.splice( cache.begin( ), cache, found->second );
+            return found->second->second;
+        }
+
+        std::string value( entry.length, '\0' );
+        file.seek( entry.offset );
+        for ( size_t pos = 0; pos < value.length( ); )
+        {
+            Memory data = file.read( Memory{ value.data( ) + pos, value.length( ) - pos } );
+            check<IOException>( data.notEmpty( ), "BitValueIndex::get( ) : unable to read the value" );
+            pos += data.length( );
+        }
+
+        //  the value just read stays cached even if it is larger than the cache
+        cacheLength += value.length( );
+        cache.emplace_front( entry.offset, std::move( value ) );
+        cached[entry.offset] = cache.begin( );
+        while ( cacheLength > cacheLimit && cache.size( ) > 1 )
+        {
+            cacheLength -= cache.back( ).second.length( );
+            cached.erase( cache.back( ).first );
+            cache.pop_back( );
+        }
+
+        return cache.front( ).second;
+    }
+
+
+
+    BitValueIndex::BitValueIndex( size_t cacheLength )
+        : m_detail{ std::make_shared<Detail>( ) }
+    {
+        m_detail->cacheLimit = cacheLength;
+    }
+
+
+    void BitValueIndex::open( const FilePath & filename )
+    {
+        auto lock = m_detail->mutex.lock( );
+        m_detail->keys.clear( );
+        m_detail->cache.clear( );
+        m_detail->cached.clear( );
+        m_detail->cacheLength = 0;
+
+        m_detail->file = File::readFrom( filename );
+        if ( m_detail->file.length( ) > 0 )
+        {
+            auto text = MemoryFile::read( filename );
+            m_detail->index( text.data( ), 0, false );
+        }
+    }
+
+
+    void BitValueIndex::close( )
+    {
+        auto lock = m_detail->mutex.lock( );
+        m_detail->file.close( );
+        m_detail->keys.clear( );
+        m_detail->cache.clear( );
+        m_detail->cached.clear( );
+        m_detail->cacheLength = 0;
+    }
+
+
+    size_t BitValueIndex::size( ) const
+    {
+        auto lock = m_detail->mutex.lock( );
+        return m_detail->keys.size( );
+    }
+
+
+    size_t BitValueIndex::cacheLength( ) const
+    {
+        auto lock = m_detail->mutex.lock( );
+        return m_detail->cacheLength;
+    }
+
+
+    std::optional<std::string> BitValueIndex::get( Memory key ) const
+    {
+        auto lock = m_detail->mutex.lock( );
+        auto itr = m_detail->keys.find( key );
+        if ( itr == m_detail->keys.end( ) )
+            { return std::nullopt; }
+
+        const auto & entry = itr->second;
+        return entry.offset == Memory::npos ? entry.value : m_detail->read( entry ).toString( );
+    }
+
+
+    void BitValueIndex::set( Memory key, Memory value )
+    {
+        auto lock = m_detail->mutex.lock( );
+        if ( value.isNull( ) )
+            { m_detail->keys.erase( key ); }
+        else
+            { m_detail->setValue( key, value ); }
+    }
+
+
+    void BitValueIndex::remove( Memory key )
+    {
+        auto lock = m_detail->mutex.lock( );
+        m_detail->removeKey( key );
+    }
+
+
+    void BitValueIndex::apply( Memory records )
+    {
+        Decoder::Handler handler;
+        handler.onValue = [this]( Memory key, Memory value ) { m_detail->setValue( key, value ); };
+        handler.onNull = [this]( Memory key ) { m_detail->keys.erase( key ); };
+        handler.onErase = [this]( Memory key ) { m_detail->removeKey( key ); };
+
+        auto lock = m_detail->mutex.lock( );
+        Decoder decoder{ std::move( handler ) };
+        DataBuffer buffer{ records };
+        while ( buffer.getable( ) && decoder.decode( buffer ) )
+            { }
+    }
+
+
+    void BitValueIndex::append( size_t offset, Memory records )
+    {
+        auto lock = m_detail->mutex.lock( );
+        m_detail->index( records, offset, true );
+    }
+}
+
+#else
+
+#include "../../cpp/meta/Test.h"
+#include "../../cpp/util/BitValueIndex.h"
+
+using namespace cpp;
+
+TEST_CASE( "BitValueIndex" )
+{
+	Memory text =
+		"server : ip=(10)'10.5.5.102' port='10667'\n"
+		"server.name='a^'b'\n"
+		"client : name=(1)'a'\n"
+		"region[east].count=(1)'3'\n"
+		"server.port=(5)'10668'\n"
+		"client : null\n";
+
+	FilePath filename = "test.bit";
+	auto file = File::create( filename );
+	file.write( text );
+	file.close( );
+
+	bit::BitValueIndex values{ 12 };
+	values.open( filename );
+	CHECK( values.size( ) == 4 );
+	CHECK( values.get( "server.name" ) == "a'b" );		// quoted, kept in memory
+	CHECK( values.cacheLength( ) == 0 );
+	CHECK_FALSE( values.get( "client.name" ) );
+
+	//	the least recently read values leave the cache once it is full
+	CHECK( values.get( "server.ip" ) == "10.5.5.102" );
+	CHECK( values.get( "server.port" ) == "10668" );
+	CHECK( values.get( "region[east].count" ) == "3" );
+	CHECK( values.cacheLength( ) == 6 );
+	CHECK( values.get( "server.ip" ) == "10.5.5.102" );
+	CHECK( values.cacheLength( ) == 11 );
+
+	//	a value read stays valid after it leaves the cache
+	auto port = values.get( "server.port" );
+	CHECK( values.get( "region[east].count" ) == "3" );
+	CHECK( values.get( "server.name" ) == "a'b" );
+	CHECK( values.get( "server.ip" ) == "10.5.5.102" );
+	CHECK( port == "10668" );
+
+	//	set values stay in memory until the records holding them are appended
+	Memory records = "server.ip=(8)'10.0.0.1'\nregion[east] : null\n";
+	values.set( "server.ip", "10.0.0.1" );
+	values.remove( "region[east]" );
+	CHECK( values.get( "server.ip" ) == "10.0.0.1" );
+	CHECK( values.size( ) == 3 );
+
+	file = File::append( filename );
+	file.write( records );
+	file.close( );
+
+	values.append( text.length( ), records );
+	CHECK( values.get( "server.ip" ) == "10.0.0.1" );
+	CHECK( values.cacheLength( ) == 8 );
+
+	values.open( filename );
+	CHECK( values.size( ) == 3 );
+	CHECK( values.get( "server.ip" ) == "10.0.0.1" );
+
+	values.apply( "server.port='10669'\nserver : null\n" );
+	CHECK( values.size( ) == 0 );
+
+	values.close( );
+	Files::remove( filename );
+}
+
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+
+BitValueIndex keeps the keys of a Bit file in memory with only the location of their values, so the file can
+be much larger than memory.  Values are read from the file when asked for, through an LRU cache of a given
+size.  Length-encoded values (i.e. key=(5)'value', as BitFile writes them) are read straight from the file
+without decoding.  Quoted values (i.e. key='value') are unescaped as they are decoded, so they are kept in
+memory instead.
+
+Values which are set are kept in memory until the records holding them are appended, see append( ).  get( )
+returns a copy, since a cached value can be evicted by another reader and a set value replaced by a writer.
+
+	bit::BitValueIndex values{ 64 * 1024 * 1024 };
+	values.open( "data.bit" );
+	std::optional<std::string> ip = values.get( "server.ip" );
+
+*/
+
+#include <optional>
+
+#include "../../cpp/file/File.h"
+#include "../../cpp/util/Bit.h"
+
+
+namespace cpp::bit
+{
+    class BitValueIndex
+    {
+    public:
+        static constexpr size_t             DefaultCacheLength = 64 * 1024 * 1024;
+
+                                            BitValueIndex( size_t cacheLength = DefaultCacheLength );
+
+        void                                open( const FilePath & filename );      // indexes the values in the file
+        void                                close( );
+
+        size_t                              size( ) const;                          // number of keys
+        size_t                              cacheLength( ) const;                   // bytes of cached values
+
+        std::optional<std::string>          get( Memory key ) const;                // empty if key has no value
+        void                                set( Memory key, Memory value );
+        void                                remove( Memory key );                   // and its subkeys
+        void                                apply( Memory records );                // replays encoded records, like set( ) and remove( )
+        void                                append( size_t offset, Memory records );    // records now in the file at offset
+
+    private:
+        struct Detail;
+        std::shared_ptr<Detail>             m_detail;
+    };
+}